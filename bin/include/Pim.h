@@ -7,19 +7,30 @@
 
 // Engine headers
 #include "PimVec2.h"
+#include "PimBounds.h"
+#include "PimSpatialIndex.h"
 #include "PimPolygonShape.h"
 #include "PimWinStyle.h"
 #include "PimGameControl.h"
 #include "PimGameNode.h"
+#include "PimNodePool.h"
+#include "PimNodeList.h"
+#include "PimIdentifier.h"
+#include "PimJobSystem.h"
+#include "PimFrameStats.h"
+#include "PimTrace.h"
+#include "PimCommandBuffer.h"
 #include "PimScene.h"
 #include "PimLayer.h"
 #include "PimAssert.h"
 #include "PimInput.h"
+#include "PimInputRecorder.h"
 #include "PimSprite.h"
 #include "PimSpriteBatchNode.h"
 #include "PimShaderManager.h"
 #include "PimLightingSystem.h"
 #include "PimLightDef.h"
+#include "PimVisibilityPolygon.h"
 #include "PimFont.h"
 #include "PimLabel.h"
 #include "PimRenderWindow.h"
@@ -25,6 +25,7 @@ namespace Pim {
 		friend class ActionQueueRepeat;
 		friend class ActionQueue;
 		friend class GameNode;
+		friend class CommandBuffer;
 
 	public:
 		// If true, the node running the action will be notified via the
@@ -34,6 +35,8 @@ namespace Pim {
 		// By default, the parent of the action is notified.
 		// You may override this by setting a callback-node yourself.
 		GameNode*				notificationCallback;
+
+		enum { NODE_KIND = KIND_BASE_ACTION };
 		
 								BaseAction(float duration);
 		virtual void			Update(float)	= 0;
@@ -69,7 +72,9 @@ namespace Pim {
 	protected:
 		friend class GameNode;
 	public:
-								Action(float duration) : BaseAction(duration) {}
+		enum { NODE_KIND = KIND_ACTION };
+
+								Action(float duration) : BaseAction(duration) { kind |= NODE_KIND; }
 	protected:
 		virtual void			Update(float) {}
 		virtual void			Activate();
@@ -170,7 +175,9 @@ namespace Pim {
 		friend class Sprite;
 
 	public:
-								SpriteAction(float duration) : BaseAction(duration) {}
+		enum { NODE_KIND = KIND_SPRITE_ACTION };
+
+								SpriteAction(float duration) : BaseAction(duration) { kind |= NODE_KIND; }
 
 	protected:
 		virtual void			Update(float) {}
@@ -251,6 +258,8 @@ namespace Pim {
 		friend class Sprite;
 
 	public:
+		enum { NODE_KIND = KIND_ACTION_QUEUE };
+
 								ActionQueue(int numActions, BaseAction *action1, ...);
 								~ActionQueue();
 		void					Update(float);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "PimInternal.h"
+
+namespace Pim {
+	/**
+	 @class 		CommandBuffer
+	 @brief 		Records changes to the node hierarchy, to be applied later.
+	 @details 		While a CommandBuffer is recording on a thread, calls to
+	 				AddChild(), RemoveChild(), RemoveAllChildren(), SetZOrder(),
+	 				SetSleeping(), MarkMoved(), the RunAction-methods and the
+	 				Listen- and Unlisten-methods of GameNode on that thread are
+	 				not executed. They are appended to the buffer, and executed
+	 				in the same order by Execute().
+
+	 				GameControl records into CommandBuffers while updating the
+	 				nodes declared thread safe by GameNode::SetParallelUpdate().
+	 */
+
+	class GameNode;
+	class BaseAction;
+
+	class CommandBuffer {
+	public:
+		static CommandBuffer*	GetRecording();
+		static void				SetRecording(CommandBuffer *buffer);
+
+		void					AddChild(GameNode *parent, GameNode *child);
+		void					RemoveChild(GameNode *parent, GameNode *child, bool cleanup);
+		void					RemoveAllChildren(GameNode *parent, bool cleanup);
+		void					SetZOrder(GameNode *node, int z);
+		void					SetSleeping(GameNode *node, bool flag);
+		void					RunAction(GameNode *node, BaseAction *action);
+		void					MarkMoved(GameNode *node);
+		void					Listen(GameNode *node, int type);
+		void					Unlisten(GameNode *node, int type);
+		void					Execute();
+		bool					IsEmpty() const;
+
+	private:
+		enum CommandType {
+			ADD_CHILD,
+			REMOVE_CHILD,
+			REMOVE_ALL_CHILDREN,
+			SET_Z_ORDER,
+			SET_SLEEPING,
+			RUN_ACTION,
+			MARK_MOVED,
+			LISTEN,
+			UNLISTEN,
+		};
+
+		struct Command {
+			CommandType			type;
+			GameNode			*node;
+			GameNode			*other;
+			int					arg;
+		};
+
+		vector<Command>			commands;
+
+		void					Push(CommandType type, GameNode *node, GameNode *other, int arg);
+	};
+
+	/**
+	 @fn 			CommandBuffer::GetRecording
+	 @brief 		Returns the buffer recording on the calling thread, or NULL.
+	 */
+
+	/**
+	 @fn 			CommandBuffer::SetRecording
+	 @brief 		Start recording the calling thread's changes into the buffer.
+	 				Pass NULL to stop recording.
+	 */
+
+	/**
+	 @fn 			CommandBuffer::RunAction
+	 @brief 		Records a RunAction-call. The action is added to the node and
+	 				activated when the command is executed.
+	 */
+
+	/**
+	 @fn 			CommandBuffer::Listen
+	 @brief 		Records a Listen-call. 'type' is a ListenerList::ListenerType.
+	 */
+
+	/**
+	 @fn 			CommandBuffer::Execute
+	 @brief 		Executes and removes all recorded commands. Must not be called
+	 				while the calling thread is recording.
+	 */
+}
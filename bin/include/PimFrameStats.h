@@ -0,0 +1,162 @@
+#pragma once
+
+#include "PimInternal.h"
+
+#include <atomic>
+
+// The number of frames kept by FrameStats. Must be a power of two.
+#define PIM_FRAME_STATS_CAPACITY	1024
+
+namespace Pim {
+	/**
+	 @class 		FrameStats
+	 @brief 		Times the phases of every frame.
+	 @details 		GameControl owns a FrameStats, available via
+	 				GameControl::GetFrameStats(). The time spent in each phase
+	 				of the game loop is added to the current frame, and the
+	 				finished frames are kept in a ring buffer of the last
+	 				PIM_FRAME_STATS_CAPACITY frames.
+
+	 				The phases do not overlap, except LIGHTING, which is the
+	 				part of RENDER spent by the lighting systems. TOTAL is the
+	 				wall time of the whole frame, including the time not
+	 				covered by any phase. The draw time of a single layer is
+	 				available via Layer::GetDrawTime().
+
+	 				Frames are written by the main thread only, but may be read
+	 				from any thread without locking. A frame overwritten while
+	 				being read is skipped.
+
+	 				@code
+	 				FrameStats::Summary s =
+	 					GameControl::GetFrameStats()->GetSummary(FrameStats::TOTAL, 600);
+	 				printf("p99: %.2f ms\n", s.p99 * 1000.f);
+	 				@endcode
+	 */
+
+	class FrameStats {
+	public:
+		enum Phase {
+			EVENTS,				// Polling SDL and reading the replay
+			WAIT,				// The frame limiter
+			INPUT,				// Dispatching input
+			UPDATE,				// Updating the nodes
+			DELETE_QUEUE,		// Deleting nodes
+			MAIN_THREAD_JOBS,	// JobSystem::DispatchMainThreadJobs()
+			RENDER,				// Drawing the scene, except the buffer swap
+			LIGHTING,			// Part of RENDER
+			SWAP,				// The buffer swap
+			AUDIO,				// Streaming sounds
+
+			PHASE_COUNT,
+			TOTAL = PHASE_COUNT,
+		};
+
+		struct Frame {
+			unsigned int		index;					// Counted from the start of the game
+			float				times[PHASE_COUNT+1];	// Seconds, indexed by Phase
+		};
+
+		struct Summary {
+			unsigned int		frames;			// Frames in the window
+			float				average;
+			float				p50;
+			float				p95;
+			float				p99;
+			float				worst;
+			unsigned int		worstFrame;		// Frame::index of the worst frame
+		};
+
+								FrameStats();
+		void					BeginFrame();
+		void					AddTime(Phase phase, float seconds);
+		void					EndFrame(float total);
+		unsigned int			GetFrameCount() const;
+		bool					GetFrame(unsigned int age, Frame &frame) const;
+		unsigned int			GetFrames(unsigned int window, vector<Frame> &frames) const;
+		Summary					GetSummary(Phase phase,
+									unsigned int window=PIM_FRAME_STATS_CAPACITY) const;
+		void					GetWorstFrames(Phase phase, unsigned int window,
+									unsigned int num, vector<Frame> &frames) const;
+		void					GetHistogram(Phase phase, unsigned int window,
+									float bucketSize, unsigned int *buckets,
+									unsigned int numBuckets) const;
+		bool					DumpCSV(const string &path) const;
+		void					SetDumpFile(const string &path);
+		const string&			GetDumpFile() const;
+		static const char*		GetPhaseName(Phase phase);
+
+	private:
+		struct Slot {
+			atomic<unsigned int> seq;	// Odd while the frame is written
+			Frame				frame;
+		};
+
+		Slot					slots[PIM_FRAME_STATS_CAPACITY];
+		atomic<unsigned int>	count;		// Frames written
+		Frame					current;	// Main thread only
+		string					dumpFile;
+
+								FrameStats(const FrameStats&);
+		FrameStats&				operator=(const FrameStats&);
+
+		bool					ReadSlot(unsigned int idx, Frame &frame) const;
+	};
+
+	/**
+	 @fn 			FrameStats::AddTime
+	 @brief 		Adds to the time of a phase in the current frame. Must only
+	 				be called from the main thread.
+	 */
+
+	/**
+	 @fn 			FrameStats::EndFrame
+	 @brief 		Stores the current frame in the ring buffer. Called by
+	 				GameControl at the end of every frame.
+	 */
+
+	/**
+	 @fn 			FrameStats::GetFrame
+	 @brief 		Copies a stored frame. Age 0 is the last finished frame.
+	 				Returns false if the frame is no longer stored.
+	 */
+
+	/**
+	 @fn 			FrameStats::GetFrames
+	 @brief 		Copies the last 'window' frames, oldest first, and returns
+	 				the number of frames copied.
+	 */
+
+	/**
+	 @fn 			FrameStats::GetSummary
+	 @brief 		The average, percentiles and worst time of a phase over the
+	 				last 'window' frames. The percentiles use the nearest rank.
+	 */
+
+	/**
+	 @fn 			FrameStats::GetWorstFrames
+	 @brief 		Copies the 'num' frames of the last 'window' frames where
+	 				the phase took the longest, worst first.
+	 */
+
+	/**
+	 @fn 			FrameStats::GetHistogram
+	 @brief 		Counts the times of a phase over the last 'window' frames.
+	 @details 		Bucket i counts the times in [i, i+1) * bucketSize seconds,
+	 				and the last bucket all longer times.
+	 */
+
+	/**
+	 @fn 			FrameStats::DumpCSV
+	 @brief 		Writes the stored frames to a CSV file, one frame per row,
+	 				with the times in milliseconds. Returns false if the file
+	 				could not be created.
+	 */
+
+	/**
+	 @fn 			FrameStats::SetDumpFile
+	 @brief 		GameControl writes the stored frames to this file with
+	 				DumpCSV() when the game loop exits. Empty by default, which
+	 				disables the dump.
+	 */
+}
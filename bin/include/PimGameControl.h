@@ -4,6 +4,10 @@
 #include "PimVec2.h"
 #include "PimWinStyle.h"
 #include "PimRenderWindow.h"
+#include "PimListenerList.h"
+#include "PimJobSystem.h"
+#include "PimCommandBuffer.h"
+#include "PimFrameStats.h"
 
 namespace Pim {
 	/**
@@ -28,15 +32,19 @@ namespace Pim {
 	class Layer;
 	class Scene;
 	
-#ifdef WIN32
-	typedef long long unsigned int 		Tick;
-#else
-	typedef long double 				Tick;
-#endif
+	// Seconds on a monotonic clock, see GameControl::GetTime()
+	typedef double 						Tick;
+
+	// The number of frame times used to calculate the frame time jitter
+	#define PIM_FRAME_HISTORY			120
+
+	// Input latency histogram buckets, one per millisecond
+	#define PIM_INPUT_LATENCY_BUCKETS	100
 
 	class GameControl {
 	private:
 		friend class RenderWindow;
+		friend class GameNode;
 
 	public:
 								GameControl();
@@ -44,12 +52,15 @@ namespace Pim {
 		static string			GetModulePath();
 		static GameControl*		GetSingleton();
 		static RenderWindow*	GetRenderWindow();
+		static JobSystem*		GetJobSystem();
+		static FrameStats*		GetFrameStats();
 		static const string&	GetWindowTitle();
 		static int				GetWindowWidth();
 		static int				GetWindowHeight();
 		static Vec2				GetWindowSize();
 		static Vec2				GetMouseOffset();
 		static Scene*			GetScene();
+		static Tick				GetTime();
 		WinStyle::CreationData	GetCreationData() const;
 		void					Go(Scene *s, WinStyle::CreationData data, bool commandline=true);
 		void					AddKeyListener(GameNode* n);
@@ -62,6 +73,17 @@ namespace Pim {
 		void					RemoveFrameListener(GameNode* n);
 		void					Exit();
 		void					LimitFrame(unsigned int maxfps);	// Pass 0 to set unlimited
+		void					SetFixedTimestep(float step, unsigned int maxSteps=5);	// Pass 0 to disable
+		float					GetFixedTimestep() const;
+		float					GetInterpolationAlpha() const;
+		float					GetAverageFrameTime() const;
+		float					GetFrameTimeJitter() const;
+		void					SetLowLatencyInput(bool flag);
+		bool					GetLowLatencyInput() const;
+		const unsigned int*		GetInputLatencyHistogram() const;
+		unsigned int			GetInputLatencySamples() const;
+		float					GetInputLatencyPercentile(float p) const;
+		void					ResetInputLatency();
 		void					Pause();	// You must return a pause layer from your Scene
 		void					Unpause();
 		void					SetWindowCreationData(WinStyle::CreationData data);
@@ -72,24 +94,49 @@ namespace Pim {
 		Vec2					GetCoordinateFactor();
 		void					SetScene(Scene *newScene);
 		void					AddNodeToDelete(GameNode *node);
+		void					SetDeleteBudget(float milliseconds);	// Pass 0 to set unlimited
+		float					GetDeleteBudget() const;
+		unsigned int			GetDeleteQueueSize() const;
 
 		void					SetMouseOffset(float offX, float offY);
 
 	private:
 		static GameControl		*singleton;
 		RenderWindow			*renderWindow;
+		JobSystem				*jobSystem;
+		FrameStats				*frameStats;
 		Scene					*scene;
 		Scene					*newScene;
-		vector<GameNode*>		frameListeners;
+		ListenerList			frameListeners;
+		vector<GameNode*>		parallelNodes;		// Frame listeners updated in parallel
+		vector<float>			parallelDeltas;		// The time step of each parallel node
+		unsigned int			updateTick;			// Number of update passes
+		vector<CommandBuffer>	parallelCommands;	// One buffer per job
 		vector<GameNode*>		delQueue;
+		float					deleteBudget;		// Seconds per frame, 0 if unlimited
+		float					deleteTimeLeft;		// Of the budget, this frame
+		bool					discardingScene;
 		string					modulePath;
 		bool					quit;
 		bool					paused;
 		Layer					*pauseLayer;
 		float					maxDelta;
+		float					fixedStep;			// 0 if variable time step
+		unsigned int			maxFixedSteps;		// Max steps per frame
+		float					accumulator;		// Unsimulated time
+		float					interpAlpha;		// accumulator / fixedStep
 		bool					sleepNextFrame;
 		float					sleepTime;
-		Tick 					ticks;
+		Tick 					ticks;				// Start of the current frame
+		float					frameTimes[PIM_FRAME_HISTORY];
+		int						frameTimeIdx;
+		int						frameTimeCount;
+		bool					lowLatencyInput;
+		float					inputDelay;			// Seconds the poll is delayed after a swap
+		bool					inputPending;		// Input was dispatched this frame
+		unsigned int			inputStamp;			// SDL timestamp of the oldest input event
+		unsigned int			latencyHistogram[PIM_INPUT_LATENCY_BUCKETS];
+		unsigned int			latencySamples;
 		WinStyle::CreationData	winData;
 		int						actualWinWidth;		// The values in winData does NOT apply if
 		int						actualWinHeight;	// the window style is BFS. Hence, these two.
@@ -98,10 +145,19 @@ namespace Pim {
 		void					GameLoop();
 		void					HandleEvents();
 		void					DispatchPrerender(float dt);
+		void					DispatchParallelUpdate(float dt);
+		void					DispatchFixedPrerender(float dt);
 		void					DispatchPausedPreRender(float dt);
 		void					DispatchPreRender_r(GameNode *n, float dt);
 		float					CalculateDeltaTime();
+		void					WaitUntil(Tick time);
+		void					RecordFrameTime(float dt);
+		float					Lap(Tick &mark);
+		void					RecordInputLatency();
+		void					AdjustInputDelay();
+		void					ProcessDeleteQueue();
 		void					ClearDeleteQueue();
+		void					DiscardScene(Scene *s);
 		void					SceneTransition();
 		void					ReloadTextures();
 	};
@@ -133,11 +189,111 @@ namespace Pim {
 	/**
 	 @fn  		GameControl::LimitFrame
 	 @brief 	Limit the framerate to @e maxfps.
+	 @details 	The remaining time of each frame is waited out by sleeping
+	 			until shortly before the deadline, and spinning the rest of
+	 			the way. The frame time is thus precise to well within a 
+	 			millisecond, at the cost of some CPU time. 
+
+	 			The limit is independent of vertical synchronization, see
+	 			RenderWindow::SetSwapInterval.
 	 
 	 @param maxfps	
 				The maximum allowed number of frames per second.
 	 */
+
+	/**
+	 @fn 		GameControl::GetTime
+	 @brief 	Seconds elapsed on a monotonic, high resolution clock.
+	 @details 	The epoch is undefined; only use the difference between
+	 			two values.
+	 */
+
+	/**
+	 @fn 		GameControl::GetFrameTimeJitter
+	 @brief 	The standard deviation (in seconds) of the last 
+	 			PIM_FRAME_HISTORY frame times.
+	 */
+
+	/**
+	 @fn 		GameControl::SetLowLatencyInput
+	 @brief 	Poll and dispatch input as late as possible before rendering.
+	 @details 	By default, input is polled at the start of the frame, before
+	 			the frame limiter waits out the remainder of the previous
+	 			frame. The rendered input is then up to a frame old. In low
+	 			latency mode, input is polled after the wait.
+
+	 			With vsync and no frame limit, the idle time of a frame is
+	 			spent blocking in the buffer swap. Low latency mode then
+	 			delays the poll after each swap, aiming to leave about two
+	 			milliseconds of the swap wait. The delay backs off at once
+	 			if frames get close to missing the retrace.
+
+	 			Disabled by default.
+	 */
+
+	/**
+	 @fn 		GameControl::GetInputLatencyHistogram
+	 @brief 	The input latencies measured since the last reset, as an
+	 			array of PIM_INPUT_LATENCY_BUCKETS counts.
+	 @details 	The latency of a frame is the time from the oldest input event
+	 			dispatched in the frame (as timestamped by SDL) until the
+	 			buffer swap has returned. Bucket i counts the latencies of i
+	 			milliseconds, and the last bucket all longer latencies.
+	 			Frames without input are not measured.
+	 */
+
+	/**
+	 @fn 		GameControl::GetInputLatencyPercentile
+	 @brief 	The latency (in seconds) which 'p' percent (0-100) of the
+	 			measured latencies do not exceed. Millisecond resolution.
+	 */
 	
+	/**
+	 @fn 		GameControl::SetFixedTimestep
+	 @brief 	Run the simulation (Update-calls) in fixed increments.
+	 @details 	The time elapsed each frame is added to an accumulator, and
+	 			Update(step) is dispatched once for every whole step in the
+	 			accumulator. One long frame thus results in several regular
+	 			steps rather than one huge step.
+
+	 			To avoid a spiral of death (each frame taking longer to
+	 			simulate than the last), at most @e maxSteps steps are run
+	 			per frame. Any time exceeding this is discarded, slowing the
+	 			game down rather than freezing it.
+
+	 			Input is dispatched once per frame regardless of the number
+	 			of steps. The game runs with a variable time step while paused.
+
+	 @param step
+	 			The length of a step in seconds. Pass 0 to revert to variable
+	 			time steps.
+	 @param maxSteps
+	 			The maximum number of steps simulated per frame.
+	 */
+
+	/**
+	 @fn 		GameControl::GetInterpolationAlpha
+	 @brief 	How far (0-1) the rendered frame is between the last simulated
+	 			step and the next one.
+	 @details 	Always 1 when the time step is variable. Nodes wishing to be
+	 			rendered smoothly should store their state from the previous
+	 			step, and draw at:
+	 @code
+	 			float a = GameControl::GetSingleton()->GetInterpolationAlpha();
+	 			Vec2 drawPos = prevPos + (position - prevPos) * a;
+	 @endcode
+	 */
+
+	/**
+	 @fn 		GameControl::GetJobSystem
+	 @brief 	Returns the JobSystem, or NULL if the game is not running.
+	 */
+
+	/**
+	 @fn 		GameControl::GetFrameStats
+	 @brief 	Returns the timings of the last frames. See FrameStats.
+	 */
+
 	/**
 	 @fn 		GameControl::SetScene
 	 @brief 	Transition to another scene.
@@ -239,6 +395,41 @@ namespace Pim {
 	 			but to you the object can be treated as deallocated.
 	 */
 	
+	/**
+	 @fn 		GameControl::SetDeleteBudget
+	 @brief 	Limit the time spent deleting nodes each frame.
+	 @details 	By default, the delete queue is emptied several times each frame.
+	 			Removing a large subtree may then cause a noticeable hitch. When
+	 			a budget is set, the queue is processed until the budget for the
+	 			current frame is spent, and the remaining nodes are deleted in the
+	 			following frames. At least one node is deleted each frame.
+
+	 			Queued nodes are inert: they are detached from their parent,
+	 			receive no input or Update-calls, and are removed from the
+	 			lighting system. Deferring their destruction is therefore safe.
+
+	 			Whole scenes are always discarded in full, regardless of the budget.
+	 */
+
+	/**
+	 @fn 		GameControl::GetDeleteQueueSize
+	 @brief 	The number of nodes awaiting destruction.
+	 */
+
+	/**
+	 @fn 		GameControl::ProcessDeleteQueue
+	 @brief 	Deletes objects in the delete queue until the budget for the
+	 			current frame is spent. Deletes all objects if no budget is set.
+	 */
+
+	/**
+	 @fn 		GameControl::DiscardScene
+	 @brief 	Deletes a scene and all of its nodes immediately.
+	 @details 	As the layers are going away, the nodes skip removing themselves
+	 			from the lighting systems of their layers, which otherwise requires
+	 			a scan of all lights and shadow casters for every node.
+	 */
+
 	/**
 	 @fn 		GameControl::ClearDeleteQueue
 	 @brief 	Deletes all object currently in the delete queue.
@@ -16,6 +16,14 @@
 #include "PimInternal.h"
 #include "PimVec2.h"
 #include "PimConsoleReader.h"
+#include "PimListenerList.h"
+#include "PimNodePool.h"
+#include "PimNodeList.h"
+#include "PimIdentifier.h"
+#include "PimBounds.h"
+#include "PimAssert.h"
+
+#include <algorithm>
 
 namespace Pim {
 	/**
@@ -53,20 +61,71 @@ namespace Pim {
 	class BaseAction;
 	class Action;
 
+	// The largest interval of UPDATE_EVERY_NTH_FRAME
+	#define PIM_MAX_UPDATE_INTERVAL		63
+
 	class GameNode : public ConsoleListener {
 	protected:
 		friend class GameControl;
 		friend class LightingSystem;
 		friend class Scene;
 		friend class Layer;
+		friend class ListenerList;
+		friend class SpatialIndex;
+		friend class Input;
+
+		// Grouped at the front of the node, as they are read every frame
+		GameNode			*parent;
+		int					zOrder;
+		unsigned int		dirtyZOrder		: 1;
+		unsigned int		willDelete		: 1;
+		unsigned int		dbgShadowShape	: 1;
+		unsigned int		indexed			: 1;	// In the identifier index of a scene
+		unsigned int		parallelUpdate	: 1;	// Update() is thread safe
+		unsigned int		asleep			: 1;	// SetSleeping(true) was called on this node
+		unsigned int		dormant			: 1;	// Frame listener parked by a sleeping subtree
+		unsigned int		drawn			: 1;	// Drawn since the last WHEN_VISIBLE update
+		unsigned int		updateRate		: 2;
+		unsigned int		updateInterval	: 6;
+		unsigned int		culled			: 1;	// Outside the view of a culling Layer
+		unsigned int		spatial			: 1;	// Inserted into a SpatialIndex
+		unsigned int		mouseHitTest	: 1;	// Mouse events are hit tested
+		unsigned int		kind			: 13;	// NodeKind-flags of the class and it's bases
+		Identifier			identifier;
+		unsigned int		sequence;		// Order of insertion, breaks z-order ties
+		float				updateDelta;	// Time accumulated since the last Update()
 
 	public:
-		float				rotation;
+		enum NodeKind {
+			KIND_LAYER				= 1 << 0,
+			KIND_SPRITE				= 1 << 1,
+			KIND_SPRITE_BATCH_NODE	= 1 << 2,
+			KIND_NORMAL_MAP			= 1 << 3,
+			KIND_PARTICLE_SYSTEM	= 1 << 4,
+			KIND_LABEL				= 1 << 5,
+			KIND_BUTTON				= 1 << 6,
+			KIND_SLIDER				= 1 << 7,
+			KIND_BASE_ACTION		= 1 << 8,
+			KIND_ACTION				= 1 << 9,
+			KIND_SPRITE_ACTION		= 1 << 10,
+			KIND_ACTION_QUEUE		= 1 << 11,
+		};
+		enum { NODE_KIND = 0 };
+
+		enum UpdateRate {
+			UPDATE_EVERY_FRAME,
+			UPDATE_EVERY_NTH_FRAME,
+			UPDATE_WHEN_VISIBLE,
+		};
+
 		Vec2				position;
-		vector<GameNode*>	children;
-		string				identifier;
+		float				rotation;
+		NodeList			children;
 		void*				userData;
 
+		static void*		operator new(size_t size);
+		static void			operator delete(void *ptr, size_t size);
+
 							GameNode();
 		virtual				~GameNode();
 		virtual void		Update(float dt)							{}
@@ -84,16 +143,36 @@ namespace Pim {
 		virtual void		RemoveAllChildren(bool cleanup=true);
 		virtual void 		RemoveFromParent(bool cleanup=true);
 		int 				ChildCount();
+		unsigned int		GetKind() const;
+		template<class T> T* As();
+		template<class T> const T* As() const;
+		void				SetIdentifier(const Identifier &id);
+		void				SetIdentifier(const string &id);
+		const Identifier&	GetIdentifier() const;
+		GameNode*			FindChild(const Identifier &id);
+		GameNode*			FindChild(const string &id);
+		void				FindChildren(const Identifier &id, vector<GameNode*> &nodes);
+		void				FindChildren(const string &id, vector<GameNode*> &nodes);
 		void				ListenInput();
 		void				UnlistenInput();
 		void				ListenKeys();
 		void				UnlistenKeys();
 		void				ListenMouse();
 		void				UnlistenMouse();
+		void				SetMouseHitTest(bool flag);
+		bool				GetMouseHitTest() const;
 		void				ListenController();
 		void				UnlistenController();
 		void				ListenFrame();
 		void				UnlistenFrame();
+		void				SetParallelUpdate(bool flag);
+		bool				GetParallelUpdate() const;
+		void				SetSleeping(bool flag);
+		bool				IsSleeping() const;
+		bool				IsAwake() const;
+		void				SetUpdateRate(UpdateRate rate, unsigned int interval=1);
+		UpdateRate			GetUpdateRate() const;
+		unsigned int		GetUpdateInterval() const;
 		virtual Vec2		GetWorldPosition() const;
 		virtual Vec2		GetLayerPosition() const;
 		virtual float		GetWorldRotation() const;
@@ -103,6 +182,14 @@ namespace Pim {
 		virtual void		SetZOrder(const int z);
 		int					GetZOrder() const;
 		void				OrderChildren();
+		virtual void		ApplyChildTransform();
+		virtual void		GetChildTransform(Transform2D &t) const;
+		virtual bool		GetContentBounds(const Transform2D &parent, AABB &bounds) const;
+		bool				GetLayerBounds(AABB &bounds) const;
+		bool				GetSubtreeBounds(AABB &bounds) const;
+		virtual bool		GetHitBounds(AABB &bounds) const;
+		bool				GetScreenBounds(AABB &bounds) const;
+		void				MarkMoved();
 		void				RunAction(Action *a);
 		void				RunActionQueue(ActionQueue *queue);
 		void				RemoveAllActions();
@@ -111,17 +198,122 @@ namespace Pim {
 		PolygonShape*		GetShadowShape() const;
 		virtual void		ReloadTextures();
 	protected:
-		bool				dirtyZOrder;
 		PolygonShape		*shadowShape;
-		bool				dbgShadowShape;
-		GameNode			*parent;
-		int					zOrder;
-		bool				willDelete;
+		int					listenSlot[ListenerList::TYPE_COUNT];	// -1 if not listening
+		AABB				subtreeBounds;	// Layer space bounds of the subtree, cached by culling
+		unsigned int		boundsKnown		: 1;	// No node in the subtree has unknown bounds
+		unsigned int		boundsDirty		: 1;	// The subtree bounds must be recomputed
+		unsigned int		moved			: 1;	// MarkMoved() was called on this node
+		unsigned int		cullState		: 2;	// CullState of the subtree as of the last culling
+
+		enum CullState {
+			CULL_PARTIAL,				// The children were culled one by one
+			CULL_INSIDE,				// The subtree was inside the view
+			CULL_OUTSIDE,				// The subtree was outside the view
+		};
+
+		static unsigned int	sequenceCounter;
+		static bool			drawingFlat;	// True while a Layer draws it's flattened draw list
+		static unsigned int	sleepCount;		// Number of nodes flagged asleep
+		static bool			cullingActive;	// True while a culling Layer draws
+
+		void				DrawChildren();
+		void				BatchDrawChildren();
+		Transform2D			GetNodeTransform(const Transform2D &parent) const;
+		void				GetLayerTransform(Transform2D &t) const;
+		void				MarkBoundsDirty();
+		static bool			CollectBounds(GameNode *node, const Transform2D &parent, AABB &bounds);
+		static void			CullSubtree(GameNode *node, const Transform2D &parent, bool moved,
+										const AABB &view);
+		static void			CullCached(GameNode *node, const AABB &view);
+		static CullState	ClassifyBounds(const GameNode *node, const AABB &view);
+		static bool			RenderKeyLess(const GameNode *a, const GameNode *b);
+		static void			SortByRenderKey(GameNode **first, GameNode **last);
+		template<class T, class Less>
+		static void			SortAdaptive(T *first, T *last, Less less,
+										 vector<T> &ordered, vector<T> &displaced);
 
 	private:
 		void				PrepareDeletion();
+		bool				IsAncestorOf(const GameNode *node) const;
+		bool				DeferListen(int type, bool listen);
+		void				SetSubtreeDormant(bool flag);
+		bool				ConsumeUpdate(float dt, unsigned int tick, float &delta);
+		void				InvalidateDrawList(bool rebuild);
 	};
+
+	/*
+	=====================
+	GameNode::As
+	=====================
+	*/
+	template<class T>
+	T* GameNode::As() {
+		T *node = ((kind & T::NODE_KIND) == T::NODE_KIND) ? static_cast<T*>(this) : NULL;
+
+#		ifdef _DEBUG
+			PimAssert(node == dynamic_cast<T*>(this),
+					  "Error: As<T>() used on a class without it's own NODE_KIND");
+#		endif /* _DEBUG */
+
+		return node;
+	}
+
+	/*
+	=====================
+	GameNode::As
+	=====================
+	*/
+	template<class T>
+	const T* GameNode::As() const {
+		return const_cast<GameNode*>(this)->As<T>();
+	}
+
+	/*
+	=====================
+	GameNode::SortAdaptive
+
+	The elements are split into an ordered run and the elements
+	breaking it. Only the latter are sorted, before the two are
+	merged. The cost is O(n + m log m), where m is (at most twice)
+	the number of elements out of order.
+	=====================
+	*/
+	template<class T, class Less>
+	void GameNode::SortAdaptive(T *first, T *last, Less less,
+								vector<T> &ordered, vector<T> &displaced) {
+		if (last - first <= 1) {
+			return;
+		}
+
+		ordered.clear();
+		displaced.clear();
+
+		for (T *it=first; it!=last; it++) {
+			if (ordered.empty() || !less(*it, ordered.back())) {
+				ordered.push_back(*it);
+			} else {
+				// Either of the two may be the one out of place
+				displaced.push_back(ordered.back());
+				displaced.push_back(*it);
+				ordered.pop_back();
+			}
+		}
+
+		if (displaced.empty()) {
+			return;
+		}
+
+		sort(displaced.begin(), displaced.end(), less);
+		merge(ordered.begin(), ordered.end(), displaced.begin(), displaced.end(),
+			  first, less);
+	}
 	
+	/**
+	 @fn 		GameNode::operator new
+	 @brief 	GameNodes and all derived classes are allocated from the NodePool.
+	 */
+
 	/**
 	 @fn		GameNode::Update
 	 @brief 	Called each frame on frame listening nodes.
@@ -129,6 +321,11 @@ namespace Pim {
 	 			by calling @e ListenFrame() at any point in it's existance.
 	 
 	 			A node can unschedule Update-calls by calling @e UnlistenFrame().
+
+	 			See @e SetParallelUpdate() for updating nodes in parallel. Note
+	 			that a parallel Update() can @b NOT create or delete nodes, and
+	 			thus not spawn actions, bullets or particles. Create them up
+	 			front on the main thread, or from a node which is not parallel.
 	 */
 	
 	/**
@@ -266,6 +463,21 @@ namespace Pim {
 	 @fn 		GameNode::UnlistenMouse
 	 @brief 	Stop recieving @e OnMouseEvent calls.
 	 */
+
+	/**
+	 @fn 		GameNode::SetMouseHitTest
+	 @brief 	Only receive @e OnMouseEvent calls when the cursor is over the
+	 			node.
+	 @details 	Hit tested mouse listeners are found by their screen bounds
+	 			(see GetHitBounds()) in a spatial index kept by Input, and the
+	 			listeners under the cursor are called top-most first. See
+	 			MouseEvent::IsOver() and MouseEvent::Consume(). The bounds
+	 			are refreshed once per frame, see Input::UpdateHitBounds().
+
+	 			A node also receives the event after the cursor has left it,
+	 			and every event while it has captured the mouse through
+	 			Input::CaptureMouse(). Buttons are hit tested by default.
+	 */
 	
 	/**
 	 @fn 		GameNode::ListenController
@@ -287,6 +499,73 @@ namespace Pim {
 	 @brief 	Stop receiving @e Update calls each frame.
 	 */
 	
+	/**
+	 @fn 		GameNode::SetParallelUpdate
+	 @brief 	Declare that Update() on this node is thread safe.
+	 @details 	GameControl first calls Update() on the frame listeners not
+	 			flagged, in the order they started listening. The flagged
+	 			frame listeners are then updated in parallel by the JobSystem.
+
+	 			A parallel Update() may freely modify it's own node, and read
+	 			other nodes which are not modified by the other parallel nodes.
+	 			Calls to AddChild(), RemoveChild(), RemoveAllChildren(),
+	 			RemoveFromParent(), SetZOrder(), SetSleeping(), MarkMoved(),
+	 			RunAction(), RunActionQueue() and the Listen- and Unlisten-
+	 			methods are deferred (see CommandBuffer), and executed on the
+	 			main thread once all the parallel nodes have been updated, in
+	 			the order of the listeners making them. The result is thus
+	 			independent of the number of threads.
+
+	 			@b Limitation: Nodes must not be created or deleted in a parallel
+	 			Update(), as the NodePool is not thread safe. This includes
+	 			actions, so a parallel node can only run actions which were
+	 			allocated on the main thread. Identifiers must not be interned
+	 			(see Identifier::Find()), and OpenGL must not be used. The former
+	 			two are asserted.
+
+	 			Not used while the game is paused.
+	 */
+
+	/**
+	 @fn 		GameNode::SetSleeping
+	 @brief 	Put the node and all it's descendants to sleep, or wake them.
+	 @details 	The frame listeners in a sleeping subtree are taken out of the
+	 			frame listener list, and cost nothing until they are woken.
+	 			Nodes added to a sleeping subtree fall asleep, and nodes
+	 			removed from one wake up, unless they are flagged asleep
+	 			themselves. A woken listener is updated after the listeners
+	 			which were awake.
+
+	 			Sleeping nodes are still drawn, and still receive input.
+	 */
+
+	/**
+	 @fn 		GameNode::IsSleeping
+	 @brief 	Returns true if SetSleeping(true) was called on this node.
+	 */
+
+	/**
+	 @fn 		GameNode::IsAwake
+	 @brief 	Returns false if this node or any of it's ancestors is sleeping.
+	 */
+
+	/**
+	 @fn 		GameNode::SetUpdateRate
+	 @brief 	Sets how often Update() is called on the node, if it listens
+	 			to frames.
+	 @details 	UPDATE_EVERY_FRAME is the default.
+
+	 			UPDATE_EVERY_NTH_FRAME calls Update() every 'interval' frames
+	 			(or fixed steps), at most PIM_MAX_UPDATE_INTERVAL. Nodes with the
+	 			same interval are spread evenly across the frames.
+
+	 			UPDATE_WHEN_VISIBLE calls Update() in the frames after the node
+	 			has been drawn.
+
+	 			When Update() is skipped, the time is accumulated, and passed
+	 			as 'dt' to the next Update().
+	 */
+
 	/**
 	 @fn 		GameNode::GetWorldPosition
 	 @brief 	Returns the position of this node relative to the @e absolute origin.
@@ -328,8 +607,119 @@ namespace Pim {
 	/**
 	 @fn 		GameNode::OrderChildren
 	 @brief 	Orders children based on their Z-order values.
+	 @details 	Children with equal Z-order are drawn in the order in which
+	 			they were added. Only the children which are out of order are
+	 			sorted, so reordering a few children of a large node is cheap.
+	 */
+
+	/**
+	 @fn 		GameNode::ApplyChildTransform
+	 @brief 	Applies the transformation which Draw() applies to the children
+	 			of this node to the current OpenGL matrix.
+	 @details 	Used by Layers drawing a flattened draw list. If you override
+	 			Draw() and change the way your node transforms it's children,
+	 			you must override this method as well.
+	 */
+
+	/**
+	 @fn 		GameNode::DrawChildren
+	 @brief 	Orders and draws the children of the node.
+	 @details 	Should be called by all Draw() implementations. When the node
+	 			is drawn as part of a flattened draw list, the children are
+	 			drawn by the Layer, and this method does nothing.
 	 */
 	
+	/**
+	 @fn 		GameNode::GetChildTransform
+	 @brief 	Applies the transformation of the children of this node to 't'.
+	 @details 	The CPU counterpart of ApplyChildTransform(), used to compute
+	 			bounding boxes. Override both, or neither.
+	 */
+
+	/**
+	 @fn 		GameNode::GetContentBounds
+	 @brief 	Computes the bounding box of what Draw() draws itself, excluding
+	 			the children.
+	 @details 	'parent' transforms the space of the parent's children to the
+	 			space of the box. Returns false if the bounds are unknown, in
+	 			which case the node is never culled.
+
+	 			GameNode returns false, as derived classes may draw anything.
+	 			Sprite, Label, ParticleSystem and SpriteBatchNode return their
+	 			bounds. Override this method in classes drawing nothing, or
+	 			drawing within known bounds, to let culling Layers skip them.
+	 */
+
+	/**
+	 @fn 		GameNode::GetLayerBounds
+	 @brief 	Computes the bounds of the node itself in the coordinates of
+	 			it's layer. Returns false if the bounds are unknown.
+	 */
+
+	/**
+	 @fn 		GameNode::GetSubtreeBounds
+	 @brief 	Computes the bounds of the node and all it's descendants in the
+	 			coordinates of it's layer. Returns false if the bounds of any
+	 			node in the subtree are unknown, in which case 'bounds' holds
+	 			the bounds of the rest of the subtree.
+	 */
+
+	/**
+	 @fn 		GameNode::GetHitBounds
+	 @brief 	The area of the layer in which the cursor is over the node.
+	 			Returns the subtree bounds by default, leaving out the nodes
+	 			with unknown bounds, and false if the area is empty.
+	 */
+
+	/**
+	 @fn 		GameNode::GetScreenBounds
+	 @brief 	The hit bounds transformed to the coordinates of
+	 			MouseEvent::GetPosition().
+	 */
+
+	/**
+	 @fn 		GameNode::MarkMoved
+	 @brief 	Tell culling layers that the bounds of the node have changed.
+	 @details 	Layers with culling enabled (see Layer::SetCulling()) cache the
+	 			bounds of every subtree, and only recompute the subtrees which
+	 			have been marked. Call this after assigning the position,
+	 			rotation or scale of a node, or anything else changing what it
+	 			draws (such as Sprite::rect, Sprite::anchor or Sprite::hidden),
+	 			in a culling layer. A node which is not marked may be culled by
+	 			it's old bounds.
+
+	 			AddChild(), RemoveChild(), the actions and the built-in classes
+	 			mark the nodes they change themselves. Deferred while recording
+	 			a CommandBuffer.
+	 */
+
+	/**
+	 @fn 		GameNode::CollectBounds
+	 @brief 	Computes the subtree bounds of 'node'. Nested layers are
+	 			unbounded, and actions are ignored.
+	 */
+
+	/**
+	 @fn 		GameNode::CullSubtree
+	 @brief 	Recomputes the cached bounds of the marked nodes in the subtree,
+	 			and flags the nodes outside of the view as culled. If 'moved'
+	 			is true, the transformation of the subtree has changed, and
+	 			every cached bound in it is recomputed. An unbounded node is
+	 			never culled, but it's children may be.
+	 */
+
+	/**
+	 @fn 		GameNode::CullCached
+	 @brief 	Culls a subtree with valid cached bounds. Subtrees which were,
+	 			and still are, entirely inside or outside of the view are not
+	 			walked into, as the culled-flags in them are still correct.
+	 */
+
+	/**
+	 @fn 		GameNode::BatchDrawChildren
+	 @brief 	Orders the children of the node and calls BatchDraw() on them.
+	 */
+
 	/**
 	 @fn 		GameNode::RunAction
 	 @brief 	Run an action on a GameNode. 
@@ -369,6 +759,52 @@ namespace Pim {
 	 			all textures, shaders and FBO's must be re-created.
 	 */
 	
+	/**
+	 @fn 		GameNode::SetIdentifier
+	 @brief 	Name the node, so it can be found by FindChild() and
+	 			Scene::FindNode(). Identifiers need not be unique. The string
+	 			overload interns the name, see Identifier.
+	 */
+
+	/**
+	 @fn 		GameNode::FindChild
+	 @brief 	Returns a node below this node with the given identifier,
+	 			or NULL if there is none.
+	 @details 	When the node is attached to a Scene, the lookup is done in the
+	 			identifier index of the scene. Only the ancestors of the nodes
+	 			with the identifier are visited. Detached subtrees are searched
+	 			depth first.
+
+	 			The string overload does not intern the name, so an unknown
+	 			name returns NULL without touching the identifier table. It
+	 			may be used from a parallel Update().
+	 */
+
+	/**
+	 @fn 		GameNode::FindChildren
+	 @brief 	Appends all nodes below this node with the given identifier
+	 			to 'nodes'.
+	 */
+
+	/**
+	 @fn 		GameNode::As
+	 @brief 	Returns this node as a T, or NULL if the node is not a T.
+	 @details 	A cheaper alternative to dynamic_cast. Every class eligible as T
+	 			declares its own flag from NodeKind as NODE_KIND, and sets it
+	 			in its constructors. The cast is then a test of the kind-flags
+	 			of the node:
+
+	 @code
+	 			if (Sprite *sprite = node->As<Sprite>()) {
+	 				sprite->color.a = 0.5f;
+	 			}
+	 @endcode
+
+	 			Classes inheriting the NODE_KIND of their base cannot be used as T,
+	 			as every instance of the base would match. In debug builds, the
+	 			result is verified against dynamic_cast.
+	 */
+
 	/**
 	 @fn 		GameNode::PrepareDeletion
 	 @brief 	Prepares the node for it's inevitable demise.
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "PimInternal.h"
+
+namespace Pim {
+	/**
+	 @class 		Identifier
+	 @brief 		An interned string, stored as a 32 bit ID.
+	 @details 		Every distinct string assigned to an Identifier is stored once
+	 				in a global table, and the Identifier only holds the index of
+	 				the string. Comparing two Identifiers is an integer comparison.
+
+	 				Identifiers convert to strings implicitly, and compare with
+	 				strings without interning them:
+
+	 				@code
+	 				node->SetIdentifier("player");
+	 				if (node->GetIdentifier() == "player") {
+	 					cout << node->GetIdentifier().GetString() << endl;
+	 				}
+	 				@endcode
+
+	 				Interned strings are never released. Identifiers are meant for
+	 				names, not for arbitrary text. Only constructing or assigning an
+	 				Identifier from a string interns it; comparisons and Find() leave
+	 				the table untouched. Interning is not thread safe, and must not
+	 				be done from a parallel GameNode::Update(), which is asserted.
+	 */
+
+	class Identifier {
+	public:
+		static unsigned int		Intern(const string &str);
+		static const string&	Lookup(unsigned int id);
+		static Identifier		Find(const string &str);
+
+								Identifier();
+		explicit				Identifier(const char *str);
+		explicit				Identifier(const string &str);
+		Identifier&				operator=(const char *str);
+		Identifier&				operator=(const string &str);
+		bool					operator==(const Identifier &other) const	{ return id == other.id; }
+		bool					operator!=(const Identifier &other) const	{ return id != other.id; }
+		bool					operator==(const char *str) const;
+		bool					operator!=(const char *str) const			{ return !(*this == str); }
+		bool					operator==(const string &str) const;
+		bool					operator!=(const string &str) const			{ return !(*this == str); }
+		bool					operator<(const Identifier &other) const	{ return id < other.id; }
+								operator const string&() const;
+		const string&			GetString() const;
+		unsigned int			GetID() const								{ return id; }
+		bool					IsEmpty() const								{ return id == 0; }
+
+	private:
+		static map<string,unsigned int>		table;
+		static vector<const string*>		strings;
+
+		unsigned int			id;
+	};
+
+	/**
+	 @fn 			Identifier::Intern
+	 @brief 		Returns the ID of the string, adding it to the table if needed.
+	 				The empty string always has the ID 0.
+	 */
+
+	/**
+	 @fn 			Identifier::Lookup
+	 @brief 		Returns the string with the given ID.
+	 */
+
+	/**
+	 @fn 			Identifier::Find
+	 @brief 		Returns the Identifier of an interned string, without adding
+	 				it to the table. Strings that were never interned give the
+	 				empty Identifier.
+	 */
+
+	/**
+	 @fn 			Identifier::operator==(const string&)
+	 @brief 		Compares the string of the Identifier, without interning
+	 				the other string.
+	 */
+
+	/**
+	 @fn 			Identifier::operator<
+	 @brief 		Orders Identifiers by ID, not alphabetically.
+	 */
+}
@@ -3,10 +3,17 @@
 #include <string>
 #include <map>
 
+#include "PimListenerList.h"
+#include "PimInputRecorder.h"
+
 namespace Pim {
 	class Input;
 	class Vec2;
 	class GameControl;
+	class SpatialIndex;
+
+	// A handle to a named key binding, see Input::GetBinding()
+	typedef int KeyBinding;
 	
 	
 	/**
@@ -40,24 +47,55 @@ namespace Pim {
 		bool							IsKeyFresh(const KeyCode k) const;
 		bool							IsKeyDown(const string str) const;
 		bool							IsKeyFresh(const string str) const;
+		bool							IsKeyDown(const KeyBinding b) const;
+		bool							IsKeyFresh(const KeyBinding b) const;
 		int								KeyCount() const;
 
 	private:
+		struct Action {
+			vector<KeyCode>				keys;
+			int							buttons;		// ControllerEvent::Xbox-flags
+		};
+
 		bool							activePrevFrame;
+		bool							actionsActive;	// An action is or was down
 		int								count;
 		//bool							keys[256];
 		//bool							fresh[256];	
 		unsigned						keyField[16];	// Holds 512 bits (512 keys)
 		unsigned						freshField[16];	
-		map<string,KeyCode>				binds;
+		map<string,KeyBinding>			binds;
+		vector<Action>					actions;
+		vector<unsigned>				actionDown;		// One bit per binding
+		vector<unsigned>				actionFresh;
 
 										KeyEvent();
 										KeyEvent(const KeyEvent&);
 		void							Reset();
 		void							Unfresh();
+		KeyBinding						GetBinding(const string &str);
+		KeyBinding						FindBinding(const string &str) const;
 		void							BindKey(const string &str, const KeyCode k);
+		void							AddKey(const string &str, const KeyCode k);
+		void							AddButtons(const string &str, int buttons);
 		void							UnbindKey(const string &str);
+		void							UpdateActions(int buttons, int prevButtons);
 	};
+
+	/**
+	 @fn 			KeyEvent::IsKeyDown
+	 @brief 		Returns true if any key or controller button bound to the
+	 				binding is down. Unknown bindings are never down.
+	 @details 		The bindings are evaluated once per frame, before the key
+	 				listeners are called. Querying a KeyBinding is a single bit
+	 				test, while querying by name looks the binding up first.
+	 */
+
+	/**
+	 @fn 			KeyEvent::IsKeyFresh
+	 @brief 		Returns true if any key or controller button bound to the
+	 				binding was pressed this frame.
+	 */
 	
 	
 	/**
@@ -90,9 +128,16 @@ namespace Pim {
 		bool							IsKeyFresh(const MouseButton mb) const;
 		Vec2							GetPosition() const;
 		Vec2							GetRelative() const;
+		bool							IsHitTested() const;
+		bool							IsOver() const;
+		void							Consume();
+		bool							IsConsumed() const;
 
 	private:
 		bool							dirty;
+		bool							hitTested;				// Delivered by hit testing
+		bool							over;					// The cursor is over the listener
+		bool							consumed;
 		bool							keys[7];
 		bool							fresh[7];
 		Vec2							position;
@@ -110,6 +155,25 @@ namespace Pim {
 	 @brief 		Passed to Controller-Listeners.
 	 @details 		Contains data on buttons and analog sticks. 
 	 */
+	/**
+	 @fn 			MouseEvent::IsHitTested
+	 @brief 		True if the event is delivered to a hit tested listener (see
+	 				GameNode::SetMouseHitTest()).
+	 */
+
+	/**
+	 @fn 			MouseEvent::IsOver
+	 @brief 		True if the cursor is over the hit tested listener, and no
+	 				listener above it has consumed the event.
+	 */
+
+	/**
+	 @fn 			MouseEvent::Consume
+	 @brief 		Hides the cursor from the hit tested listeners below the
+	 				current one. They still receive the event, but IsOver()
+	 				returns false.
+	 */
+
 	class ControllerEvent {
 	private:
 		friend class Input;
@@ -188,21 +252,41 @@ namespace Pim {
 
 	public:
 		static Input*					GetSingleton();
+		KeyBinding						GetBinding(const string id);
 		void							BindKey(const string id, const KeyEvent::KeyCode key);
+		void							AddKeyBinding(const string id, const KeyEvent::KeyCode key);
+		void							AddControllerBinding(const string id, ControllerEvent::Xbox button);
 		void							UnbindKey(const string id);
 		void							VibrateXbox(float leftVib, float rightVib);		
+		void							CaptureMouse(GameNode *node);
+		GameNode*						GetMouseCapture() const;
+		void							UpdateHitBounds(GameNode *node);
+		bool							StartRecording(const string &file);
+		void							StopRecording();
+		bool							IsRecording() const;
+		bool							StartReplay(const string &file, bool exitWhenDone=false);
+		void							StopReplay();
+		bool							IsReplaying() const;
 
 	private:
 		static Input					*singleton;
-		vector<GameNode*>				kl;						// key listeners
-		vector<GameNode*>				ml;						// mouse listeners
-		vector<GameNode*>				cl;						// control listeners
+		ListenerList					kl;						// key listeners
+		ListenerList					ml;						// mouse listeners
+		ListenerList					cl;						// control listeners
 		KeyEvent						keyEvent;
 		MouseEvent						mouseEvent;
 		ControllerEvent					contEvent;
+		SpatialIndex					*hitIndex;				// Hit tested mouse listeners
+		vector<GameNode*>				mouseHits;				// Hit tested listeners under the cursor
+		vector<GameNode*>				mouseOver;				// Listeners the cursor was over
+		GameNode						*mouseCapture;
+		InputRecorder					recorder;
+		vector<InputRecorder::Event>	replayEvents;
+		bool							exitAfterReplay;
         
 										Input();
-										Input(const Input&) {}
+										Input(const Input&);
+										~Input();
 	
 		void							KeyPressed(int button);		
 		void							KeyReleased(int button);		
@@ -224,8 +308,94 @@ namespace Pim {
 		void							DispatchPaused(GameNode *l);
 		void							Dispatch();
 		void							Dispatch_r(GameNode *n, bool controller);
+		void							RefreshHitBounds();
+		void							DispatchMouseHits();
+		void							DeliverMouse(GameNode *n, bool over);
+		static bool						DrawnAbove(GameNode *a, GameNode *b);
+		void							RecordState();
+		void							RecordFrame(float dt);
+		bool							ReplayFrame(float &dt);
 	};
+
+	/**
+	 @fn 			Input::StartRecording
+	 @brief 		Records all input to 'file', until StopRecording() is called
+	 				or the game exits. Returns false if the file could not be
+	 				created.
+	 @details 		The input of each frame is written along with the frame's
+	 				time step. The current state of the keys, mouse and
+	 				controller is recorded first, but recordings are best
+	 				started before the first scene is created.
+
+	 				The random seed is reset with srand(), and stored in the
+	 				file. Games using rand() (or Pim::RandomFloat()) replay
+	 				identically, as long as they draw random numbers in the
+	 				same order.
+	 */
+
+	/**
+	 @fn 			Input::StartReplay
+	 @brief 		Replays a file created by StartRecording(). Returns false if
+	 				the file could not be read.
+	 @details 		The live input is ignored during the replay, and each frame
+	 				is run with the recorded time step without waiting for the
+	 				frame limit. The measured frame times (see
+	 				GameControl::GetAverageFrameTime()) are unaffected, which
+	 				makes a replay a repeatable benchmark.
+	 @param 		exitWhenDone
+	 				Exit the game when the replay ends, rather than returning
+	 				to live input.
+	 */
+
+	/**
+	 @fn 			Input::GetBinding
+	 @brief 		Returns the handle of the named binding, creating an empty
+	 				binding if it does not exist.
+	 @details 		Resolve the bindings once, and query the handles with
+	 				KeyEvent::IsKeyDown(KeyBinding). Handles remain valid for
+	 				the lifetime of Input, even if the binding is unbound.
+	 				@code
+	 				jump = Input::GetSingleton()->GetBinding("jump");
+	 				...
+	 				if (evt.IsKeyFresh(jump)) { ... }
+	 				@endcode
+	 */
+
+	/**
+	 @fn 			Input::BindKey
+	 @brief 		Binds the key to the binding, replacing any keys and buttons
+	 				bound to it.
+	 */
+
+	/**
+	 @fn 			Input::AddKeyBinding
+	 @brief 		Adds a key to the binding. The binding is down while any of
+	 				it's keys or buttons are.
+	 */
+
+	/**
+	 @fn 			Input::AddControllerBinding
+	 @brief 		Adds a controller button to the binding.
+	 */
+
+	/**
+	 @fn 			Input::CaptureMouse
+	 @brief 		Deliver every mouse event to 'node', regardless of where the
+	 				cursor is. Pass NULL to release the capture.
+	 @details 		Used by hit tested listeners which must see the mouse
+	 				buttons being released after a drag, such as Button.
+	 */
 	
+	/**
+	 @fn 			Input::UpdateHitBounds
+	 @brief 		Re-index a hit tested listener whose hit bounds have changed.
+	 @details 		The hit bounds of all hit tested listeners are refreshed once
+	 				per frame with mouse input, before the input is dispatched.
+	 				Call this method when a listener changes it's bounds while
+	 				the input is dispatched. Button does so when it changes
+	 				sprite. Does nothing if the node is not hit tested.
+	 */
+
 	/**
 	 @fn			Input::Dispatch_r
 	 @brief 		Recursive dispatch of input. Used when the game is paused.
@@ -16,6 +16,7 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <unordered_map>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -24,6 +24,8 @@ namespace Pim {
 
 	class Label : public GameNode {
 	public:
+		enum { NODE_KIND = KIND_LABEL };
+
 		enum TextAlignment {
 			TEXT_LEFT,
 			TEXT_CENTER,
@@ -46,6 +48,9 @@ namespace Pim {
 		Vec2							GetDimensions() const;
 		void							Draw();
 		void							BatchDraw();
+		void							ApplyChildTransform();
+		void							GetChildTransform(Transform2D &t) const;
+		bool							GetContentBounds(const Transform2D &parent, AABB &bounds) const;
 		void							GiveOwnershipOfFont();
 
 	protected:
@@ -2,6 +2,7 @@
 
 #include "PimInternal.h"
 #include "PimRenderTexture.h"
+#include "PimVisibilityPolygon.h"
 
 namespace Pim {
 	/**
@@ -42,13 +43,64 @@ namespace Pim {
 
 					@b Normalmaps
 
-					Each lighting system may contain several normal-maps. However,
-					only 10 lights can @e affect the normal map may be used at 
-					any given time in a particular lighting system.
+					Each lighting system may contain several normal-maps, and any
+					number of lights may affect them. 
 
 					After adding a light to the lighting system, call 
 					'SetNormalLighting(GameNode *light, bool flag)' to enable or
 					disable normal map affection.
+
+					The normal-map lights are culled on the CPU every frame. The
+					area covered by the lights is divided into square tiles, and
+					each tile holds a list of the lights reaching it. The lists are
+					uploaded as float textures, and the normal-map shader only 
+					iterates the lights touching the tile of the current fragment. 
+					The per-pixel cost is thus bound by the local light density, 
+					not the total number of lights. The tile size can be tweaked 
+					through 'SetNormalLightTileSize(float size)'.
+
+					@b Smooth @b shadows
+
+					When smooth shadows are enabled, the light texture is blurred
+					before being rendered. By default a separable gaussian blur
+					is performed at the full resolution of the lighting system.
+					'SetSmoothShadowQuality()' selects a dual filter blur instead,
+					where the light texture is downsampled to half, quarter (and
+					eighth) resolution and blurred back up the chain. The result 
+					is about as soft as the gaussian blur, at a fraction of the 
+					fragment cost. Higher qualities use more levels, and are 
+					softer - and more expensive.
+
+					@b Shadow @b modes
+
+					By default, shadows are rendered by filling the stencil buffer
+					with a quad behind each edge facing the light. The cost of this
+					grows with the number of edges near each light. 
+					'SetShadowMode(SHADOW_POLAR)' instead builds a polar shadow map
+					for each light: the distance to the closest edge is stored for
+					a fixed number of angles around the light, and the light quad 
+					is shaded by comparing each fragment's distance to the map. 
+					The GPU cost is then independent of the number of edges. 
+
+					'SetShadowMode(SHADOW_VISIBILITY)' computes the visibility 
+					polygon (see VisibilityPolygon) of each light on the CPU, 
+					spread across the JobSystem's workers, and renders the light texture
+					as a single triangle fan. There is no overdraw and the stencil
+					buffer is not used. The polygon of a light can be retrieved 
+					through 'GetVisibilityPolygon(GameNode *light)'.
+
+					@b Light @b texture @b cache
+
+					Light textures are shared between all lights (in all lighting
+					systems) with identical defining parameters. The cache key is
+					the light type, radius, inner and outer color, and falloff
+					(flat lights) or inner passes (smooth lights). Adding 500 
+					identical torches renders one texture, not 500.
+
+					Cached textures are reference counted by the LightDefs using
+					them. Unreferenced textures are kept around for reuse until 
+					more than 'SetLightTextureCacheSize(n)' of them exist, at which
+					point the least recently used ones are deleted.
 	 */
 
 	
@@ -62,11 +114,28 @@ namespace Pim {
 	class LightingSystem {
 	protected:
 		friend class Layer;
+		friend struct LightDef;
 	
 	public:
+		enum SmoothShadowQuality {
+			SMOOTH_GAUSS,				// Full resolution gaussian blur
+			SMOOTH_DUAL_LOW,			// Dual filter: 1/2
+			SMOOTH_DUAL_MEDIUM,			// Dual filter: 1/2, 1/4
+			SMOOTH_DUAL_HIGH,			// Dual filter: 1/2, 1/4, 1/8
+		};
+
+		enum ShadowMode {
+			SHADOW_STENCIL,				// Stencil quads behind facing edges
+			SHADOW_POLAR,				// 1D polar shadow map per light
+			SHADOW_VISIBILITY,			// CPU computed visibility polygon per light
+		};
 
 		static void						CreateSmoothLightTexture(LightDef *lDef, bool preload=false);
 		static void						CreateFlatLightTexture(LightDef *lDef, bool preload=false);
+		static void						AcquireLightTexture(LightDef *lDef);
+		static void						SetLightTextureCacheSize(unsigned maxUnused);
+		static void						PurgeLightTextureCache();
+		static int						GetLightTextureCacheCount();
 
 										LightingSystem(Layer*, Vec2 resolution);
 										~LightingSystem();
@@ -77,12 +146,18 @@ namespace Pim {
 		void							SetLightAlpha(float a);
 		void							SetCastShadows(bool flag);
 		void							SetDebugDrawShadowShapes(bool flag);
+		void							SetSmoothShadowQuality(SmoothShadowQuality quality);
+		void							SetShadowMode(ShadowMode mode);
+		const vector<GameNode*>&		GetShadowCasters() const;
+		const VisibilityPolygon*		GetVisibilityPolygon(GameNode *light) const;
 
 		void							AddLight(GameNode *node, LightDef *lDef);
 		void							AddShadowCaster(GameNode *caster);
 		void							RemoveLight(GameNode *light);
 		void							RemoveShadowCaster(GameNode *caster);
 		bool							SetNormalLighting(GameNode *light, bool flag);
+		void							SetNormalLightTileSize(float size);
+		void							BindNormalLightTiles();
 
 		void							PreloadTexture(LightDef *lDef, const string identifier);
 		bool							UsePreloadedTexture(LightDef *lDef, const string identifier);
@@ -90,13 +165,53 @@ namespace Pim {
 
 		void							LoadShaders();
 		virtual void					UpdateShaderUniforms();
+		void							BuildNormalLightTiles();
 		virtual void					RenderLightTexture();
 		void							GaussPass();
+		void							DualFilterPass();
 		virtual void					RenderLights();
 		virtual void					RenderShadows(LightDef *d,  GameNode *n, 
 														const Vec2 &p, const Vec2 &rResSc);
+		void							RenderLightsPolar();
+		void							RenderLightsVisibility();
+		void							BuildPolarShadowMap(const Vec2 &p, const Vec2 &extent,
+														GLfloat *row);
 
 	protected:
+		/* Parameters defining the contents of a light texture */
+		struct LightTexKey {
+			short						lightType;
+			float						radius;
+			float						falloff;
+			int							innerPasses;
+			Color						innerColor;
+			Color						outerColor;
+
+										LightTexKey(const LightDef *lDef);
+			bool						operator<(const LightTexKey &o) const;
+		};
+
+		/* An edge in the polar space of one light */
+		struct PolarEdge {
+			Vec2						n1;			// The start of the edge
+			Vec2						e;			// The start to the end of the edge
+			float						s1, s2;		// The part in range, in [0,1]
+		};
+
+		/* A cached light texture and the LightDefs referencing it */
+		struct LightTexEntry {
+			GLuint						tex;
+			float						radius;		// The radius after rendering
+			int							refs;
+			unsigned					lastUse;
+		};
+
+		static map<LightTexKey,LightTexEntry>	texCache;
+		static unsigned					texCacheMaxUnused;
+		static unsigned					texCacheClock;
+
+		static void						ReleaseLightTexture(GLuint tex);
+		static void						EvictLightTextures(unsigned maxUnused);
 
 		static int						numSystemsCreated;
 
@@ -112,9 +227,35 @@ namespace Pim {
 		Color							color;			// Color of the unlit areas
 		RenderTexture					*mainRT;
 		RenderTexture					*gaussRT;
+		SmoothShadowQuality				smoothQuality;
+		vector<RenderTexture*>			dualRT;			// Downsample chain
+		vector<Vec2>					dualRes;		// Resolution of each dualRT
+		ShadowMode						shadowMode;
+		GLuint							polarTex;		// Polar shadow maps
+		vector<GLfloat>					polarData;
+		vector<Vec2>					polarNormals;	// The normal of each edge in visSegments
+		vector<PolarEdge>				polarEdges;		// The edges clipped to one light
+		map<GameNode*,VisibilityPolygon> visPolys;		// Light visibility polygons
+		vector<Vec2>					visSegments;	// Caster edges, in pairs
 		Shader							*shaderLightTex;
 		Shader							*shaderGauss;
 		Shader							*shaderNormalMap;
+		Shader							*shaderDualDown;
+		Shader							*shaderDualUp;
+		Shader							*shaderPolar;
 		map<string, GLuint>				preloadTex;
+
+		/* Tiled normal-map lighting */
+		float							tileSize;		// Requested tile size
+		float							tileSizeUsed;	// Tile size after clamping
+		Vec2							tileOrigin;		// Layer-space origin of the grid
+		int								tilesX;
+		int								tilesY;
+		int								tileListRows;
+		GLuint							tileGridTex;	// (offset, count) per tile
+		GLuint							tileListTex;	// Light positions per tile
+		vector<GLfloat>					tileGridData;
+		vector<GLfloat>					tileListData;
+		vector<int>						tileCounts;
 	};
 }
\ No newline at end of file
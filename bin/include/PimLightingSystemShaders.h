@@ -62,45 +62,127 @@ void main() {																			\n\
 	gl_FragColor = color;																\n\
 }"
 
+// Dual filter blur (Marius Bjorge, "Bandwidth-Efficient Rendering", 
+// SIGGRAPH 2015). The downsample pass halves the resolution, and the
+// upsample pass doubles it, blurring the texture along the way.
+#define PIM_LS_DUAL_DOWN_FRAG													 "\
+uniform sampler2D tex;																	\n\
+uniform vec2 halfpixel;	// Half a texel of the source texture							\n\
+																						\n\
+void main() {																			\n\
+	vec2 uv = gl_TexCoord[0].xy;														\n\
+	vec4 sum = texture2D(tex, uv) * 4.0;												\n\
+	sum += texture2D(tex, uv - halfpixel);												\n\
+	sum += texture2D(tex, uv + halfpixel);												\n\
+	sum += texture2D(tex, uv + vec2(halfpixel.x, -halfpixel.y));						\n\
+	sum += texture2D(tex, uv - vec2(halfpixel.x, -halfpixel.y));						\n\
+	gl_FragColor = sum / 8.0;															\n\
+}"
+
+#define PIM_LS_DUAL_UP_FRAG														 "\
+uniform sampler2D tex;																	\n\
+uniform vec2 halfpixel;	// Half a texel of the source texture							\n\
+uniform float composite;	// 1.0 when rendering to the screen							\n\
+uniform float lalpha;																	\n\
+uniform vec4 ulcolor;																	\n\
+																						\n\
+float length(vec4 v)																	\n\
+{																						\n\
+	return sqrt(v.x*v.x + v.y*v.y + v.z*v.z);											\n\
+}																						\n\
+																						\n\
+void main() {																			\n\
+	vec2 uv = gl_TexCoord[0].xy;														\n\
+	vec4 sum = texture2D(tex, uv + vec2(-halfpixel.x * 2.0, 0.0));						\n\
+	sum += texture2D(tex, uv + vec2(-halfpixel.x, halfpixel.y)) * 2.0;					\n\
+	sum += texture2D(tex, uv + vec2(0.0, halfpixel.y * 2.0));							\n\
+	sum += texture2D(tex, uv + vec2(halfpixel.x, halfpixel.y)) * 2.0;					\n\
+	sum += texture2D(tex, uv + vec2(halfpixel.x * 2.0, 0.0));							\n\
+	sum += texture2D(tex, uv + vec2(halfpixel.x, -halfpixel.y)) * 2.0;					\n\
+	sum += texture2D(tex, uv + vec2(0.0, -halfpixel.y * 2.0));							\n\
+	sum += texture2D(tex, uv + vec2(-halfpixel.x, -halfpixel.y)) * 2.0;					\n\
+	vec4 color = sum / 12.0;															\n\
+	if (composite > 0.5) {																\n\
+		color.a -= (length(color)-length(ulcolor))*lalpha*3.0;							\n\
+	}																					\n\
+	gl_FragColor = color;																\n\
+}"
+
+// Shades a light quad using a polar shadow map. The map holds the
+// distance (1.0 = edge of the quad) to the closest occluder for each angle.
+#define PIM_LS_POLAR_FRAG														 "\
+uniform sampler2D tex;		// The light texture										\n\
+uniform sampler2D polarMap;	// Occluder distance per angle, one row per light			\n\
+uniform float row;			// The row of this light, negative if not shadowed			\n\
+																						\n\
+void main() {																			\n\
+	if (row >= 0.0) {																	\n\
+		vec2 d = gl_TexCoord[0].xy * 2.0 - vec2(1.0);									\n\
+		float angle = atan(d.y, d.x);													\n\
+		float occ = texture2D(polarMap, vec2(angle / 6.2831853 + 0.5, row)).r;			\n\
+		if (length(d) > occ) {															\n\
+			discard;																	\n\
+		}																				\n\
+	}																					\n\
+	gl_FragColor = texture2D(tex, gl_TexCoord[0].xy) * gl_Color;						\n\
+}"
+
 #define PIM_LS_NORMALMAP_FRAG															 "\
 uniform sampler2D 	tex0; 		// The sprite texture									\n\
 uniform sampler2D 	tex1;		// The normal texture									\n\
+uniform sampler2D	tileGrid;	// (offset, count) of each tile							\n\
+uniform sampler2D	tileList;	// The light positions of all tiles						\n\
 uniform vec2 		dims;		// The dimension of the texture							\n\
 uniform vec2 		wpos;		// The world position of the sprite						\n\
 uniform vec2 		anchor;		// The anchor of the Sprite								\n\
-uniform int			numLights;	// The amount of lights									\n\
-uniform vec2 		lpos[10];	// The light positions									\n\
-uniform float 		lrad[10];	// The light radius'									\n\
+uniform vec2		gridOrigin;	// Layer-space origin of the tile grid					\n\
+uniform vec2		gridSize;	// Number of tiles in X and Y							\n\
+uniform float		tileSize;	// Size of a tile										\n\
+uniform float		listWidth;	// The width of the tile list texture					\n\
+uniform float		listRows;	// The height of the tile list texture					\n\
+uniform float		range;		// Distance at which a light no longer affects			\n\
 																						\n\
 void main() {																			\n\
 	vec4 finalColor = vec4(0.0, 0.0, 0.0, 0.0);											\n\
 																						\n\
-	/* Iterate over all the colors */													\n\
- 	for (int i=0; i<numLights; i++) {													\n\
+	/* Get the normal of the normal-map */												\n\
+	vec4 color = texture2D(tex1, gl_TexCoord[0].xy);									\n\
+	vec3 norm = normalize((color.xyz * 2.0) + vec3(-1.0));								\n\
+																						\n\
+	/* Get the color of the image texture */											\n\
+	vec4 image = texture2D(tex0, gl_TexCoord[0].xy);									\n\
+																						\n\
+	/* Find the tile containing this fragment */										\n\
+	vec2 fpos = wpos - (anchor * dims) + gl_TexCoord[0].xy * dims;						\n\
+	vec2 tile = floor((fpos - gridOrigin) / tileSize);									\n\
 																						\n\
-		/* Get the normal of the normal-map */											\n\
-		vec4 color = texture2D(tex1, gl_TexCoord[0].xy);								\n\
-		vec3 norm = normalize((color.xyz * 2.0) + vec3(-1.0));							\n\
+	if (tile.x >= 0.0 && tile.y >= 0.0 && tile.x < gridSize.x && tile.y < gridSize.y) {	\n\
+		vec4 cell = texture2D(tileGrid, (tile + vec2(0.5)) / gridSize);					\n\
 																						\n\
-		/* Find the relative position of the light */									\n\
-		vec2 nlpos = lpos[i] - wpos + (anchor * dims) - gl_TexCoord[0].xy * dims;		\n\
+		/* Iterate over the lights touching the tile */									\n\
+		for (float i=0.0; i<cell.y; i+=1.0) {											\n\
+			float idx = cell.x + i;														\n\
+			vec2 lc = vec2(mod(idx, listWidth) + 0.5, floor(idx / listWidth) + 0.5);	\n\
+			vec2 lpos = texture2D(tileList, lc / vec2(listWidth, listRows)).xy;			\n\
 																						\n\
-		/* Set up a distance-factor */													\n\
-		vec2 diff = nlpos - gl_TexCoord[0].xy;											\n\
-		float len = length(diff);														\n\
-		len /=  400.0;																	\n\
-		if (len > 1.0) len = 1.0;														\n\
-		if (len < 0.0) len = 0.0;														\n\
-		len = (1.0 - len);																\n\
+			/* Find the relative position of the light */								\n\
+			vec2 nlpos = lpos - fpos;													\n\
 																						\n\
-		/* Get the color of the image texture */										\n\
-		color = texture2D(tex0, gl_TexCoord[0].xy);										\n\
+			/* Set up a distance-factor */												\n\
+			vec2 diff = nlpos - gl_TexCoord[0].xy;										\n\
+			float len = length(diff);													\n\
+			len /= range;																\n\
+			if (len > 1.0) len = 1.0;													\n\
+			if (len < 0.0) len = 0.0;													\n\
+			len = (1.0 - len);															\n\
 																						\n\
-		/* Calculate the final color */													\n\
-		float fac = dot(norm, normalize(vec3(nlpos, 100.0)));							\n\
-		fac *= len;																		\n\
-		color.rgb *= fac;																\n\
-		finalColor += color;															\n\
+			/* Calculate the final color */												\n\
+			float fac = dot(norm, normalize(vec3(nlpos, 100.0)));						\n\
+			fac *= len;																	\n\
+			color = image;																\n\
+			color.rgb *= fac;															\n\
+			finalColor += color;														\n\
+		}																				\n\
 	}																					\n\
 	gl_FragColor = finalColor;															\n\
 }"
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "PimInternal.h"
+
+namespace Pim {
+	/**
+	 @class 		ListenerList
+	 @brief 		A list of GameNodes listening to frame or input events.
+	 @details 		Each node stores its index in every list it is a member of,
+	 				making both Add() and Remove() O(1).
+
+	 				Removed nodes leave a NULL tombstone in their slot, so the
+	 				indices of the remaining nodes are unaffected, and it is
+	 				safe to remove nodes while the list is being iterated. Nodes
+	 				added during iteration are appended, and are visited by the
+	 				ongoing iteration. The tombstones are removed by Compact(),
+	 				which must only be called when the list is not iterated.
+
+	 				A node can only be in a list once. Adding a node already in
+	 				the list has no effect.
+	 */
+
+	class GameNode;
+
+	class ListenerList {
+	public:
+		enum ListenerType {
+			FRAME,
+			KEYS,
+			MOUSE,
+			CONTROLLER,
+
+			TYPE_COUNT,
+		};
+
+								ListenerList(ListenerType type);
+		void					Add(GameNode *node);
+		void					Remove(GameNode *node);
+		bool					Contains(const GameNode *node) const;
+		void					Compact();
+		unsigned				Size() const;
+		unsigned				Count() const;
+		GameNode*				operator[](unsigned idx) const;
+
+	private:
+		ListenerType			type;
+		vector<GameNode*>		nodes;
+		unsigned				tombstones;
+	};
+
+	/**
+	 @fn 			ListenerList::Size
+	 @brief 		The number of slots, including tombstones. Use this when
+	 				iterating the list, and skip NULL-entries.
+	 */
+
+	/**
+	 @fn 			ListenerList::Count
+	 @brief 		The number of nodes in the list.
+	 */
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "PimInternal.h"
+
+namespace Pim {
+	/**
+	 @class 		NodePool
+	 @brief 		Recycles the memory of deleted GameNodes.
+	 @details 		GameNode overrides operator new and delete to allocate from
+	 				the NodePool. As Sprites, Labels, Actions and all other nodes
+	 				derive from GameNode, they are all pooled.
+
+	 				The memory is divided into size classes of PIM_POOL_GRANULARITY
+	 				bytes. Each size class carves blocks from chunks of
+	 				PIM_POOL_CHUNK_BLOCKS blocks, and keeps the blocks of deleted
+	 				nodes in a free list. Once the pools have grown to fit the peak
+	 				number of live nodes, creating and deleting nodes does not touch
+	 				the heap. Note that the strings and vectors owned by the nodes
+	 				are still allocated on the heap.
+
+	 				Nodes larger than PIM_POOL_MAX_BLOCK bytes are allocated
+	 				directly on the heap.
+
+	 				The NodePool is not thread safe. Nodes must be created and
+	 				deleted on the main thread, and never in a parallel
+	 				GameNode::Update(), which is asserted.
+	 */
+
+	#define PIM_POOL_GRANULARITY		16
+	#define PIM_POOL_MAX_BLOCK			1024
+	#define PIM_POOL_CHUNK_BLOCKS		64
+
+	class NodePool {
+	public:
+		static void*			Allocate(size_t size);
+		static void				Free(void *ptr, size_t size);
+		static void				Purge();
+		static unsigned int		GetLiveCount();
+		static unsigned int		GetHeapAllocationCount();
+
+	private:
+		struct Block {
+			Block				*next;
+		};
+
+		struct SizeClass {
+			Block				*freeList;
+			vector<void*>		chunks;
+			unsigned int		live;
+		};
+
+		static SizeClass		classes[PIM_POOL_MAX_BLOCK / PIM_POOL_GRANULARITY];
+		static unsigned int		heapAllocs;
+
+		static void				Grow(SizeClass &sc, size_t blockSize);
+	};
+
+	/**
+	 @fn 			NodePool::Purge
+	 @brief 		Returns the chunks of all size classes without live nodes
+	 				to the heap.
+	 */
+
+	/**
+	 @fn 			NodePool::GetLiveCount
+	 @brief 		The number of pooled blocks currently in use.
+	 */
+
+	/**
+	 @fn 			NodePool::GetHeapAllocationCount
+	 @brief 		The total number of heap allocations made by the pool,
+	 				including nodes too large to be pooled. This number does
+	 				not increase as long as pooled blocks are recycled.
+	 */
+}
@@ -17,6 +17,10 @@ namespace Pim {
 	 
 	 				The ParticleSystem class is a Sprite derivative, and the 
 	 				texture loaded by Sprite is used as the particle texture.
+
+	 				Large systems update their particles in parallel on the
+	 				JobSystem. Overrides of UpdateParticle() must therefore only
+	 				modify the particle passed to them.
 	 
 	 				A visual particle editor is a goal, but at the time not a 
 	 				priority.
@@ -28,6 +32,8 @@ namespace Pim {
 		struct Vertex;
 
 	public:
+		enum { NODE_KIND = KIND_PARTICLE_SYSTEM };
+
 		enum PositionType {
 			PART_RELATIVE,	// The particles will move WITH the system. Default.
 			PART_ABSOLUTE	// The particles will move relatively to the point of
@@ -68,6 +74,9 @@ namespace Pim {
 		virtual void			Update(float dt);
 		virtual void			Draw();
 		virtual void			BatchDraw();
+		virtual void			ApplyChildTransform();
+		virtual void			GetChildTransform(Transform2D &t) const;
+		virtual bool			GetContentBounds(const Transform2D &parent, AABB &bounds) const;
 		int						GetParticleCount();
 		void					RemoveAllParticles();
 
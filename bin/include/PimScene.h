@@ -19,12 +19,15 @@ namespace Pim {
 	 */
 	
 	class Layer;
+	class GameNode;
+	class Identifier;
 
 	class Scene {
 	protected:
 		friend class GameControl;
 		friend class RenderWindow;
 		friend class RenderWindowWIN;
+		friend class GameNode;
 
 	public:
 		bool					dirtyZOrder;
@@ -39,12 +42,23 @@ namespace Pim {
 		void					AddLayer(Layer *layer);
 		void					RemoveLayer(Layer *layer);
 		virtual void			ReloadTextures();
+		GameNode*				FindNode(const Identifier &id) const;
+		GameNode*				FindNode(const string &id) const;
+		void					FindNodes(const Identifier &id, vector<GameNode*> &nodes) const;
+		void					FindNodes(const string &id, vector<GameNode*> &nodes) const;
 
 	protected:
+		typedef unordered_multimap<unsigned int,GameNode*>	NodeIndex;
+
 		vector<Layer*>			layers;
+		NodeIndex				nodeIndex;
 
 		void					DrawScene();
 		void					OrderLayers();
+		void					IndexNode(GameNode *node);
+		void					UnindexNode(GameNode *node);
+		void					IndexSubtree(GameNode *node);
+		void					UnindexSubtree(GameNode *node);
 	};
 	
 	
@@ -69,6 +83,27 @@ namespace Pim {
 	 				returned (as is by default), the game will not pause.
 	 */
 	
+	/**
+	 @fn 			Scene::FindNode
+	 @brief 		Returns a node in the scene with the given identifier, or NULL.
+	 @details 		Every node attached to the scene is indexed by it's identifier,
+	 				so the lookup does not search the node tree. If several nodes
+	 				share the identifier, any one of them may be returned - use
+	 				FindNodes() to retrieve all of them.
+
+	 				See GameNode::FindChild() to search a subtree.
+
+	 				The string overload does not intern the name, and may be
+	 				used from a parallel GameNode::Update(). An unknown name
+	 				returns NULL.
+	 */
+
+	/**
+	 @fn 			Scene::FindNodes
+	 @brief 		Appends all nodes in the scene with the given identifier
+	 				to 'nodes'.
+	 */
+
 	/**
 	 @fn 			ReloadTextures
 	 @brief 		Reloads all textures on nodes downward in the node-tree.
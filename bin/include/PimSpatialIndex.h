@@ -0,0 +1,163 @@
+#pragma once
+
+#include "PimInternal.h"
+#include "PimBounds.h"
+
+namespace Pim {
+	/**
+	 @class 		SpatialIndex
+	 @brief 		Finds the nodes of a layer by their location.
+	 @details 		A loose grid over a rectangular area of a layer. Nodes are
+	 				indexed by the center of their bounds (see
+	 				GameNode::GetLayerBounds()), or by their layer position if
+	 				they have no bounds. Nodes outside of the area are placed in
+	 				the border cells, and are still found by all queries.
+
+	 				A node only lives in one cell. The cells are searched with a
+	 				margin equal to the largest half-size of the nodes in them,
+	 				which is at most half a cell. Nodes larger than a cell are
+	 				kept in an overflow list instead, which every query searches
+	 				in full, so most nodes should be smaller than a cell.
+
+	 				Create the index with Layer::CreateSpatialIndex(), and add
+	 				the nodes which should be found with Insert(). Deleted nodes
+	 				are removed automatically. The index is refreshed before the
+	 				frame listeners are updated each frame. Call Update() to
+	 				re-index a node which has moved since then.
+
+	 				The queries clear the output vector and fill it. They never
+	 				allocate memory once the vector has grown large enough, and
+	 				may be called concurrently, including from parallel Update()
+	 				calls. Insert(), Remove(), Update() and Refresh() must only
+	 				be called from the main thread.
+
+	 				@code
+	 				vector<GameNode*> near;
+	 				layer->GetSpatialIndex()->QueryRadius(pos, 100.f, near);
+	 				@endcode
+	 */
+
+	class GameNode;
+
+	class SpatialIndex {
+	public:
+		enum Space {
+			LAYER_SPACE,		// GameNode::GetLayerBounds()
+			SCREEN_SPACE,		// GameNode::GetScreenBounds()
+		};
+
+		struct Hit {
+			GameNode			*node;
+			float				distance;
+		};
+
+								SpatialIndex(const AABB &area, float cellSize,
+											 Space space=LAYER_SPACE);
+								~SpatialIndex();
+		void					Insert(GameNode *node);
+		void					Remove(GameNode *node);
+		void					Update(GameNode *node);
+		void					Refresh();
+		bool					Contains(const GameNode *node) const;
+		unsigned int			GetCount() const;
+		void					QueryRect(const AABB &rect, vector<GameNode*> &out) const;
+		void					QueryRadius(const Vec2 &center, float radius,
+											vector<GameNode*> &out) const;
+		void					QueryRay(const Vec2 &from, const Vec2 &to,
+										 vector<Hit> &out) const;
+		void					QueryNearest(const Vec2 &point, unsigned int k,
+											 vector<Hit> &out) const;
+
+		static void				RefreshAll();
+		static void				RemoveFromAll(GameNode *node);
+
+	private:
+		struct Entry {
+			GameNode			*node;		// NULL if the entry is free
+			AABB				bounds;
+			int					cell;
+			int					prev;
+			int					next;		// Also links the free entries
+		};
+
+		static vector<SpatialIndex*>	instances;
+
+		AABB					area;
+		float					cellSize;
+		Space					space;
+		int						cols;
+		int						rows;
+		vector<int>				cells;		// The first entry of each cell, or -1
+		int						overflow;	// The cell holding the nodes larger than a cell
+		vector<Entry>			entries;
+		int						freeEntry;
+		unordered_map<const GameNode*,int>	lookup;
+		float					margin;		// The largest half-size of the entries in the grid
+		unsigned int			count;
+
+								SpatialIndex(const SpatialIndex&);
+		SpatialIndex&			operator=(const SpatialIndex&);
+
+		AABB					ComputeBounds(GameNode *node) const;
+		static float			Distance(const AABB &box, const Vec2 &point);
+		int						CellIndex(int x, int y) const;
+		void					CellOf(const Vec2 &point, int &x, int &y) const;
+		void					CellRange(const AABB &rect, int &x0, int &y0,
+										  int &x1, int &y1) const;
+		void					Link(int idx);
+		void					Unlink(int idx);
+		void					Place(int idx, const AABB &bounds);
+		static void				PushNearest(const Entry &e, const Vec2 &point,
+											unsigned int k, vector<Hit> &out);
+	};
+
+	/**
+	 @fn 			SpatialIndex::SpatialIndex
+	 @brief 		Creates a grid covering 'area' (in layer coordinates), with
+	 				square cells of 'cellSize'. A cell size of a few times the
+	 				size of a typical node works well.
+
+	 				Screen space indices are used for hit testing, and nodes
+	 				without hit bounds are never found by them.
+	 */
+
+	/**
+	 @fn 			SpatialIndex::Update
+	 @brief 		Re-index a node after it has moved.
+	 */
+
+	/**
+	 @fn 			SpatialIndex::Refresh
+	 @brief 		Re-index every node. Only nodes which have moved to another
+	 				cell are relinked.
+	 */
+
+	/**
+	 @fn 			SpatialIndex::QueryRect
+	 @brief 		Finds the nodes whose bounds overlap the rectangle.
+	 */
+
+	/**
+	 @fn 			SpatialIndex::QueryRadius
+	 @brief 		Finds the nodes whose bounds are within 'radius' of 'center'.
+	 */
+
+	/**
+	 @fn 			SpatialIndex::QueryRay
+	 @brief 		Finds the nodes whose bounds intersect the line segment,
+	 				sorted by the distance from 'from' to the intersection.
+	 */
+
+	/**
+	 @fn 			SpatialIndex::QueryNearest
+	 @brief 		Finds the 'k' nodes closest to 'point', sorted by distance.
+	 				The distance is measured to the bounds of the nodes.
+	 */
+
+	/**
+	 @fn 			SpatialIndex::RefreshAll
+	 @brief 		Refreshes all layer space indices. Called by GameControl
+	 				every frame. Screen space indices must be refreshed by
+	 				their owner.
+	 */
+}
@@ -31,11 +31,15 @@ namespace Pim {
 	
 	class SpriteBatchNode : public Sprite {
 	public:
+		enum { NODE_KIND = KIND_SPRITE_BATCH_NODE };
+
 					SpriteBatchNode(string file);
 					SpriteBatchNode();
 					~SpriteBatchNode(void);
 		void		AddChild(GameNode *ch);
 		void		Draw();
 		void		BatchDraw();
+		void		GetChildTransform(Transform2D &t) const;
+		bool		GetContentBounds(const Transform2D &parent, AABB &bounds) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "PimInternal.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+
+// The trace zones are compiled in when PIM_TRACE is defined, which it is
+// by default in debug builds. Define PIM_TRACE in release builds to trace.
+#if defined(_DEBUG) && !defined(PIM_TRACE)
+	#define PIM_TRACE
+#endif
+
+// The maximum number of events kept per thread. Later events are dropped.
+#define PIM_TRACE_MAX_EVENTS		(1 << 20)
+
+#define PIM_TRACE_CONCAT_(a, b)		a##b
+#define PIM_TRACE_CONCAT(a, b)		PIM_TRACE_CONCAT_(a, b)
+
+#ifdef PIM_TRACE
+	#define PIM_TRACE_ZONE(name)	Pim::TraceZone PIM_TRACE_CONCAT(pimTraceZone, __LINE__)(name)
+#else
+	#define PIM_TRACE_ZONE(name)
+#endif
+
+namespace Pim {
+	/**
+	 @class 		Trace
+	 @brief 		Records the time spent in scoped zones on every thread, and
+	 				exports it as a Chrome trace.
+	 @details 		Place a zone at the top of a scope with PIM_TRACE_ZONE. The
+	 				name must be a string literal, as only the pointer is kept.
+	 				The engine has zones in the game loop, scene traversal,
+	 				resource loading, sound streaming, shadow rendering, shader
+	 				compilation and the jobs of the JobSystem.
+
+	 				The zones are compiled out unless PIM_TRACE is defined, and
+	 				record nothing unless the trace is started. Each thread
+	 				records into a buffer of it's own.
+
+	 				Open the exported file in chrome://tracing or Perfetto.
+
+	 				@code
+	 				void Enemy::Update(float dt) {
+	 					PIM_TRACE_ZONE("Enemy::Update");
+	 					...
+	 				}
+
+	 				Trace::Start();
+	 				...
+	 				Trace::Stop();
+	 				Trace::Export("trace.json");
+	 				@endcode
+	 */
+
+	class Trace {
+	public:
+		static void				Start();
+		static void				Stop();
+		static bool				IsActive();
+		static void				Clear();
+		static bool				Export(const string &path);
+		static void				SetThreadName(const char *name);
+		static double			BeginZone();
+		static void				EndZone(const char *name, double start);
+
+	private:
+		struct Event {
+			const char			*name;
+			double				start;		// Seconds, see GameControl::GetTime()
+			double				end;
+		};
+
+		struct ThreadBuffer {
+			unsigned int		id;
+			string				name;
+			vector<Event>		events;
+			unsigned int		dropped;	// Events past PIM_TRACE_MAX_EVENTS
+			mutex				lock;		// Held while appending and exporting
+		};
+
+		static atomic<bool>		active;
+		static mutex			buffersLock;
+		static vector<ThreadBuffer*> buffers;	// Never freed, threads may outlive a trace
+
+		static ThreadBuffer*	GetThreadBuffer();
+		static void				WriteString(FILE *file, const char *str);
+	};
+
+	/**
+	 @class 		TraceZone
+	 @brief 		Records the lifetime of the object to the Trace. Use the
+	 				PIM_TRACE_ZONE macro rather than this class directly.
+	 */
+
+	class TraceZone {
+	public:
+								TraceZone(const char *name);
+								~TraceZone();
+
+	private:
+		const char				*name;		// NULL if the trace was not active
+		double					start;
+
+								TraceZone(const TraceZone&);
+		TraceZone&				operator=(const TraceZone&);
+	};
+
+	/**
+	 @fn 			Trace::Start
+	 @brief 		Start recording zones. The events of earlier traces are kept
+	 				until Clear() is called.
+	 */
+
+	/**
+	 @fn 			Trace::Export
+	 @brief 		Writes the recorded events to a file in the Chrome trace event
+	 				format. May be called while the trace is active. Returns false
+	 				if the file could not be created.
+	 */
+
+	/**
+	 @fn 			Trace::SetThreadName
+	 @brief 		Names the calling thread in the exported trace. GameControl
+	 				and JobSystem name their threads.
+	 */
+}
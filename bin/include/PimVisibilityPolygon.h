@@ -0,0 +1,108 @@
+#pragma once
+
+#include "PimInternal.h"
+#include "PimVec2.h"
+
+namespace Pim {
+	/**
+	 @class 		VisibilityPolygon
+	 @brief 		The area visible from a point, given a set of shadow casters.
+	 @details 		The polygon is computed by an angular sweep around the origin.
+	 				The segment endpoints are sorted by angle, and the segments
+	 				spanning the sweep direction are kept in a heap ordered by
+	 				their distance from the origin. Wherever the closest segment
+	 				changes, the polygon gets a vertex on each of the two. The
+	 				cost is O(S log S) for S segments. The vertices are sorted by
+	 				angle, and can be rendered as a triangle fan around the origin.
+
+	 				The segments are clipped to the bounding box. Crossing
+	 				segments are not split otherwise, so the polygon may be off
+	 				between the crossing and the next endpoint. The edges of a
+	 				shadow shape meet only at their endpoints, which is fine.
+
+	 				The polygon is bounded by a box of size 2*extent centered on
+	 				the origin.
+
+	 				The LightingSystem uses this class to mask lights when the
+	 				shadow mode is SHADOW_VISIBILITY. It is however just as useful
+	 				for gameplay code, for instance line-of-sight checks in AI:
+
+	 				@code
+	 				VisibilityPolygon vis;
+	 				vis.Compute(enemy->position, 500.f, layer->GetLightingSystem()->GetShadowCasters());
+	 				if (vis.Contains(player->position)) {
+	 					// The enemy can see the player
+	 				}
+	 				@endcode
+
+	 				Compute() does not modify any shared state, so several
+	 				polygons may safely be computed in parallel. Each polygon
+	 				keeps it's scratch buffers between calls, so reuse the
+	 				instances rather than creating new ones every frame.
+	 */
+
+	class GameNode;
+
+	class VisibilityPolygon {
+	public:
+		Vec2					origin;
+		Vec2					extent;
+		vector<Vec2>			vertices;		// Relative to origin, sorted by angle
+
+		static void				GatherSegments(const vector<GameNode*> &casters,
+										vector<Vec2> &segments, const Vec2 &sc=Vec2(1.f,1.f));
+
+								VisibilityPolygon();
+		void					Compute(const Vec2 &origin, float radius,
+										const vector<GameNode*> &casters);
+		void					Compute(const Vec2 &origin, const Vec2 &extent,
+										const vector<Vec2> &segments);
+		bool					Contains(const Vec2 &point) const;
+
+	private:
+		struct Event {
+			float				angle;
+			int					seg;
+			bool				start;			// The segment starts or ends here
+		};
+
+		vector<float>			angles;			// The angle of each vertex
+		vector<Vec2>			segs;			// Counter-clockwise pairs, relative to origin
+		vector<Event>			events;
+		vector<int>				heap;			// The segments spanning the sweep, closest first
+		vector<int>				heapPos;		// The heap index of each segment, or -1
+		vector<Vec2>			gathered;		// Used by the caster overload of Compute()
+		Vec2					sweepDir;		// The direction the heap is ordered along
+
+		void					AddSegment(Vec2 a, Vec2 b);
+		void					PushSegment(const Vec2 &a, const Vec2 &b);
+		void					AddVertex(const Vec2 &p, float angle);
+		float					RayDistance(int seg, const Vec2 &dir) const;
+		bool					Closer(int s1, int s2) const;
+		void					HeapPush(int seg);
+		void					HeapRemove(int seg);
+		void					SiftUp(int idx);
+		void					SiftDown(int idx);
+		void					HeapSet(int idx, int seg);
+	};
+
+	/**
+	 @fn 			VisibilityPolygon::GatherSegments
+	 @brief 		Appends the edges of the shadow shapes of the casters to
+	 				'segments', two points per edge, in layer coordinates.
+	 */
+
+	/**
+	 @fn 			VisibilityPolygon::Compute
+	 @brief 		Compute the polygon visible from 'origin'.
+	 @details 		The first overload gathers the segments from the passed
+	 				shadow casters, and bounds the polygon by a square of size
+	 				2*radius. The second overload takes a list of segments as
+	 				created by GatherSegments().
+	 */
+
+	/**
+	 @fn 			VisibilityPolygon::Contains
+	 @brief 		Returns true if the point is visible from the origin.
+	 */
+}
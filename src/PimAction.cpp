@@ -10,6 +10,8 @@ namespace Pim {
 	=====================
 	*/
 	BaseAction::BaseAction(float duration) {
+		kind |= NODE_KIND;
+
 		done					= false;
 		inQueue					= false;
 		notifyOnCompletion		= false;
@@ -88,6 +90,7 @@ namespace Pim {
 	=====================
 	*/
 	void MoveToAction::Update(float dt) {
+		GetParent()->MarkMoved();
 		ACTION_UPDATE_STATIC(
 			GameNode,
 			position,
@@ -127,6 +130,7 @@ namespace Pim {
 	=====================
 	*/
 	void MoveByAction::Update(float dt) {
+		GetParent()->MarkMoved();
 		ACTION_UPDATE_RELATIVE(GameNode, position, rel);
 	}
 
@@ -160,6 +164,7 @@ namespace Pim {
 	=====================
 	*/
 	void RotateByAction::Update(float dt) {
+		GetParent()->MarkMoved();
 		ACTION_UPDATE_RELATIVE(GameNode, rotation, total);
 	}
 
@@ -207,7 +212,7 @@ namespace Pim {
 	*/
 	void SpriteAction::Activate() {
 		PimAssert(GetParent() != NULL, "Action is orphan");
-		PimAssert(dynamic_cast<Sprite*>(GetParent()) != NULL,
+		PimAssert(GetParent()->As<Sprite>() != NULL,
 				  "Cannot add a Sprite-action to a non-sprite node!");
 
 		ListenFrame();
@@ -287,6 +292,7 @@ namespace Pim {
 	=====================
 	*/
 	void ScaleToAction::Update(float dt) {
+		GetParent()->MarkMoved();
 		ACTION_UPDATE_STATIC(
 			Sprite,
 			scale,
@@ -326,6 +332,7 @@ namespace Pim {
 	=====================
 	*/
 	void ScaleByAction::Update(float dt) {
+		GetParent()->MarkMoved();
 		ACTION_UPDATE_RELATIVE(Sprite, scale, remainding);
 	}
 
@@ -339,6 +346,8 @@ namespace Pim {
 	*/
 	ActionQueue::ActionQueue(int numAct, BaseAction *act1, ...)
 		: Action(0.f) {
+		kind |= NODE_KIND;
+
 		PimAssert(numAct != 0, "No actions / invalid num provided to ActionQueue");
 		PimAssert(numAct < 32, "ActionQueues does not support more than 32 actions");
 
@@ -4,6 +4,7 @@
 #include "PimAssert.h"
 #include "PimRenderWindow.h"
 #include "PimSound.h"
+#include "PimTrace.h"
 
 namespace Pim {
 	AudioManager* AudioManager::singleton = NULL;
@@ -214,6 +215,8 @@ namespace Pim {
 	=====================
 	*/
 	void AudioManager::UpdateSoundBuffers() {
+		PIM_TRACE_ZONE("AudioManager::UpdateSoundBuffers");
+
 		if (!context || !device) {
 			return;
 		}
@@ -0,0 +1,247 @@
+#include "PimInternal.h"
+
+#include "PimBounds.h"
+
+#include <float.h>
+
+namespace Pim {
+	/*
+	=====================
+	AABB::AABB
+	=====================
+	*/
+	AABB::AABB() {
+		lower = Vec2(FLT_MAX, FLT_MAX);
+		upper = Vec2(-FLT_MAX, -FLT_MAX);
+	}
+
+	/*
+	=====================
+	AABB::AABB
+	=====================
+	*/
+	AABB::AABB(const Vec2 &lo, const Vec2 &hi) {
+		lower = lo;
+		upper = hi;
+	}
+
+	/*
+	=====================
+	AABB::IsEmpty
+	=====================
+	*/
+	bool AABB::IsEmpty() const {
+		return lower.x > upper.x || lower.y > upper.y;
+	}
+
+	/*
+	=====================
+	AABB::Extend
+	=====================
+	*/
+	void AABB::Extend(const Vec2 &point) {
+		if (point.x < lower.x) lower.x = point.x;
+		if (point.y < lower.y) lower.y = point.y;
+		if (point.x > upper.x) upper.x = point.x;
+		if (point.y > upper.y) upper.y = point.y;
+	}
+
+	/*
+	=====================
+	AABB::Extend
+	=====================
+	*/
+	void AABB::Extend(const AABB &other) {
+		if (other.IsEmpty()) {
+			return;
+		}
+
+		Extend(other.lower);
+		Extend(other.upper);
+	}
+
+	/*
+	=====================
+	AABB::Overlaps
+	=====================
+	*/
+	bool AABB::Overlaps(const AABB &other) const {
+		if (IsEmpty() || other.IsEmpty()) {
+			return false;
+		}
+
+		return	lower.x <= other.upper.x && upper.x >= other.lower.x &&
+				lower.y <= other.upper.y && upper.y >= other.lower.y;
+	}
+
+	/*
+	=====================
+	AABB::Contains
+	=====================
+	*/
+	bool AABB::Contains(const Vec2 &point) const {
+		return	point.x >= lower.x && point.x <= upper.x &&
+				point.y >= lower.y && point.y <= upper.y;
+	}
+
+	/*
+	=====================
+	AABB::GetCenter
+	=====================
+	*/
+	Vec2 AABB::GetCenter() const {
+		return (lower + upper) * 0.5f;
+	}
+
+	/*
+	=====================
+	AABB::GetSize
+	=====================
+	*/
+	Vec2 AABB::GetSize() const {
+		return upper - lower;
+	}
+
+	/*
+	=====================
+	Transform2D::FromGLMatrix
+	=====================
+	*/
+	Transform2D Transform2D::FromGLMatrix(const float m[16]) {
+		Transform2D t;
+		t.a		= m[0];
+		t.b		= m[1];
+		t.c		= m[4];
+		t.d		= m[5];
+		t.tx	= m[12];
+		t.ty	= m[13];
+		return t;
+	}
+
+	/*
+	=====================
+	Transform2D::Transform2D
+	=====================
+	*/
+	Transform2D::Transform2D() {
+		a	= 1.f;
+		b	= 0.f;
+		c	= 0.f;
+		d	= 1.f;
+		tx	= 0.f;
+		ty	= 0.f;
+	}
+
+	/*
+	=====================
+	Transform2D::Translate
+	=====================
+	*/
+	void Transform2D::Translate(float x, float y) {
+		tx += a * x + c * y;
+		ty += b * x + d * y;
+	}
+
+	/*
+	=====================
+	Transform2D::Rotate
+	=====================
+	*/
+	void Transform2D::Rotate(float degrees) {
+		if (degrees == 0.f) {
+			return;
+		}
+
+		float rad = degrees * (float(M_PI) / 180.f);
+		float cs = cosf(rad);
+		float sn = sinf(rad);
+
+		float na = a * cs + c * sn;
+		float nb = b * cs + d * sn;
+		float nc = c * cs - a * sn;
+		float nd = d * cs - b * sn;
+
+		a = na;
+		b = nb;
+		c = nc;
+		d = nd;
+	}
+
+	/*
+	=====================
+	Transform2D::Scale
+	=====================
+	*/
+	void Transform2D::Scale(float x, float y) {
+		a *= x;
+		b *= x;
+		c *= y;
+		d *= y;
+	}
+
+	/*
+	=====================
+	Transform2D::Inverse
+	=====================
+	*/
+	Transform2D Transform2D::Inverse() const {
+		Transform2D inv;
+		float det = a * d - b * c;
+
+		if (det == 0.f) {
+			return inv;
+		}
+
+		inv.a	=  d / det;
+		inv.b	= -b / det;
+		inv.c	= -c / det;
+		inv.d	=  a / det;
+		inv.tx	= -(inv.a * tx + inv.c * ty);
+		inv.ty	= -(inv.b * tx + inv.d * ty);
+		return inv;
+	}
+
+	/*
+	=====================
+	Transform2D::Apply
+	=====================
+	*/
+	Vec2 Transform2D::Apply(const Vec2 &p) const {
+		return Vec2(a * p.x + c * p.y + tx, b * p.x + d * p.y + ty);
+	}
+
+	/*
+	=====================
+	Transform2D::Apply
+	=====================
+	*/
+	AABB Transform2D::Apply(const AABB &box) const {
+		AABB result;
+
+		if (box.IsEmpty()) {
+			return result;
+		}
+
+		result.Extend(Apply(box.lower));
+		result.Extend(Apply(box.upper));
+		result.Extend(Apply(Vec2(box.lower.x, box.upper.y)));
+		result.Extend(Apply(Vec2(box.upper.x, box.lower.y)));
+		return result;
+	}
+
+	/*
+	=====================
+	Transform2D::operator*
+	=====================
+	*/
+	Transform2D Transform2D::operator*(const Transform2D &o) const {
+		Transform2D t;
+		t.a		= a * o.a + c * o.b;
+		t.b		= b * o.a + d * o.b;
+		t.c		= a * o.c + c * o.d;
+		t.d		= b * o.c + d * o.d;
+		t.tx	= a * o.tx + c * o.ty + tx;
+		t.ty	= b * o.tx + d * o.ty + ty;
+		return t;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "PimInternal.h"
+#include "PimVec2.h"
+
+namespace Pim {
+	/**
+	 @struct 		AABB
+	 @brief 		An axis aligned bounding box.
+	 @details 		A default constructed box is empty, and contains nothing.
+	 				Extending an empty box by a point or a box makes it equal
+	 				to that point or box.
+	 */
+
+	struct AABB {
+		Vec2				lower;
+		Vec2				upper;
+
+							AABB();
+							AABB(const Vec2 &lo, const Vec2 &hi);
+		bool				IsEmpty() const;
+		void				Extend(const Vec2 &point);
+		void				Extend(const AABB &other);
+		bool				Overlaps(const AABB &other) const;
+		bool				Contains(const Vec2 &point) const;
+		Vec2				GetCenter() const;
+		Vec2				GetSize() const;
+	};
+
+	/**
+	 @class 		Transform2D
+	 @brief 		A 2D affine transformation.
+	 @details 		Mirrors the OpenGL matrix stack on the CPU. Translate(),
+	 				Rotate() and Scale() multiply the transformation from the
+	 				right, like glTranslatef(), glRotatef() and glScalef().
+	 */
+
+	class Transform2D {
+	public:
+		float				a, b;		// The first column
+		float				c, d;		// The second column
+		float				tx, ty;		// The translation
+
+		static Transform2D	FromGLMatrix(const float m[16]);
+
+							Transform2D();
+		void				Translate(float x, float y);
+		void				Rotate(float degrees);
+		void				Scale(float x, float y);
+		Transform2D			Inverse() const;
+		Vec2				Apply(const Vec2 &point) const;
+		AABB				Apply(const AABB &box) const;
+		Transform2D			operator*(const Transform2D &other) const;
+	};
+
+	/**
+	 @fn 			AABB::Overlaps
+	 @brief 		Returns true if the boxes share any point. Empty boxes
+	 				overlap nothing.
+	 */
+
+	/**
+	 @fn 			Transform2D::FromGLMatrix
+	 @brief 		Returns the 2D part of a column major OpenGL matrix, as
+	 				returned by glGetFloatv(GL_MODELVIEW_MATRIX, m).
+	 */
+
+	/**
+	 @fn 			Transform2D::Apply
+	 @brief 		Transforms a box. The result is the bounding box of the
+	 				four transformed corners.
+	 */
+}
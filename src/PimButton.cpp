@@ -20,11 +20,12 @@ namespace Pim {
 	=====================
 	*/
 	Button::Button(Sprite* normal, Sprite* hovered, Sprite* pressed, Sprite* deactivated) {
-		ListenMouse();
+		kind |= NODE_KIND;
 
 		activated			= true;
 		allowLeftClick		= true;
 		allowRightClick		= false;
+		consumeMouse		= false;
 		callback			= NULL;
 		mouseDownLastFrame	= false;
 		mouseHoverLastFrame	= false;
@@ -53,6 +54,10 @@ namespace Pim {
 			sprites[DEACTIVATED]->hidden = true;
 			AddChild(sprites[DEACTIVATED]);
 		}
+
+		// The hit bounds are those of the current sprite
+		SetMouseHitTest(true);
+		ListenMouse();
 	}
 
 	/*
@@ -62,7 +67,13 @@ namespace Pim {
 	*/
 	void Button::OnMouseEvent(MouseEvent &evt) {
 		if (activated) {
-			if (IsHovered(evt.GetPosition())) {
+			bool hovered = evt.IsHitTested() ? evt.IsOver() : IsHovered(evt.GetPosition());
+
+			if (hovered) {
+				if (consumeMouse) {
+					evt.Consume();
+				}
+
 				if (!mouseHoverLastFrame) {
 					// The mouse was hovered over
 					if (mouseDownLastFrame) {
@@ -124,6 +135,17 @@ namespace Pim {
 				}
 			}
 		}
+
+		// Keep receiving events until a press on the button is released
+		if (evt.IsHitTested()) {
+			Input *input = Input::GetSingleton();
+
+			if (activated && mouseDownLastFrame) {
+				input->CaptureMouse(this);
+			} else if (input->GetMouseCapture() == this) {
+				input->CaptureMouse(NULL);
+			}
+		}
 	}
 
 	/*
@@ -182,6 +204,15 @@ namespace Pim {
 		callback = cb;
 	}
 
+	/*
+	=====================
+	Button::GetHitBounds
+	=====================
+	*/
+	bool Button::GetHitBounds(AABB &bounds) const {
+		return current->GetLayerBounds(bounds);
+	}
+
 	/*
 	=====================
 	Button::IsHovered
@@ -202,6 +233,29 @@ namespace Pim {
 		return temp.Contains(mousePos - current->GetParentLayer()->position);
 	}
 
+	/*
+	=====================
+	Button::SetCurrent
+
+	The sprites may differ in size, so the hit bounds are updated.
+	=====================
+	*/
+	void Button::SetCurrent(Sprite *spr) {
+		if (spr == current) {
+			return;
+		}
+
+		current->hidden = true;
+		current->MarkMoved();
+		current = spr;
+		current->hidden = false;
+		current->MarkMoved();
+
+		if (Input *input = Input::GetSingleton()) {
+			input->UpdateHitBounds(this);
+		}
+	}
+
 	/*
 	=====================
 	Button::MakeNormalCurrent
@@ -209,9 +263,7 @@ namespace Pim {
 	*/
 	void Button::MakeNormalCurrent() {
 		if (sprites[NORMAL]) {
-			current->hidden = true;
-			current = sprites[NORMAL];
-			current->hidden = false;
+			SetCurrent(sprites[NORMAL]);
 		}
 	}
 
@@ -222,9 +274,7 @@ namespace Pim {
 	*/
 	void Button::MakeHoveredCurrent() {
 		if (sprites[HOVERED]) {
-			current->hidden = true;
-			current = sprites[HOVERED];
-			current->hidden = false;
+			SetCurrent(sprites[HOVERED]);
 		} else {
 			MakeNormalCurrent();
 		}
@@ -237,9 +287,7 @@ namespace Pim {
 	*/
 	void Button::MakePressedCurrent() {
 		if (sprites[PRESSED]) {
-			current->hidden = true;
-			current = sprites[PRESSED];
-			current->hidden = false;
+			SetCurrent(sprites[PRESSED]);
 		}
 	}
 
@@ -250,9 +298,7 @@ namespace Pim {
 	*/
 	void Button::MakeDeactivatedCurrent() {
 		if (sprites[DEACTIVATED]) {
-			current->hidden = true;
-			current = sprites[DEACTIVATED];
-			current->hidden = false;
+			SetCurrent(sprites[DEACTIVATED]);
 		}
 	}
 }
\ No newline at end of file
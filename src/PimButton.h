@@ -26,6 +26,8 @@ namespace Pim {
 	 */
 	class Button : public Pim::GameNode {
 	public:
+		enum { NODE_KIND = KIND_BUTTON };
+
 		enum ButtonState {
 			NORMAL,
 			HOVERED,
@@ -36,6 +38,7 @@ namespace Pim {
 		bool					activated; 
 		bool					allowLeftClick;
 		bool					allowRightClick;
+		bool					consumeMouse;			// Hide the mouse from buttons below
 
 								Button(Sprite* normal, Sprite* hovered=NULL, 
 										Sprite* pressed=NULL, Sprite* deactivated=NULL);
@@ -44,6 +47,7 @@ namespace Pim {
 		void					SetActiveState(ButtonState state);
 		void					SetActive(bool flag);
 		void					SetCallback(ButtonCallback *cb);
+		virtual bool			GetHitBounds(AABB &bounds) const;
 
 	protected:
 		Sprite					*sprites[4];
@@ -53,6 +57,7 @@ namespace Pim {
 		bool					mouseFreshWhileHover;	// Was the current mouse click created while hovering?
 		ButtonCallback*			callback;
 
+		void					SetCurrent(Sprite *sprite);
 		virtual bool			IsHovered(const Pim::Vec2 mousePos) const;
 		virtual void			MakeNormalCurrent();
 		virtual void			MakeHoveredCurrent();
@@ -87,6 +92,14 @@ namespace Pim {
 	 			The new sprite.
 	 */
 	
+	/**
+	 @fn 		Button::GetHitBounds
+	 @brief 	The bounds of the current sprite.
+	 @details 	Buttons are hit tested (see GameNode::SetMouseHitTest()). If
+	 			IsHovered() is overridden, either override this method to
+	 			match, or disable hit testing.
+	 */
+
 	/**
 	 @fn 		Button::SetActive
 	 @brief 	Disable / enable the button.
@@ -0,0 +1,194 @@
+#include "PimInternal.h"
+
+#include "PimCommandBuffer.h"
+#include "PimGameNode.h"
+#include "PimAction.h"
+#include "PimJobSystem.h"
+#include "PimAssert.h"
+
+namespace Pim {
+	// The buffer recording on the current thread
+	static PIM_THREAD_LOCAL CommandBuffer *recording = NULL;
+
+	/*
+	=====================
+	CommandBuffer::GetRecording
+	=====================
+	*/
+	CommandBuffer* CommandBuffer::GetRecording() {
+		return recording;
+	}
+
+	/*
+	=====================
+	CommandBuffer::SetRecording
+	=====================
+	*/
+	void CommandBuffer::SetRecording(CommandBuffer *buffer) {
+		recording = buffer;
+	}
+
+	/*
+	=====================
+	CommandBuffer::AddChild
+	=====================
+	*/
+	void CommandBuffer::AddChild(GameNode *parent, GameNode *child) {
+		Push(ADD_CHILD, parent, child, 0);
+	}
+
+	/*
+	=====================
+	CommandBuffer::RemoveChild
+	=====================
+	*/
+	void CommandBuffer::RemoveChild(GameNode *parent, GameNode *child, bool cleanup) {
+		Push(REMOVE_CHILD, parent, child, cleanup);
+	}
+
+	/*
+	=====================
+	CommandBuffer::RemoveAllChildren
+	=====================
+	*/
+	void CommandBuffer::RemoveAllChildren(GameNode *parent, bool cleanup) {
+		Push(REMOVE_ALL_CHILDREN, parent, NULL, cleanup);
+	}
+
+	/*
+	=====================
+	CommandBuffer::SetZOrder
+	=====================
+	*/
+	void CommandBuffer::SetZOrder(GameNode *node, int z) {
+		Push(SET_Z_ORDER, node, NULL, z);
+	}
+
+	/*
+	=====================
+	CommandBuffer::SetSleeping
+	=====================
+	*/
+	void CommandBuffer::SetSleeping(GameNode *node, bool flag) {
+		Push(SET_SLEEPING, node, NULL, flag);
+	}
+
+	/*
+	=====================
+	CommandBuffer::RunAction
+	=====================
+	*/
+	void CommandBuffer::RunAction(GameNode *node, BaseAction *action) {
+		Push(RUN_ACTION, node, action, 0);
+	}
+
+	/*
+	=====================
+	CommandBuffer::MarkMoved
+	=====================
+	*/
+	void CommandBuffer::MarkMoved(GameNode *node) {
+		Push(MARK_MOVED, node, NULL, 0);
+	}
+
+	/*
+	=====================
+	CommandBuffer::Listen
+	=====================
+	*/
+	void CommandBuffer::Listen(GameNode *node, int type) {
+		Push(LISTEN, node, NULL, type);
+	}
+
+	/*
+	=====================
+	CommandBuffer::Unlisten
+	=====================
+	*/
+	void CommandBuffer::Unlisten(GameNode *node, int type) {
+		Push(UNLISTEN, node, NULL, type);
+	}
+
+	/*
+	=====================
+	CommandBuffer::Execute
+	=====================
+	*/
+	void CommandBuffer::Execute() {
+		PimAssert(recording != this, "Error: CommandBuffer executed while recording");
+
+		for (unsigned i=0; i<commands.size(); i++) {
+			Command &cmd = commands[i];
+
+			switch (cmd.type) {
+				case ADD_CHILD:
+					cmd.node->AddChild(cmd.other);
+					break;
+
+				case REMOVE_CHILD:
+					cmd.node->RemoveChild(cmd.other, cmd.arg != 0);
+					break;
+
+				case REMOVE_ALL_CHILDREN:
+					cmd.node->RemoveAllChildren(cmd.arg != 0);
+					break;
+
+				case SET_Z_ORDER:
+					cmd.node->SetZOrder(cmd.arg);
+					break;
+
+				case SET_SLEEPING:
+					cmd.node->SetSleeping(cmd.arg != 0);
+					break;
+
+				case RUN_ACTION:
+					cmd.node->AddChild(cmd.other);
+					static_cast<BaseAction*>(cmd.other)->Activate();
+					break;
+
+				case MARK_MOVED:
+					cmd.node->MarkMoved();
+					break;
+
+				case LISTEN:
+					switch (cmd.arg) {
+						case ListenerList::FRAME:		cmd.node->ListenFrame();		break;
+						case ListenerList::KEYS:		cmd.node->ListenKeys();			break;
+						case ListenerList::MOUSE:		cmd.node->ListenMouse();		break;
+						case ListenerList::CONTROLLER:	cmd.node->ListenController();	break;
+					}
+					break;
+
+				case UNLISTEN:
+					switch (cmd.arg) {
+						case ListenerList::FRAME:		cmd.node->UnlistenFrame();		break;
+						case ListenerList::KEYS:		cmd.node->UnlistenKeys();		break;
+						case ListenerList::MOUSE:		cmd.node->UnlistenMouse();		break;
+						case ListenerList::CONTROLLER:	cmd.node->UnlistenController();	break;
+					}
+					break;
+			}
+		}
+
+		commands.clear();
+	}
+
+	/*
+	=====================
+	CommandBuffer::IsEmpty
+	=====================
+	*/
+	bool CommandBuffer::IsEmpty() const {
+		return commands.empty();
+	}
+
+	/*
+	=====================
+	CommandBuffer::Push
+	=====================
+	*/
+	void CommandBuffer::Push(CommandType type, GameNode *node, GameNode *other, int arg) {
+		Command cmd = { type, node, other, arg };
+		commands.push_back(cmd);
+	}
+}
@@ -0,0 +1,308 @@
+#include "PimInternal.h"
+
+#include "PimFrameStats.h"
+#include "PimAssert.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+namespace Pim {
+	static const char *phaseNames[FrameStats::PHASE_COUNT+1] = {
+		"events",
+		"wait",
+		"input",
+		"update",
+		"delete_queue",
+		"main_thread_jobs",
+		"render",
+		"lighting",
+		"swap",
+		"audio",
+		"total",
+	};
+
+	/*
+	=====================
+	FrameStats::FrameStats
+	=====================
+	*/
+	FrameStats::FrameStats() {
+		for (unsigned i=0; i<PIM_FRAME_STATS_CAPACITY; i++) {
+			slots[i].seq.store(0);
+		}
+
+		count.store(0);
+		BeginFrame();
+	}
+
+	/*
+	=====================
+	FrameStats::BeginFrame
+	=====================
+	*/
+	void FrameStats::BeginFrame() {
+		current.index = count.load(memory_order_relaxed);
+
+		for (int i=0; i<=PHASE_COUNT; i++) {
+			current.times[i] = 0.f;
+		}
+	}
+
+	/*
+	=====================
+	FrameStats::AddTime
+	=====================
+	*/
+	void FrameStats::AddTime(Phase phase, float seconds) {
+		current.times[phase] += seconds;
+	}
+
+	/*
+	=====================
+	FrameStats::EndFrame
+
+	The slot's sequence is odd while the frame is written, and then
+	set to twice the frame number plus two. Readers compare the
+	sequence before and after copying.
+	=====================
+	*/
+	void FrameStats::EndFrame(float total) {
+		current.times[TOTAL] = total;
+
+		unsigned int n = count.load(memory_order_relaxed);
+		Slot &slot = slots[n & (PIM_FRAME_STATS_CAPACITY-1)];
+
+		slot.seq.store(n * 2 + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+
+		slot.frame = current;
+
+		slot.seq.store(n * 2 + 2, memory_order_release);
+		count.store(n + 1, memory_order_release);
+
+		BeginFrame();
+	}
+
+	/*
+	=====================
+	FrameStats::GetFrameCount
+	=====================
+	*/
+	unsigned int FrameStats::GetFrameCount() const {
+		return count.load(memory_order_acquire);
+	}
+
+	/*
+	=====================
+	FrameStats::GetFrame
+	=====================
+	*/
+	bool FrameStats::GetFrame(unsigned int age, Frame &frame) const {
+		unsigned int n = count.load(memory_order_acquire);
+
+		if (age >= n || age >= PIM_FRAME_STATS_CAPACITY) {
+			return false;
+		}
+
+		return ReadSlot(n - 1 - age, frame);
+	}
+
+	/*
+	=====================
+	FrameStats::GetFrames
+	=====================
+	*/
+	unsigned int FrameStats::GetFrames(unsigned int window, vector<Frame> &frames) const {
+		frames.clear();
+
+		unsigned int n = count.load(memory_order_acquire);
+
+		if (window > PIM_FRAME_STATS_CAPACITY) {
+			window = PIM_FRAME_STATS_CAPACITY;
+		}
+		if (window > n) {
+			window = n;
+		}
+
+		frames.reserve(window);
+
+		Frame frame;
+		for (unsigned int idx=n-window; idx<n; idx++) {
+			if (ReadSlot(idx, frame)) {
+				frames.push_back(frame);
+			}
+		}
+
+		return (unsigned int)frames.size();
+	}
+
+	/*
+	=====================
+	FrameStats::ReadSlot
+	=====================
+	*/
+	bool FrameStats::ReadSlot(unsigned int idx, Frame &frame) const {
+		const Slot &slot = slots[idx & (PIM_FRAME_STATS_CAPACITY-1)];
+
+		unsigned int seq = slot.seq.load(memory_order_acquire);
+		if (seq != idx * 2 + 2) {
+			return false;
+		}
+
+		frame = slot.frame;
+
+		atomic_thread_fence(memory_order_acquire);
+		return slot.seq.load(memory_order_relaxed) == seq;
+	}
+
+	/*
+	=====================
+	FrameStats::GetSummary
+	=====================
+	*/
+	FrameStats::Summary FrameStats::GetSummary(Phase phase, unsigned int window) const {
+		Summary sum = { 0, 0.f, 0.f, 0.f, 0.f, 0.f, 0 };
+
+		vector<Frame> frames;
+		if (!GetFrames(window, frames)) {
+			return sum;
+		}
+
+		vector<float> times(frames.size());
+		for (unsigned i=0; i<frames.size(); i++) {
+			times[i] = frames[i].times[phase];
+			sum.average += times[i];
+
+			if (times[i] >= sum.worst) {
+				sum.worst = times[i];
+				sum.worstFrame = frames[i].index;
+			}
+		}
+
+		sum.frames = (unsigned int)frames.size();
+		sum.average /= float(sum.frames);
+
+		sort(times.begin(), times.end());
+
+		const float pct[3] = { 50.f, 95.f, 99.f };
+		float *dst[3] = { &sum.p50, &sum.p95, &sum.p99 };
+
+		for (int i=0; i<3; i++) {
+			unsigned int rank = (unsigned int)ceilf(sum.frames * pct[i] / 100.f);
+			*dst[i] = times[rank ? rank-1 : 0];
+		}
+
+		return sum;
+	}
+
+	/*
+	=====================
+	FrameStats::GetWorstFrames
+	=====================
+	*/
+	void FrameStats::GetWorstFrames(Phase phase, unsigned int window,
+									unsigned int num, vector<Frame> &frames) const {
+		GetFrames(window, frames);
+
+		if (num > frames.size()) {
+			num = (unsigned int)frames.size();
+		}
+
+		partial_sort(frames.begin(), frames.begin() + num, frames.end(),
+			[phase](const Frame &a, const Frame &b) {
+				return a.times[phase] > b.times[phase];
+			}
+		);
+
+		frames.resize(num);
+	}
+
+	/*
+	=====================
+	FrameStats::GetHistogram
+	=====================
+	*/
+	void FrameStats::GetHistogram(Phase phase, unsigned int window, float bucketSize,
+								  unsigned int *buckets, unsigned int numBuckets) const {
+		PimAssert(bucketSize > 0.f && numBuckets > 0, "Error: Invalid histogram buckets");
+
+		for (unsigned i=0; i<numBuckets; i++) {
+			buckets[i] = 0;
+		}
+
+		vector<Frame> frames;
+		GetFrames(window, frames);
+
+		for (unsigned i=0; i<frames.size(); i++) {
+			float b = frames[i].times[phase] / bucketSize;
+
+			if (b >= float(numBuckets - 1)) {
+				buckets[numBuckets-1]++;
+			} else {
+				buckets[(unsigned int)b]++;
+			}
+		}
+	}
+
+	/*
+	=====================
+	FrameStats::DumpCSV
+	=====================
+	*/
+	bool FrameStats::DumpCSV(const string &path) const {
+		FILE *file = fopen(path.c_str(), "w");
+		if (!file) {
+			PimWarning("Unable to create the frame statistics file", path.c_str());
+			return false;
+		}
+
+		fprintf(file, "frame");
+		for (int i=0; i<=PHASE_COUNT; i++) {
+			fprintf(file, ",%s_ms", phaseNames[i]);
+		}
+		fprintf(file, "\n");
+
+		vector<Frame> frames;
+		GetFrames(PIM_FRAME_STATS_CAPACITY, frames);
+
+		for (unsigned i=0; i<frames.size(); i++) {
+			fprintf(file, "%u", frames[i].index);
+
+			for (int j=0; j<=PHASE_COUNT; j++) {
+				fprintf(file, ",%.3f", frames[i].times[j] * 1000.f);
+			}
+
+			fprintf(file, "\n");
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	/*
+	=====================
+	FrameStats::SetDumpFile
+	=====================
+	*/
+	void FrameStats::SetDumpFile(const string &path) {
+		dumpFile = path;
+	}
+
+	/*
+	=====================
+	FrameStats::GetDumpFile
+	=====================
+	*/
+	const string& FrameStats::GetDumpFile() const {
+		return dumpFile;
+	}
+
+	/*
+	=====================
+	FrameStats::GetPhaseName
+	=====================
+	*/
+	const char* FrameStats::GetPhaseName(Phase phase) {
+		return phaseNames[phase];
+	}
+}
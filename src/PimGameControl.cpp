@@ -6,10 +6,12 @@
 #include "PimInput.h"
 #include "PimGameNode.h"
 #include "PimLayer.h"
+#include "PimLightingSystem.h"
 #include "PimShaderManager.h"
 #include "PimAudioManager.h"
 #include "PimScene.h"
 #include "PimConsoleReader.h"
+#include "PimTrace.h"
 
 #include <climits>
 #include <iostream>
@@ -20,6 +22,19 @@
 	#include <pthread.h>
 #endif
 
+#ifdef __APPLE__
+	#include <mach/mach_time.h>
+#endif
+
+// Sleep until this many seconds remain of the frame, then spin
+#define PIM_FRAME_SPIN_THRESHOLD	0.002
+
+// The time a low latency frame aims to leave before the retrace
+#define PIM_LOW_LATENCY_MARGIN		0.002f
+
+// Number of parallel frame listeners updated per job
+#define PIM_PARALLEL_UPDATE_GRAIN	64
+
 namespace Pim {
 
 	GameControl* GameControl::singleton = NULL;
@@ -30,22 +45,42 @@ namespace Pim {
 	 GameControl::GameControl
 	=====================
 	*/
-	GameControl::GameControl() {
+	GameControl::GameControl() : frameListeners(ListenerList::FRAME) {
 		PimAssert(singleton == NULL, "Only one GameControl instance can exist at a time.");
 
 		singleton		= this;
 		scene			= NULL;
 		newScene		= NULL;
+		jobSystem		= NULL;
+		frameStats		= new FrameStats();
+		updateTick		= 0;
+
+		deleteBudget	= 0.f;
+		deleteTimeLeft	= 0.f;
+		discardingScene	= false;
 
 		paused			= false;
 		pauseLayer		= NULL;
 
 		maxDelta		= 0.f;
+		fixedStep		= 0.f;
+		maxFixedSteps	= 5;
+		accumulator		= 0.f;
+		interpAlpha		= 1.f;
 		sleepNextFrame	= false;
 		sleepTime		= 0.f;
 
+		ticks			= GetTime();
+		frameTimeIdx	= 0;
+		frameTimeCount	= 0;
+
+		lowLatencyInput	= false;
+		inputDelay		= 0.f;
+		inputPending	= false;
+		inputStamp		= 0;
+		ResetInputLatency();
+
 #ifdef WIN32 /* Windows specific initialization */
-		ticks 			= clock();
 		
 		// Get the module path
 		char path[260] = { '\0' };
@@ -65,10 +100,6 @@ namespace Pim {
 		modulePath = path;
 		
 #elif defined __APPLE__ /* OSX specific initialization */
-		struct timeval time;
-		gettimeofday(&time, NULL);
-		ticks = Tick(time.tv_sec) + Tick(time.tv_usec / 1000000.0);
-		
 		modulePath = ".";
 		
 		
@@ -88,6 +119,8 @@ namespace Pim {
 		if (renderWindow) {
 			delete renderWindow;
 		}
+
+		delete frameStats;
 	}
 
 	/*
@@ -117,6 +150,24 @@ namespace Pim {
 		return singleton->renderWindow;
 	}
 
+	/*
+	=====================
+	GameControl::GetJobSystem
+	=====================
+	*/
+	JobSystem* GameControl::GetJobSystem() {
+		return singleton->jobSystem;
+	}
+
+	/*
+	=====================
+	GameControl::GetFrameStats
+	=====================
+	*/
+	FrameStats* GameControl::GetFrameStats() {
+		return singleton->frameStats;
+	}
+
 	/*
 	=====================
 	GameControl::GetWindowTitle
@@ -171,6 +222,41 @@ namespace Pim {
 		return singleton->scene;
 	}
 
+	/*
+	=====================
+	GameControl::GetTime
+
+	Returns the time in seconds from a monotonic clock. The clock is 
+	unaffected by changes to the system time.
+	=====================
+	*/
+	Tick GameControl::GetTime() {
+#ifdef WIN32
+		static LARGE_INTEGER freq = { 0 };
+		if (!freq.QuadPart) {
+			QueryPerformanceFrequency(&freq);
+		}
+
+		LARGE_INTEGER count;
+		QueryPerformanceCounter(&count);
+
+		return Tick(count.QuadPart) / Tick(freq.QuadPart);
+#elif defined __APPLE__
+		static mach_timebase_info_data_t timebase = { 0, 0 };
+		if (!timebase.denom) {
+			mach_timebase_info(&timebase);
+		}
+
+		uint64_t t = mach_absolute_time();
+		return Tick(t) * Tick(timebase.numer) / Tick(timebase.denom) / 1000000000.0;
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		return Tick(ts.tv_sec) + Tick(ts.tv_nsec) / 1000000000.0;
+#endif
+	}
+
 	/*
 	=====================
 	GameControl::GetCreationData
@@ -186,6 +272,8 @@ namespace Pim {
 	=====================
 	*/
 	void GameControl::Go(Scene *s, WinStyle::CreationData data, bool commandline) {
+		Trace::SetThreadName("Main");
+
 		try {
 			winData = data;
 			winData.Prepare();
@@ -202,6 +290,8 @@ namespace Pim {
 			printf("\n[PIM-version %s]\n", PIM_VERSION);
 			printf("[OpenGL-version %s]\n\n", glGetString(GL_VERSION));
 
+			jobSystem = new JobSystem();
+
 			Input::InstantiateSingleton();
 			ShaderManager::InstantiateSingleton();
 			AudioManager::InstantiateSingleton();
@@ -220,12 +310,23 @@ namespace Pim {
 					   "Exception thrown");
 		}
 
-		// Clean up the scene
-		if (scene) {
-			delete scene;
+		if (!frameStats->GetDumpFile().empty()) {
+			frameStats->DumpCSV(frameStats->GetDumpFile());
+		}
+
+		// Stop the workers before the nodes they may use are deleted
+		if (jobSystem) {
+			delete jobSystem;
+			jobSystem = NULL;
 		}
 
+		// Clean up the scene
+		DiscardScene(scene);
+		scene = NULL;
+
 		ClearDeleteQueue();
+		LightingSystem::PurgeLightTextureCache();
+		NodePool::Purge();
 
 		Input::ClearSingleton();
 		ShaderManager::ClearSingleton();
@@ -300,7 +401,7 @@ namespace Pim {
 	=====================
 	*/
 	void GameControl::AddFrameListener(GameNode *node) {
-		frameListeners.push_back(node);
+		frameListeners.Add(node);
 	}
 
 	/*
@@ -309,11 +410,7 @@ namespace Pim {
 	=====================
 	*/
 	void GameControl::RemoveFrameListener(GameNode *node) {
-		for (unsigned int i=0; i<frameListeners.size(); i++) {
-			if (frameListeners[i] == node) {
-				frameListeners.erase(frameListeners.begin() + i--);
-			}
-		}
+		frameListeners.Remove(node);
 	}
 
 	/*
@@ -338,6 +435,153 @@ namespace Pim {
 		}
 	}
 
+	/*
+	=====================
+	GameControl::SetFixedTimestep
+	=====================
+	*/
+	void GameControl::SetFixedTimestep(float step, unsigned int maxSteps) {
+		if (step < 0.f) {
+			step = 0.f;
+		}
+
+		fixedStep		= step;
+		maxFixedSteps	= (maxSteps) ? maxSteps : 1;
+		accumulator		= 0.f;
+		interpAlpha		= 1.f;
+	}
+
+	/*
+	=====================
+	GameControl::GetFixedTimestep
+	=====================
+	*/
+	float GameControl::GetFixedTimestep() const {
+		return fixedStep;
+	}
+
+	/*
+	=====================
+	GameControl::GetInterpolationAlpha
+	=====================
+	*/
+	float GameControl::GetInterpolationAlpha() const {
+		return interpAlpha;
+	}
+
+	/*
+	=====================
+	GameControl::GetAverageFrameTime
+	=====================
+	*/
+	float GameControl::GetAverageFrameTime() const {
+		if (!frameTimeCount) {
+			return 0.f;
+		}
+
+		float sum = 0.f;
+		for (int i=0; i<frameTimeCount; i++) {
+			sum += frameTimes[i];
+		}
+
+		return sum / frameTimeCount;
+	}
+
+	/*
+	=====================
+	GameControl::GetFrameTimeJitter
+	=====================
+	*/
+	float GameControl::GetFrameTimeJitter() const {
+		if (frameTimeCount < 2) {
+			return 0.f;
+		}
+
+		float avg = GetAverageFrameTime();
+		float sum = 0.f;
+
+		for (int i=0; i<frameTimeCount; i++) {
+			float d = frameTimes[i] - avg;
+			sum += d * d;
+		}
+
+		return sqrtf(sum / (frameTimeCount - 1));
+	}
+
+	/*
+	=====================
+	GameControl::SetLowLatencyInput
+	=====================
+	*/
+	void GameControl::SetLowLatencyInput(bool flag) {
+		lowLatencyInput = flag;
+		inputDelay = 0.f;
+	}
+
+	/*
+	=====================
+	GameControl::GetLowLatencyInput
+	=====================
+	*/
+	bool GameControl::GetLowLatencyInput() const {
+		return lowLatencyInput;
+	}
+
+	/*
+	=====================
+	GameControl::GetInputLatencyHistogram
+	=====================
+	*/
+	const unsigned int* GameControl::GetInputLatencyHistogram() const {
+		return latencyHistogram;
+	}
+
+	/*
+	=====================
+	GameControl::GetInputLatencySamples
+	=====================
+	*/
+	unsigned int GameControl::GetInputLatencySamples() const {
+		return latencySamples;
+	}
+
+	/*
+	=====================
+	GameControl::GetInputLatencyPercentile
+	=====================
+	*/
+	float GameControl::GetInputLatencyPercentile(float p) const {
+		if (!latencySamples) {
+			return 0.f;
+		}
+
+		unsigned int target = (unsigned int)ceilf(latencySamples * p / 100.f);
+		unsigned int sum = 0;
+
+		for (int i=0; i<PIM_INPUT_LATENCY_BUCKETS; i++) {
+			sum += latencyHistogram[i];
+
+			if (sum >= target && sum > 0) {
+				return i / 1000.f;
+			}
+		}
+
+		return (PIM_INPUT_LATENCY_BUCKETS - 1) / 1000.f;
+	}
+
+	/*
+	=====================
+	GameControl::ResetInputLatency
+	=====================
+	*/
+	void GameControl::ResetInputLatency() {
+		for (int i=0; i<PIM_INPUT_LATENCY_BUCKETS; i++) {
+			latencyHistogram[i] = 0;
+		}
+
+		latencySamples = 0;
+	}
+
 	/*
 	=====================
 	GameControl::Pause
@@ -453,7 +697,7 @@ namespace Pim {
 		PimAssert(ns != NULL, "Error: Cannot set scene: NULL.");
 
 		if (newScene) {
-			delete newScene;
+			DiscardScene(newScene);
 		}
 
 		newScene = ns;
@@ -468,11 +712,7 @@ namespace Pim {
 		if (newScene) {
 			ShaderManager::GetSingleton()->ClearShaders();
 
-			if (scene) {
-				delete scene;
-			}
-
-			ClearDeleteQueue();
+			DiscardScene(scene);
 
 			scene = newScene;
 			scene->LoadResources();
@@ -481,6 +721,7 @@ namespace Pim {
 
 			// Discard the new (and too high) delta time
 			CalculateDeltaTime();
+			accumulator = 0.f;
 		}
 	}
 
@@ -503,44 +744,100 @@ namespace Pim {
 		quit = false;
 
 		while (!quit) {
-			HandleEvents();
+			PIM_TRACE_ZONE("GameControl::Frame");
+
+			Tick frameStart = GetTime();
+			Tick mark = frameStart;
+
+			// In low latency mode, input is polled after the wait
+			if (!lowLatencyInput) {
+				HandleEvents();
+				frameStats->AddTime(FrameStats::EVENTS, Lap(mark));
+			}
+
+			// Wait out the remainder of the frame. Replays run flat out.
+			if (!Input::GetSingleton()->IsReplaying()) {
+				if (maxDelta > 0.f) {
+					WaitUntil(ticks + maxDelta);
+				} else if (lowLatencyInput && inputDelay > 0.f) {
+					WaitUntil(GetTime() + inputDelay);
+				}
+			}
+
+			frameStats->AddTime(FrameStats::WAIT, Lap(mark));
+
+			if (lowLatencyInput) {
+				HandleEvents();
+			}
+
+			// A replay feeds the recorded input in place of SDL's
+			float replayDt;
+			bool replaying = Input::GetSingleton()->ReplayFrame(replayDt);
+
+			frameStats->AddTime(FrameStats::EVENTS, Lap(mark));
 
 			// Get the DT
 			float dt = CalculateDeltaTime();
-			if (dt < maxDelta) {
+			RecordFrameTime(dt);
 
-#				ifdef WIN32
-					Sleep(DWORD(ceil((maxDelta-dt)*1000.f)));
-					dt += CalculateDeltaTime();
-#				else
-					usleep(ceil((maxDelta-dt)*1000000.f));
-					dt += CalculateDeltaTime();
-#				endif
+			if (replaying) {
+				dt = replayDt;
+			} else {
+				Input::GetSingleton()->RecordFrame(dt);
 			}
 
+			deleteTimeLeft = deleteBudget;
+			mark = GetTime();
+
 			if (!paused) {
 #				if defined(_DEBUG) && defined(WIN32)
 					ConsoleReader::GetSingleton()->Dispatch();
-					ClearDeleteQueue();
+					frameStats->AddTime(FrameStats::INPUT, Lap(mark));
+					ProcessDeleteQueue();
+					mark = GetTime();
 #				endif /* _DEBUG && WIN32 */
 
+				Input::GetSingleton()->RefreshHitBounds();
 				Input::GetSingleton()->Dispatch();
-				ClearDeleteQueue();
+				frameStats->AddTime(FrameStats::INPUT, Lap(mark));
+				ProcessDeleteQueue();
 
-				DispatchPrerender(dt);
+				if (fixedStep > 0.f) {
+					DispatchFixedPrerender(dt);
+				} else {
+					DispatchPrerender(dt);
+				}
 			} else {
 				// Dispatch input to all children of pauseLayer
 				Input::GetSingleton()->DispatchPaused(pauseLayer);
-				ClearDeleteQueue();
+				frameStats->AddTime(FrameStats::INPUT, Lap(mark));
+				ProcessDeleteQueue();
 
 				DispatchPausedPreRender(dt);
 			}
 
-			ClearDeleteQueue();
+			ProcessDeleteQueue();
+
+			// Run the jobs that must be run on the main thread (OpenGL)
+			mark = GetTime();
+			jobSystem->DispatchMainThreadJobs();
+			frameStats->AddTime(FrameStats::MAIN_THREAD_JOBS, Lap(mark));
 
 			renderWindow->RenderFrame();
 
+			float swapWait = renderWindow->GetSwapWait();
+			frameStats->AddTime(FrameStats::RENDER, Lap(mark) - swapWait);
+			frameStats->AddTime(FrameStats::SWAP, swapWait);
+
+			RecordInputLatency();
+
+			if (lowLatencyInput) {
+				AdjustInputDelay();
+			}
+
+			mark = GetTime();
 			AudioManager::GetSingleton()->UpdateSoundBuffers();
+			frameStats->AddTime(FrameStats::AUDIO, Lap(mark));
 
 			// Was the game recently unpaused?
 			if (pauseLayer && !paused) {
@@ -550,6 +847,8 @@ namespace Pim {
 
 			// If a new scene has been set, transition it here
 			SceneTransition();
+
+			frameStats->EndFrame(float(GetTime() - frameStart));
 		}
 
 		ClearDeleteQueue();
@@ -563,6 +862,7 @@ namespace Pim {
 	=====================
 	*/
 	void GameControl::HandleEvents() {
+		PIM_TRACE_ZONE("GameControl::HandleEvents");
 
 		/*	Window movement-events are NOT dispatched in SDL 1.2.15.
 		 *  When the window is moved, the app freezes and is unresponsive
@@ -576,12 +876,24 @@ namespace Pim {
 		 */
 
 #		ifdef WIN32
-			clock_t prepoll = clock();
+			Tick prepoll = GetTime();
 #		endif
 		
 		SDL_Event event;
+		bool replaying = Input::GetSingleton()->IsReplaying();
 
 		while (SDL_PollEvent(&event)) {
+			// The live input is ignored during a replay
+			if (replaying && event.type != SDL_QUIT && event.type != SDL_WINDOWEVENT) {
+				continue;
+			}
+
+			// The latency is measured from the oldest input event of the frame.
+			// All SDL events lead with the type and the timestamp.
+			if (!inputPending && event.type >= SDL_KEYDOWN && event.type < SDL_FINGERDOWN) {
+				inputPending = true;
+				inputStamp = event.key.timestamp;
+			}
 
 			switch (event.type) {
 				case SDL_QUIT:
@@ -683,8 +995,8 @@ namespace Pim {
 		}
 
 #		ifdef WIN32
-			clock_t postpoll = clock();
-			if (postpoll - prepoll > 3) {
+			Tick postpoll = GetTime();
+			if (postpoll - prepoll > 0.003) {
 				ticks += (postpoll - prepoll);
 			}
 #		endif
@@ -696,22 +1008,128 @@ namespace Pim {
 	=====================
 	*/
 	void GameControl::DispatchPrerender(float dt) {
+		PIM_TRACE_ZONE("GameControl::DispatchPrerender");
+
+		Tick start = GetTime();
+
 		scene->Update(dt);
 
-		int size = frameListeners.size();
-		
-		for (int i=0; i<size; i++) {
-			if (!frameListeners[i]->willDelete) {
-				frameListeners[i]->Update(dt);
-
-				// Account for nodes unlistening frame during
-				// Update-calls.
-				if (size > frameListeners.size()) {
-					i -= size - frameListeners.size();
+		// Nodes unlistening during Update-calls leave a NULL-slot behind
+		frameListeners.Compact();
+
+		updateTick++;
+
+		// Re-index the nodes moved since the last frame
+		SpatialIndex::RefreshAll();
+
+		for (unsigned int i=0; i<frameListeners.Size(); i++) {
+			GameNode *node = frameListeners[i];
+
+			if (node && !node->willDelete && !node->parallelUpdate) {
+				float delta = dt;
+
+				if (node->updateRate != GameNode::UPDATE_EVERY_FRAME &&
+					!node->ConsumeUpdate(dt, updateTick, delta)) {
+					continue;
+				}
+
+				node->Update(delta);
+			}
+		}
+
+		DispatchParallelUpdate(dt);
+
+		frameStats->AddTime(FrameStats::UPDATE, float(GetTime() - start));
+	}
+
+	/*
+	=====================
+	GameControl::DispatchParallelUpdate
+
+	Updates the frame listeners flagged with parallelUpdate on the
+	JobSystem. The listeners are split into fixed ranges, each job
+	recording into the buffer of it's range. The buffers are executed
+	in order afterwards, so the result does not depend on which thread
+	ran which range.
+	=====================
+	*/
+	void GameControl::DispatchParallelUpdate(float dt) {
+		PIM_TRACE_ZONE("GameControl::DispatchParallelUpdate");
+
+		parallelNodes.clear();
+		parallelDeltas.clear();
+
+		for (unsigned int i=0; i<frameListeners.Size(); i++) {
+			GameNode *node = frameListeners[i];
+
+			if (node && !node->willDelete && node->parallelUpdate) {
+				float delta = dt;
+
+				if (node->updateRate != GameNode::UPDATE_EVERY_FRAME &&
+					!node->ConsumeUpdate(dt, updateTick, delta)) {
+					continue;
+				}
+
+				parallelNodes.push_back(node);
+				parallelDeltas.push_back(delta);
+			}
+		}
+
+		if (parallelNodes.empty()) {
+			return;
+		}
+
+		unsigned int count = parallelNodes.size();
+		unsigned int numJobs = (count + PIM_PARALLEL_UPDATE_GRAIN - 1) / PIM_PARALLEL_UPDATE_GRAIN;
+
+		if (parallelCommands.size() < numJobs) {
+			parallelCommands.resize(numJobs);
+		}
+
+		jobSystem->ParallelFor(count, PIM_PARALLEL_UPDATE_GRAIN,
+			[&](unsigned first, unsigned last) {
+				CommandBuffer *prev = CommandBuffer::GetRecording();
+				CommandBuffer::SetRecording(&parallelCommands[first / PIM_PARALLEL_UPDATE_GRAIN]);
+
+				for (unsigned i=first; i<last; i++) {
+					parallelNodes[i]->Update(parallelDeltas[i]);
 				}
+
+				CommandBuffer::SetRecording(prev);
 			}
-			size = frameListeners.size();
+		);
+
+		for (unsigned int i=0; i<numJobs; i++) {
+			parallelCommands[i].Execute();
+		}
+	}
+
+	/*
+	=====================
+	GameControl::DispatchFixedPrerender
+
+	Dispatches as many fixed steps as there is room for in the
+	accumulator, but no more than maxFixedSteps. Time exceeding
+	the limit is discarded.
+	=====================
+	*/
+	void GameControl::DispatchFixedPrerender(float dt) {
+		accumulator += dt;
+
+		unsigned int steps = 0;
+		while (accumulator >= fixedStep && steps < maxFixedSteps) {
+			DispatchPrerender(fixedStep);
+			ProcessDeleteQueue();
+
+			accumulator -= fixedStep;
+			steps++;
+		}
+
+		if (accumulator >= fixedStep) {
+			accumulator = fmodf(accumulator, fixedStep);
 		}
+
+		interpAlpha = accumulator / fixedStep;
 	}
 
 	/*
@@ -724,6 +1142,85 @@ namespace Pim {
 		delQueue.push_back(node);
 	}
 
+	/*
+	=====================
+	GameControl::SetDeleteBudget
+	=====================
+	*/
+	void GameControl::SetDeleteBudget(float milliseconds) {
+		if (milliseconds < 0.f) {
+			milliseconds = 0.f;
+		}
+
+		deleteBudget	= milliseconds / 1000.f;
+		deleteTimeLeft	= deleteBudget;
+	}
+
+	/*
+	=====================
+	GameControl::GetDeleteBudget
+	=====================
+	*/
+	float GameControl::GetDeleteBudget() const {
+		return deleteBudget * 1000.f;
+	}
+
+	/*
+	=====================
+	GameControl::GetDeleteQueueSize
+	=====================
+	*/
+	unsigned int GameControl::GetDeleteQueueSize() const {
+		return delQueue.size();
+	}
+
+	/*
+	=====================
+	GameControl::ProcessDeleteQueue
+
+	Deletes nodes until the budget of the current frame is spent.
+	The budget is reset at the start of every frame, so the first 
+	call of each frame always deletes at least one node.
+	=====================
+	*/
+	void GameControl::ProcessDeleteQueue() {
+		if (delQueue.empty()) {
+			return;
+		}
+
+		PIM_TRACE_ZONE("GameControl::ProcessDeleteQueue");
+
+		if (deleteBudget <= 0.f) {
+			Tick start = GetTime();
+			ClearDeleteQueue();
+			frameStats->AddTime(FrameStats::DELETE_QUEUE, float(GetTime() - start));
+			return;
+		}
+
+		if (deleteTimeLeft <= 0.f) {
+			return;
+		}
+
+		Tick start = GetTime();
+		Tick end = start + deleteTimeLeft;
+
+		// Nodes may be queued by the destructors, so size() is re-read
+		unsigned i = 0;
+		while (i < delQueue.size()) {
+			delete delQueue[i++];
+
+			if (GetTime() >= end) {
+				break;
+			}
+		}
+
+		delQueue.erase(delQueue.begin(), delQueue.begin() + i);
+
+		float elapsed = float(GetTime() - start);
+		deleteTimeLeft -= elapsed;
+		frameStats->AddTime(FrameStats::DELETE_QUEUE, elapsed);
+	}
+
 	/*
 	=====================
 	GameControl::ClearDeleteQueue
@@ -737,14 +1234,38 @@ namespace Pim {
 		delQueue.clear();
 	}
 
+	/*
+	=====================
+	GameControl::DiscardScene
+	=====================
+	*/
+	void GameControl::DiscardScene(Scene *s) {
+		if (!s) {
+			return;
+		}
+
+		discardingScene = true;
+
+		delete s;
+		ClearDeleteQueue();
+
+		discardingScene = false;
+	}
+
 	/*
 	=====================
 	GameControl::DispatchPausedPreRender
 	=====================
 	*/
 	void GameControl::DispatchPausedPreRender(float dt) {
+		PIM_TRACE_ZONE("GameControl::DispatchPausedPreRender");
+
+		Tick start = GetTime();
+
 		// Iterate over ALL the children of pauseLayer
 		DispatchPreRender_r(pauseLayer, dt);
+
+		frameStats->AddTime(FrameStats::UPDATE, float(GetTime() - start));
 	}
 
 	/*
@@ -753,10 +1274,15 @@ namespace Pim {
 
 	Pre-render update calls are dispatched recursively. This dispatch
 	method is only used when the game is paused. All nodes in the 
-	"Paused node-tree" (children of 'pauseLayer') receives this update.
+	"Paused node-tree" (children of 'pauseLayer') receives this update,
+	except for sleeping subtrees.
 	=====================
 	*/
 	void GameControl::DispatchPreRender_r(GameNode *n, float dt) {
+		if (n->asleep) {
+			return;
+		}
+
 		n->Update(dt);
 
 		for (unsigned int i=0; i<n->children.size(); i++) {
@@ -767,51 +1293,123 @@ namespace Pim {
 	/*
 	=====================
 	GameControl::CalculateDeltaTime
-	 
-	WINDOWS IMPLEMENTATION
-	 
-	The Windows implementation uses the clock()-function to
-	calculate seconds since the application's launch.
 	=====================
 	*/
-#ifdef WIN32
 	float GameControl::CalculateDeltaTime() {
-		clock_t  newTick = clock();
-		
-		float dt = float(newTick - ticks) / CLOCKS_PER_SEC;
-		
+		Tick newTick = GetTime();
+		float dt = float(newTick - ticks);
+
 		ticks = newTick;
-		
+
 		return dt;
 	}
-#endif
-	
+
 	/*
 	=====================
-	GameControl::CalculateDeltaTime
-	
-	OS X IMPLEMENTATION    (UNDER CONSTRUCTION)
-	 
-	The OSX implementation uses the <sys/time> library to calculate
-	the delta time using the UNIX timestamp.
-	 
-	The delta time calculated from clock() by some fault wrong on OSX.
-	This method is less efficient, but more precise.
+	GameControl::WaitUntil
+
+	Sleeps until PIM_FRAME_SPIN_THRESHOLD seconds remain, then spins.
+	The OS scheduler is too coarse to wake up precisely on time. 
 	=====================
 	*/
-#if defined(__APPLE__) || defined(__gnu_linux__) 
-	float GameControl::CalculateDeltaTime() {
-		struct timeval time;
-		gettimeofday(&time, NULL);
-		
-		Tick newTick = Tick(time.tv_sec) + Tick(time.tv_usec / 1000000.0);
-		float dt = newTick - ticks;
-		
-		ticks = Tick(time.tv_sec) + Tick(time.tv_usec / 1000000.0);
-		
-		return dt;
+	void GameControl::WaitUntil(Tick time) {
+		while (true) {
+			Tick remaining = time - GetTime();
+			if (remaining <= 0.0) {
+				break;
+			}
+
+			if (remaining > PIM_FRAME_SPIN_THRESHOLD) {
+#				ifdef WIN32
+					Sleep(DWORD((remaining - PIM_FRAME_SPIN_THRESHOLD) * 1000.0));
+#				else
+					usleep(useconds_t((remaining - PIM_FRAME_SPIN_THRESHOLD) * 1000000.0));
+#				endif
+			}
+		}
+	}
+
+	/*
+	=====================
+	GameControl::RecordFrameTime
+	=====================
+	*/
+	void GameControl::RecordFrameTime(float dt) {
+		frameTimes[frameTimeIdx] = dt;
+		frameTimeIdx = (frameTimeIdx + 1) % PIM_FRAME_HISTORY;
+
+		if (frameTimeCount < PIM_FRAME_HISTORY) {
+			frameTimeCount++;
+		}
+	}
+
+	/*
+	=====================
+	GameControl::Lap
+
+	Returns the seconds since the mark, and moves the mark to now.
+	=====================
+	*/
+	float GameControl::Lap(Tick &mark) {
+		Tick now = GetTime();
+		float elapsed = float(now - mark);
+		mark = now;
+		return elapsed;
+	}
+
+	/*
+	=====================
+	GameControl::RecordInputLatency
+
+	Called after the buffer swap. SDL timestamps events in milliseconds.
+	=====================
+	*/
+	void GameControl::RecordInputLatency() {
+		if (!inputPending) {
+			return;
+		}
+
+		inputPending = false;
+
+		unsigned int ms = SDL_GetTicks() - inputStamp;
+		if (ms >= PIM_INPUT_LATENCY_BUCKETS) {
+			ms = PIM_INPUT_LATENCY_BUCKETS - 1;
+		}
+
+		latencyHistogram[ms]++;
+		latencySamples++;
+	}
+
+	/*
+	=====================
+	GameControl::AdjustInputDelay
+
+	Steers the delay of the input poll so the buffer swap waits for
+	about PIM_LOW_LATENCY_MARGIN seconds. A missed retrace shows up as
+	a long frame, and halves the delay.
+	=====================
+	*/
+	void GameControl::AdjustInputDelay() {
+		// The frame limiter already polls late
+		if (maxDelta > 0.f || renderWindow->GetSwapInterval() == 0) {
+			inputDelay = 0.f;
+			return;
+		}
+
+		float avg = GetAverageFrameTime();
+		float last = frameTimes[(frameTimeIdx + PIM_FRAME_HISTORY - 1) % PIM_FRAME_HISTORY];
+		float slack = renderWindow->GetSwapWait() - PIM_LOW_LATENCY_MARGIN;
+
+		if (slack < 0.f || last > avg * 1.5f) {
+			inputDelay *= 0.5f;
+		} else {
+			inputDelay += slack * 0.1f;
+		}
+
+		if (inputDelay > avg) {
+			inputDelay = avg;
+		}
 	}
-#endif
 
 	/*
 	==================
@@ -10,10 +10,24 @@
 #include "PimScene.h"
 #include "PimLightingSystem.h"
 #include "PimAction.h"
+#include "PimCommandBuffer.h"
+#include "PimSpatialIndex.h"
 
 #include <iostream>
+#include <algorithm>
 
 namespace Pim {
+	// Nodes are plentiful - make sure their size is a conscious decision.
+	// GameNode was 128 bytes on 64-bit targets before it was packed, and
+	// grew from 112 bytes to cache it's bounds for culling layers.
+	static_assert(sizeof(GameNode) <= ((sizeof(void*) == 8) ? 136 : 108),
+				  "GameNode has grown, consider the memory footprint of large scenes");
+
+	unsigned int GameNode::sequenceCounter = 0;
+	bool GameNode::drawingFlat = false;
+	unsigned int GameNode::sleepCount = 0;
+	bool GameNode::cullingActive = false;
+
 	/*
 	=====================
 	GameNode::GameNode
@@ -27,7 +41,46 @@ namespace Pim {
 		willDelete				= false;
 		shadowShape				= NULL;
 		dbgShadowShape			= false;
+		indexed					= false;
+		parallelUpdate			= false;
+		asleep					= false;
+		dormant					= false;
+		drawn					= false;
+		culled					= false;
+		boundsKnown				= false;
+		boundsDirty				= true;
+		moved					= true;
+		cullState				= CULL_PARTIAL;
+		spatial					= false;
+		mouseHitTest			= false;
+		updateRate				= UPDATE_EVERY_FRAME;
+		updateInterval			= 1;
+		updateDelta				= 0.f;
+		kind					= NODE_KIND;
+		sequence				= 0;
 		userData				= NULL;
+
+		for (int i=0; i<ListenerList::TYPE_COUNT; i++) {
+			listenSlot[i]		= -1;
+		}
+	}
+
+	/*
+	=====================
+	GameNode::operator new
+	=====================
+	*/
+	void* GameNode::operator new(size_t size) {
+		return NodePool::Allocate(size);
+	}
+
+	/*
+	=====================
+	GameNode::operator delete
+	=====================
+	*/
+	void GameNode::operator delete(void *ptr, size_t size) {
+		NodePool::Free(ptr, size);
 	}
 
 	/*
@@ -53,7 +106,11 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::PrepareDeletion() {
-		if (GetParentLayer()) {
+		// The lighting systems are deleted along with a discarded scene
+		GameControl *gc = GameControl::GetSingleton();
+		bool discarding = gc && gc->discardingScene;
+
+		if (!discarding && GetParentLayer()) {
 			GetParentLayer()->RemoveLight(this);
 			GetParentLayer()->RemoveShadowCaster(this);
 		}
@@ -64,9 +121,20 @@ namespace Pim {
 
 		RemoveAllChildren();
 
+		UnlistenFrame();
 		UnlistenInput();
 		UnlistenController();
 
+		if (asleep) {
+			asleep = false;
+			sleepCount--;
+		}
+
+		if (spatial) {
+			SpatialIndex::RemoveFromAll(this);
+			spatial = false;
+		}
+
 		parent = NULL;
 		willDelete = true;
 	}
@@ -77,19 +145,40 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::AddChild(GameNode *ch) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->AddChild(this, ch);
+			return;
+		}
+
 		PimAssert(!ch->GetParent(), "Node already has a parent");
 
-		Layer *layer = dynamic_cast<Layer*>(ch);
+		Layer *layer = ch->As<Layer>();
 		if (layer) {
 			layer->LoadResources();
 		}
 
 		ch->parent = this;
+		ch->sequence = ++sequenceCounter;
 		children.push_back(ch);
 
+		if (indexed && GetParentScene()) {
+			GetParentScene()->IndexSubtree(ch);
+		}
+
+		// Added to a sleeping subtree
+		if (sleepCount && !ch->asleep && !IsAwake()) {
+			ch->SetSubtreeDormant(true);
+		}
+
 		ch->OnParentChange(this);
 
 		dirtyZOrder = true;
+
+		// Actions are not drawn
+		if (!(ch->GetKind() & KIND_BASE_ACTION)) {
+			InvalidateDrawList(true);
+			ch->MarkMoved();
+		}
 	}
 
 	/*
@@ -98,12 +187,29 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::RemoveChild(GameNode *ch, bool cleanup) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->RemoveChild(this, ch, cleanup);
+			return;
+		}
+
 		for (unsigned int i=0; i<children.size(); i++) {
 			if (children[i] == ch) {
+				if (ch->indexed && GetParentScene()) {
+					GetParentScene()->UnindexSubtree(ch);
+				}
+
 				children.erase(children.begin() + i);
 
+				if (!(ch->GetKind() & KIND_BASE_ACTION)) {
+					InvalidateDrawList(true);
+					MarkBoundsDirty();
+				}
+
 				if (cleanup) {
 					GameControl::GetSingleton()->AddNodeToDelete(ch);
+				} else if (sleepCount && !ch->asleep && !IsAwake()) {
+					// Removed from a sleeping subtree
+					ch->SetSubtreeDormant(false);
 				}
 				
 				ch->parent = NULL;
@@ -119,10 +225,24 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::RemoveAllChildren(bool cleanup) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->RemoveAllChildren(this, cleanup);
+			return;
+		}
+
+		Scene *scene = (indexed) ? GetParentScene() : NULL;
+		bool sleeping = !cleanup && sleepCount && !IsAwake();
+
 		// Delete all if required
 		for (unsigned i=0; i<children.size(); i++) {
+			if (scene) {
+				scene->UnindexSubtree(children[i]);
+			}
+
 			if (cleanup) {
 				GameControl::GetSingleton()->AddNodeToDelete(children[i]);
+			} else if (sleeping && !children[i]->asleep) {
+				children[i]->SetSubtreeDormant(false);
 			}
 
 			children[i]->parent = NULL;
@@ -132,6 +252,8 @@ namespace Pim {
 
 		// THEN clear the array
 		children.clear();
+		InvalidateDrawList(true);
+		MarkBoundsDirty();
 	}
 	
 	/*
@@ -164,6 +286,158 @@ namespace Pim {
 		return count;
 	}
 	
+	/*
+	=====================
+	GameNode::GetKind
+	=====================
+	*/
+	unsigned int GameNode::GetKind() const {
+		return kind;
+	}
+
+	/*
+	=====================
+	GameNode::SetIdentifier
+	=====================
+	*/
+	void GameNode::SetIdentifier(const Identifier &id) {
+		Scene *scene = (indexed) ? GetParentScene() : NULL;
+
+		if (scene) {
+			scene->UnindexNode(this);
+		}
+
+		identifier = id;
+
+		if (scene) {
+			scene->IndexNode(this);
+		}
+	}
+
+	/*
+	=====================
+	GameNode::SetIdentifier
+
+	The only place strings are interned on behalf of the user.
+	=====================
+	*/
+	void GameNode::SetIdentifier(const string &id) {
+		SetIdentifier(Identifier(id));
+	}
+
+	/*
+	=====================
+	GameNode::GetIdentifier
+	=====================
+	*/
+	const Identifier& GameNode::GetIdentifier() const {
+		return identifier;
+	}
+
+	/*
+	=====================
+	GameNode::FindChild
+	=====================
+	*/
+	GameNode* GameNode::FindChild(const Identifier &id) {
+		if (id.IsEmpty()) {
+			return NULL;
+		}
+
+		Scene *scene = (indexed) ? GetParentScene() : NULL;
+
+		if (scene) {
+			auto range = scene->nodeIndex.equal_range(id.GetID());
+
+			for (auto it=range.first; it!=range.second; it++) {
+				if (IsAncestorOf(it->second)) {
+					return it->second;
+				}
+			}
+
+			return NULL;
+		}
+
+		for (unsigned i=0; i<children.size(); i++) {
+			if (children[i]->identifier == id) {
+				return children[i];
+			}
+
+			GameNode *node = children[i]->FindChild(id);
+			if (node) {
+				return node;
+			}
+		}
+
+		return NULL;
+	}
+
+	/*
+	=====================
+	GameNode::FindChild
+	=====================
+	*/
+	GameNode* GameNode::FindChild(const string &id) {
+		return FindChild(Identifier::Find(id));
+	}
+
+	/*
+	=====================
+	GameNode::FindChildren
+	=====================
+	*/
+	void GameNode::FindChildren(const Identifier &id, vector<GameNode*> &nodes) {
+		if (id.IsEmpty()) {
+			return;
+		}
+
+		Scene *scene = (indexed) ? GetParentScene() : NULL;
+
+		if (scene) {
+			auto range = scene->nodeIndex.equal_range(id.GetID());
+
+			for (auto it=range.first; it!=range.second; it++) {
+				if (IsAncestorOf(it->second)) {
+					nodes.push_back(it->second);
+				}
+			}
+
+			return;
+		}
+
+		for (unsigned i=0; i<children.size(); i++) {
+			if (children[i]->identifier == id) {
+				nodes.push_back(children[i]);
+			}
+
+			children[i]->FindChildren(id, nodes);
+		}
+	}
+
+	/*
+	=====================
+	GameNode::FindChildren
+	=====================
+	*/
+	void GameNode::FindChildren(const string &id, vector<GameNode*> &nodes) {
+		FindChildren(Identifier::Find(id), nodes);
+	}
+
+	/*
+	=====================
+	GameNode::IsAncestorOf
+	=====================
+	*/
+	bool GameNode::IsAncestorOf(const GameNode *node) const {
+		for (node = node->parent; node; node = node->parent) {
+			if (node == this) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	/*
 	=====================
 	GameNode::GetParent
@@ -203,8 +477,8 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::ListenInput() {
-		GameControl::GetSingleton()->AddKeyListener(this);
-		GameControl::GetSingleton()->AddMouseListener(this);
+		ListenKeys();
+		ListenMouse();
 	}
 
 	/*
@@ -213,8 +487,8 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::UnlistenInput() {
-		GameControl::GetSingleton()->RemoveKeyListener(this);
-		GameControl::GetSingleton()->RemoveMouseListener(this);
+		UnlistenKeys();
+		UnlistenMouse();
 	}
 
 	/*
@@ -223,7 +497,9 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::ListenKeys() {
-		GameControl::GetSingleton()->AddKeyListener(this);
+		if (!DeferListen(ListenerList::KEYS, true)) {
+			GameControl::GetSingleton()->AddKeyListener(this);
+		}
 	}
 
 	/*
@@ -232,7 +508,9 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::UnlistenKeys() {
-		GameControl::GetSingleton()->RemoveKeyListener(this);
+		if (!DeferListen(ListenerList::KEYS, false)) {
+			GameControl::GetSingleton()->RemoveKeyListener(this);
+		}
 	}
 
 	/*
@@ -241,7 +519,9 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::ListenMouse() {
-		GameControl::GetSingleton()->AddMouseListener(this);
+		if (!DeferListen(ListenerList::MOUSE, true)) {
+			GameControl::GetSingleton()->AddMouseListener(this);
+		}
 	}
 
 	/*
@@ -250,7 +530,42 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::UnlistenMouse() {
-		GameControl::GetSingleton()->RemoveMouseListener(this);
+		if (!DeferListen(ListenerList::MOUSE, false)) {
+			GameControl::GetSingleton()->RemoveMouseListener(this);
+		}
+	}
+
+	/*
+	=====================
+	GameNode::SetMouseHitTest
+	=====================
+	*/
+	void GameNode::SetMouseHitTest(bool flag) {
+		if (flag == mouseHitTest) {
+			return;
+		}
+
+		// Listeners are moved to or from the hit index when they are added
+		bool listening = listenSlot[ListenerList::MOUSE] != -1;
+
+		if (listening) {
+			UnlistenMouse();
+		}
+
+		mouseHitTest = flag;
+
+		if (listening) {
+			ListenMouse();
+		}
+	}
+
+	/*
+	=====================
+	GameNode::GetMouseHitTest
+	=====================
+	*/
+	bool GameNode::GetMouseHitTest() const {
+		return mouseHitTest;
 	}
 
 	/*
@@ -259,7 +574,9 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::ListenController() {
-		GameControl::GetSingleton()->AddControlListener(this);
+		if (!DeferListen(ListenerList::CONTROLLER, true)) {
+			GameControl::GetSingleton()->AddControlListener(this);
+		}
 	}
 
 	/*
@@ -268,7 +585,9 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::UnlistenController() {
-		GameControl::GetSingleton()->RemoveControlListener(this);
+		if (!DeferListen(ListenerList::CONTROLLER, false)) {
+			GameControl::GetSingleton()->RemoveControlListener(this);
+		}
 	}
 
 	/*
@@ -277,7 +596,16 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::ListenFrame() {
-		GameControl::GetSingleton()->AddFrameListener(this);
+		if (DeferListen(ListenerList::FRAME, true)) {
+			return;
+		}
+
+		if (sleepCount && !IsAwake()) {
+			// Added to the list when the subtree wakes up
+			dormant = true;
+		} else {
+			GameControl::GetSingleton()->AddFrameListener(this);
+		}
 	}
 
 	/*
@@ -286,97 +614,251 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::UnlistenFrame() {
-		GameControl::GetSingleton()->RemoveFrameListener(this);
+		if (!DeferListen(ListenerList::FRAME, false)) {
+			dormant = false;
+			GameControl::GetSingleton()->RemoveFrameListener(this);
+		}
 	}
 
 	/*
 	=====================
-	GameNode::GetWorldPosition
+	GameNode::SetParallelUpdate
 	=====================
 	*/
-	Vec2 GameNode::GetWorldPosition() const {
-		if (parent) {
-			return position.RotateAroundPoint(Vec2(0.f, 0.f), parent->GetWorldRotation()) +
-					parent->GetWorldPosition();
-		}
-		return position;
+	void GameNode::SetParallelUpdate(bool flag) {
+		parallelUpdate = flag;
 	}
 
 	/*
 	=====================
-	GameNode::GetLayerPosition
+	GameNode::GetParallelUpdate
 	=====================
 	*/
-	Vec2 GameNode::GetLayerPosition() const {
-		if (parent) {
-			return position.RotateAroundPoint(Vec2(0.f, 0.f), parent->GetLayerRotation()) +
-					parent->GetLayerPosition();
-		}
-		return position;
+	bool GameNode::GetParallelUpdate() const {
+		return parallelUpdate != 0;
 	}
 
 	/*
 	=====================
-	GameNode::GetWorldRotation
+	GameNode::SetSleeping
 	=====================
 	*/
-	float GameNode::GetWorldRotation() const {
-		if (parent) {
-			return rotation + parent->GetWorldRotation();
+	void GameNode::SetSleeping(bool flag) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->SetSleeping(this, flag);
+			return;
+		}
+
+		if (flag == (asleep != 0)) {
+			return;
+		}
+
+		bool wasAwake = IsAwake();
+
+		asleep = flag;
+		if (flag) {
+			sleepCount++;
+		} else {
+			sleepCount--;
+		}
+
+		if (IsAwake() != wasAwake) {
+			SetSubtreeDormant(wasAwake);
 		}
-		return rotation;
 	}
 
 	/*
-	==================
-	GameNode::GetLayerRotation
-	==================
+	=====================
+	GameNode::IsSleeping
+	=====================
 	*/
-	float GameNode::GetLayerRotation() const {
-		if (parent) {
-			return rotation + parent->GetLayerRotation();
-		}
-		return rotation;
+	bool GameNode::IsSleeping() const {
+		return asleep != 0;
 	}
 
 	/*
 	=====================
-	GameNode::Draw
+	GameNode::IsAwake
 	=====================
 	*/
-	void GameNode::Draw() {
-		glPushMatrix();
-		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+	bool GameNode::IsAwake() const {
+		for (const GameNode *node=this; node; node=node->parent) {
+			if (node->asleep) {
+				return false;
+			}
+		}
 
-		glTranslatef(position.x / fac.x, position.y / fac.y, 0.f);
-		glRotatef(rotation, 0.f, 0.f, 1.f);
+		return true;
+	}
 
-		if (shadowShape && dbgShadowShape) {
-			glPushMatrix();
+	/*
+	=====================
+	GameNode::SetUpdateRate
+	=====================
+	*/
+	void GameNode::SetUpdateRate(UpdateRate rate, unsigned int interval) {
+		PimAssert(interval >= 1 && interval <= PIM_MAX_UPDATE_INTERVAL,
+				  "Error: Update interval out of range");
 
-			fac = GameControl::GetSingleton()->GetWindowScale();
-			glScalef(fac.x, fac.y, 1.f);
+		updateRate		= rate;
+		updateInterval	= (rate == UPDATE_EVERY_NTH_FRAME) ? interval : 1;
+	}
 
-			shadowShape->DebugDraw();
+	/*
+	=====================
+	GameNode::GetUpdateRate
+	=====================
+	*/
+	GameNode::UpdateRate GameNode::GetUpdateRate() const {
+		return (UpdateRate)updateRate;
+	}
 
-			glPopMatrix();
-		}
+	/*
+	=====================
+	GameNode::GetUpdateInterval
+	=====================
+	*/
+	unsigned int GameNode::GetUpdateInterval() const {
+		return updateInterval;
+	}
 
-		OrderChildren();
+	/*
+	=====================
+	GameNode::SetSubtreeDormant
 
-		for (unsigned int i=0; i<children.size(); i++) {
-			children[i]->Draw();
+	Parks or unparks the frame listeners of this node and it's
+	descendants. Subtrees flagged asleep on their own are skipped,
+	as their state does not change.
+	=====================
+	*/
+	void GameNode::SetSubtreeDormant(bool flag) {
+		GameControl *gc = GameControl::GetSingleton();
+
+		if (flag) {
+			if (listenSlot[ListenerList::FRAME] >= 0) {
+				gc->RemoveFrameListener(this);
+				dormant = true;
+			}
+		} else if (dormant) {
+			dormant = false;
+			gc->AddFrameListener(this);
 		}
 
-		glPopMatrix();
+		for (unsigned i=0; i<children.size(); i++) {
+			if (!children[i]->asleep) {
+				children[i]->SetSubtreeDormant(flag);
+			}
+		}
 	}
 
 	/*
 	=====================
-	GameNode::BatchDraw
+	GameNode::ConsumeUpdate
+
+	Accumulates the time step of a node with a reduced update rate.
+	Returns true and the accumulated time if the node is due.
 	=====================
 	*/
-	void GameNode::BatchDraw() {
+	bool GameNode::ConsumeUpdate(float dt, unsigned int tick, float &delta) {
+		updateDelta += dt;
+
+		if (updateRate == UPDATE_EVERY_NTH_FRAME) {
+			if ((tick + sequence) % updateInterval != 0) {
+				return false;
+			}
+		} else if (updateRate == UPDATE_WHEN_VISIBLE) {
+			if (!drawn) {
+				return false;
+			}
+
+			drawn = false;
+		}
+
+		delta = updateDelta;
+		updateDelta = 0.f;
+		return true;
+	}
+
+	/*
+	=====================
+	GameNode::DeferListen
+
+	Records the Listen- or Unlisten-call if the thread is recording
+	into a CommandBuffer. Returns false if the call must be executed.
+	=====================
+	*/
+	bool GameNode::DeferListen(int type, bool listen) {
+		CommandBuffer *cmd = CommandBuffer::GetRecording();
+
+		if (!cmd) {
+			return false;
+		}
+
+		if (listen) {
+			cmd->Listen(this, type);
+		} else {
+			cmd->Unlisten(this, type);
+		}
+
+		return true;
+	}
+
+	/*
+	=====================
+	GameNode::GetWorldPosition
+	=====================
+	*/
+	Vec2 GameNode::GetWorldPosition() const {
+		if (parent) {
+			return position.RotateAroundPoint(Vec2(0.f, 0.f), parent->GetWorldRotation()) +
+					parent->GetWorldPosition();
+		}
+		return position;
+	}
+
+	/*
+	=====================
+	GameNode::GetLayerPosition
+	=====================
+	*/
+	Vec2 GameNode::GetLayerPosition() const {
+		if (parent) {
+			return position.RotateAroundPoint(Vec2(0.f, 0.f), parent->GetLayerRotation()) +
+					parent->GetLayerPosition();
+		}
+		return position;
+	}
+
+	/*
+	=====================
+	GameNode::GetWorldRotation
+	=====================
+	*/
+	float GameNode::GetWorldRotation() const {
+		if (parent) {
+			return rotation + parent->GetWorldRotation();
+		}
+		return rotation;
+	}
+
+	/*
+	==================
+	GameNode::GetLayerRotation
+	==================
+	*/
+	float GameNode::GetLayerRotation() const {
+		if (parent) {
+			return rotation + parent->GetLayerRotation();
+		}
+		return rotation;
+	}
+
+	/*
+	=====================
+	GameNode::Draw
+	=====================
+	*/
+	void GameNode::Draw() {
 		glPushMatrix();
 		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
 
@@ -394,14 +876,38 @@ namespace Pim {
 			glPopMatrix();
 		}
 
-		OrderChildren();
+		DrawChildren();
 
-		for (unsigned int i=0; i<children.size(); i++) {
-			// This is the only difference from GameNode::draw(): batchDraw is called
-			// on the node's children.
-			children[i]->BatchDraw();
+		glPopMatrix();
+	}
+
+	/*
+	=====================
+	GameNode::BatchDraw
+	=====================
+	*/
+	void GameNode::BatchDraw() {
+		glPushMatrix();
+		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+
+		glTranslatef(position.x / fac.x, position.y / fac.y, 0.f);
+		glRotatef(rotation, 0.f, 0.f, 1.f);
+
+		if (shadowShape && dbgShadowShape) {
+			glPushMatrix();
+
+			fac = GameControl::GetSingleton()->GetWindowScale();
+			glScalef(fac.x, fac.y, 1.f);
+
+			shadowShape->DebugDraw();
+
+			glPopMatrix();
 		}
 
+		// This is the only difference from GameNode::draw(): batchDraw is called
+		// on the node's children.
+		BatchDrawChildren();
+
 		glPopMatrix();
 	}
 
@@ -411,11 +917,21 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::SetZOrder(const int z) {
-		if (parent) {
-			parent->dirtyZOrder = true;
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->SetZOrder(this, z);
+			return;
+		}
+
+		if (z == zOrder) {
+			return;
 		}
 
 		zOrder = z;
+
+		if (parent) {
+			parent->dirtyZOrder = true;
+			parent->InvalidateDrawList(false);
+		}
 	}
 
 	/*
@@ -433,23 +949,416 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::OrderChildren() {
-		if (!dirtyZOrder || children.size() <= 1) {
+		if (!dirtyZOrder) {
 			return;
 		}
 
-		// Insertion sorting - the children should be somewhat sorted already.
-		for (int j=1; j<children.size(); j++) {
-			GameNode *key = children[j];
-			int i = j - 1;
+		SortByRenderKey(children.begin(), children.end());
+		dirtyZOrder = false;
+	}
 
-			while (i >= 0 && children[i]->zOrder > key->zOrder) {
-				children[i+1] = children[i];
-				i--;
+	/*
+	=====================
+	GameNode::ApplyChildTransform
+	=====================
+	*/
+	void GameNode::ApplyChildTransform() {
+		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+
+		glTranslatef(position.x / fac.x, position.y / fac.y, 0.f);
+		glRotatef(rotation, 0.f, 0.f, 1.f);
+	}
+
+	/*
+	=====================
+	GameNode::DrawChildren
+	=====================
+	*/
+	void GameNode::DrawChildren() {
+		if (drawingFlat) {
+			return;
+		}
+
+		OrderChildren();
+
+		for (unsigned int i=0; i<children.size(); i++) {
+			if (cullingActive && children[i]->culled) {
+				continue;
 			}
-			children[i+1] = key;
+
+			children[i]->drawn = true;
+			children[i]->Draw();
 		}
+	}
 
-		dirtyZOrder = false;
+	/*
+	=====================
+	GameNode::BatchDrawChildren
+	=====================
+	*/
+	void GameNode::BatchDrawChildren() {
+		OrderChildren();
+
+		for (unsigned int i=0; i<children.size(); i++) {
+			if (cullingActive && children[i]->culled) {
+				continue;
+			}
+
+			children[i]->drawn = true;
+			children[i]->BatchDraw();
+		}
+	}
+
+	/*
+	=====================
+	GameNode::GetChildTransform
+	=====================
+	*/
+	void GameNode::GetChildTransform(Transform2D &t) const {
+		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+
+		t.Translate(position.x / fac.x, position.y / fac.y);
+		t.Rotate(rotation);
+	}
+
+	/*
+	=====================
+	GameNode::GetContentBounds
+
+	What a derived class draws is unknown, so it is never culled.
+	=====================
+	*/
+	bool GameNode::GetContentBounds(const Transform2D &/*parent*/, AABB &bounds) const {
+		bounds = AABB();
+		return false;
+	}
+
+	/*
+	=====================
+	GameNode::GetLayerBounds
+	=====================
+	*/
+	bool GameNode::GetLayerBounds(AABB &bounds) const {
+		Transform2D t;
+
+		if (parent) {
+			parent->GetLayerTransform(t);
+		} else {
+			Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+			t.Scale(fac.x, fac.y);
+		}
+
+		return GetContentBounds(t, bounds);
+	}
+
+	/*
+	=====================
+	GameNode::GetSubtreeBounds
+	=====================
+	*/
+	bool GameNode::GetSubtreeBounds(AABB &bounds) const {
+		Transform2D t;
+
+		if (parent) {
+			parent->GetLayerTransform(t);
+		} else {
+			Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+			t.Scale(fac.x, fac.y);
+		}
+
+		return CollectBounds(const_cast<GameNode*>(this), t, bounds);
+	}
+
+	/*
+	=====================
+	GameNode::GetHitBounds
+	=====================
+	*/
+	bool GameNode::GetHitBounds(AABB &bounds) const {
+		GetSubtreeBounds(bounds);
+		return !bounds.IsEmpty();
+	}
+
+	/*
+	=====================
+	GameNode::GetScreenBounds
+	=====================
+	*/
+	bool GameNode::GetScreenBounds(AABB &bounds) const {
+		if (!GetHitBounds(bounds)) {
+			return false;
+		}
+
+		Layer *layer = const_cast<GameNode*>(this)->GetParentLayer();
+
+		if (layer) {
+			Transform2D t;
+			layer->GetScreenTransform(t);
+			bounds = t.Apply(bounds);
+		}
+
+		return true;
+	}
+
+	/*
+	=====================
+	GameNode::GetNodeTransform
+
+	Returns the transformation Draw() applies before drawing the node.
+	=====================
+	*/
+	Transform2D GameNode::GetNodeTransform(const Transform2D &parent) const {
+		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+
+		Transform2D t = parent;
+		t.Translate(position.x / fac.x, position.y / fac.y);
+		t.Rotate(rotation);
+		return t;
+	}
+
+	/*
+	=====================
+	GameNode::GetLayerTransform
+
+	Computes the transformation from the space of the children of
+	this node to the coordinates of it's layer.
+	=====================
+	*/
+	void GameNode::GetLayerTransform(Transform2D &t) const {
+		if ((kind & KIND_LAYER) || !parent) {
+			Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+
+			t = Transform2D();
+			t.Scale(fac.x, fac.y);
+
+			if (!(kind & KIND_LAYER)) {
+				GetChildTransform(t);
+			}
+			return;
+		}
+
+		parent->GetLayerTransform(t);
+		GetChildTransform(t);
+	}
+
+	/*
+	=====================
+	GameNode::MarkMoved
+	=====================
+	*/
+	void GameNode::MarkMoved() {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->MarkMoved(this);
+			return;
+		}
+
+		moved = true;
+		MarkBoundsDirty();
+	}
+
+	/*
+	=====================
+	GameNode::MarkBoundsDirty
+
+	The ancestors of a dirty node are dirty, up to the layer,
+	so the walk stops at the first dirty ancestor.
+	=====================
+	*/
+	void GameNode::MarkBoundsDirty() {
+		boundsDirty = true;
+
+		for (GameNode *n=parent; n && !(n->kind & KIND_LAYER) && !n->boundsDirty; n=n->parent) {
+			n->boundsDirty = true;
+		}
+	}
+
+	/*
+	=====================
+	GameNode::CollectBounds
+	=====================
+	*/
+	bool GameNode::CollectBounds(GameNode *node, const Transform2D &parent, AABB &bounds) {
+		// Nested layers cull their own children
+		if (node->kind & KIND_LAYER) {
+			bounds = AABB();
+			return false;
+		}
+
+		bool bounded = node->GetContentBounds(parent, bounds);
+
+		if (node->children.size()) {
+			Transform2D t = parent;
+			node->GetChildTransform(t);
+
+			for (unsigned i=0; i<node->children.size(); i++) {
+				GameNode *child = node->children[i];
+				AABB box;
+
+				if (child->kind & KIND_BASE_ACTION) {
+					continue;
+				}
+
+				if (!CollectBounds(child, t, box)) {
+					bounded = false;
+				}
+
+				bounds.Extend(box);
+			}
+		}
+
+		return bounded;
+	}
+
+	/*
+	=====================
+	GameNode::CullSubtree
+	=====================
+	*/
+	void GameNode::CullSubtree(GameNode *node, const Transform2D &parent, bool moved,
+							   const AABB &view) {
+		if (node->kind & KIND_LAYER) {
+			node->culled = false;
+			node->boundsKnown = false;
+			return;
+		}
+
+		moved = moved || node->moved;
+
+		if (!moved && !node->boundsDirty) {
+			CullCached(node, view);
+			return;
+		}
+
+		AABB bounds;
+		bool bounded = node->GetContentBounds(parent, bounds);
+
+		if (node->children.size()) {
+			Transform2D t = parent;
+			node->GetChildTransform(t);
+
+			for (unsigned i=0; i<node->children.size(); i++) {
+				GameNode *child = node->children[i];
+
+				if (child->kind & KIND_BASE_ACTION) {
+					continue;
+				}
+
+				CullSubtree(child, t, moved, view);
+
+				bounded = bounded && child->boundsKnown;
+				bounds.Extend(child->subtreeBounds);
+			}
+		}
+
+		node->subtreeBounds = bounds;
+		node->boundsKnown = bounded;
+		node->boundsDirty = false;
+		node->moved = false;
+
+		// The children were culled against this view above
+		node->culled = bounded && !bounds.Overlaps(view);
+		node->cullState = ClassifyBounds(node, view);
+	}
+
+	/*
+	=====================
+	GameNode::CullCached
+	=====================
+	*/
+	void GameNode::CullCached(GameNode *node, const AABB &view) {
+		if (node->kind & KIND_LAYER) {
+			node->culled = false;
+			return;
+		}
+
+		CullState state = ClassifyBounds(node, view);
+		if (state != CULL_PARTIAL && state == node->cullState) {
+			return;
+		}
+
+		node->culled = node->boundsKnown && !node->subtreeBounds.Overlaps(view);
+		node->cullState = state;
+
+		for (unsigned i=0; i<node->children.size(); i++) {
+			if (!(node->children[i]->kind & KIND_BASE_ACTION)) {
+				CullCached(node->children[i], view);
+			}
+		}
+	}
+
+	/*
+	=====================
+	GameNode::ClassifyBounds
+
+	Inside the view, a node is culled only if it's bounds are empty,
+	and outside of it every node is culled. Either way the flags do
+	not depend on where the view is.
+	=====================
+	*/
+	GameNode::CullState GameNode::ClassifyBounds(const GameNode *node, const AABB &view) {
+		const AABB &box = node->subtreeBounds;
+
+		if (!node->boundsKnown) {
+			return CULL_PARTIAL;
+		}
+
+		if (!box.Overlaps(view)) {
+			return CULL_OUTSIDE;
+		}
+
+		if (view.Contains(box.lower) && view.Contains(box.upper)) {
+			return CULL_INSIDE;
+		}
+
+		return CULL_PARTIAL;
+	}
+
+	/*
+	=====================
+	GameNode::RenderKeyLess
+	=====================
+	*/
+	bool GameNode::RenderKeyLess(const GameNode *a, const GameNode *b) {
+		if (a->zOrder != b->zOrder) {
+			return a->zOrder < b->zOrder;
+		}
+
+		return a->sequence < b->sequence;
+	}
+
+	/*
+	=====================
+	GameNode::SortByRenderKey
+	=====================
+	*/
+	void GameNode::SortByRenderKey(GameNode **first, GameNode **last) {
+		static vector<GameNode*> ordered;
+		static vector<GameNode*> displaced;
+
+		SortAdaptive(first, last, RenderKeyLess, ordered, displaced);
+	}
+
+	/*
+	=====================
+	GameNode::InvalidateDrawList
+
+	Marks the draw list of the nearest Layer at or above this node.
+	Nested Layers are a single entry in the draw list of their
+	parent layer, so the walk stops at the first one.
+	=====================
+	*/
+	void GameNode::InvalidateDrawList(bool rebuild) {
+		Layer *layer = GetParentLayer();
+
+		if (!layer) {
+			return;
+		}
+
+		if (rebuild) {
+			layer->drawListDirty = true;
+		} else {
+			layer->drawOrderDirty = true;
+		}
 	}
 
 	/*
@@ -458,6 +1367,11 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::RunAction(Action *a) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->RunAction(this, a);
+			return;
+		}
+
 		AddChild(a);
 		a->Activate();
 	}
@@ -468,6 +1382,11 @@ namespace Pim {
 	=====================
 	*/
 	void GameNode::RunActionQueue(ActionQueue *aq) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->RunAction(this, aq);
+			return;
+		}
+
 		AddChild(aq);
 		aq->Activate();
 	}
@@ -479,9 +1398,7 @@ namespace Pim {
 	*/
 	void GameNode::RemoveAllActions() {
 		for (int i=0; i<children.size(); i++) {
-			BaseAction *act = NULL;
-
-			act = dynamic_cast<BaseAction*>(children[i]);
+			BaseAction *act = children[i]->As<BaseAction>();
 			if (act) {
 				RemoveChild(act);
 				i--;
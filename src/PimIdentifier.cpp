@@ -0,0 +1,160 @@
+#include "PimInternal.h"
+
+#include "PimIdentifier.h"
+#include "PimAssert.h"
+#include "PimCommandBuffer.h"
+
+namespace Pim {
+	map<string,unsigned int> Identifier::table;
+	vector<const string*> Identifier::strings;
+
+	/*
+	=====================
+	Identifier::Intern
+	=====================
+	*/
+	unsigned int Identifier::Intern(const string &str) {
+		PimAssert(!CommandBuffer::GetRecording(),
+				  "Error: Identifier interned during a parallel update");
+
+		if (str.empty()) {
+			return 0;
+		}
+
+		map<string,unsigned int>::iterator it = table.find(str);
+		if (it != table.end()) {
+			return it->second;
+		}
+
+		if (strings.empty()) {
+			// Reserve ID 0 for the empty string
+			it = table.insert(make_pair(string(), 0U)).first;
+			strings.push_back(&it->first);
+		}
+
+		unsigned int id = strings.size();
+		it = table.insert(make_pair(str, id)).first;
+		strings.push_back(&it->first);
+
+		return id;
+	}
+
+	/*
+	=====================
+	Identifier::Lookup
+	=====================
+	*/
+	const string& Identifier::Lookup(unsigned int id) {
+		static const string empty;
+
+		if (id == 0) {
+			return empty;
+		}
+
+		PimAssert(id < strings.size(), "Error: Invalid identifier ID");
+		return *strings[id];
+	}
+
+	/*
+	=====================
+	Identifier::Find
+	=====================
+	*/
+	Identifier Identifier::Find(const string &str) {
+		Identifier ident;
+
+		map<string,unsigned int>::const_iterator it = table.find(str);
+		if (it != table.end()) {
+			ident.id = it->second;
+		}
+
+		return ident;
+	}
+
+	/*
+	=====================
+	Identifier::Identifier
+	=====================
+	*/
+	Identifier::Identifier() {
+		id = 0;
+	}
+
+	/*
+	=====================
+	Identifier::Identifier
+	=====================
+	*/
+	Identifier::Identifier(const char *str) {
+		id = (str) ? Intern(str) : 0;
+	}
+
+	/*
+	=====================
+	Identifier::Identifier
+	=====================
+	*/
+	Identifier::Identifier(const string &str) {
+		id = Intern(str);
+	}
+
+	/*
+	=====================
+	Identifier::operator=
+	=====================
+	*/
+	Identifier& Identifier::operator=(const char *str) {
+		id = (str) ? Intern(str) : 0;
+		return *this;
+	}
+
+	/*
+	=====================
+	Identifier::operator=
+	=====================
+	*/
+	Identifier& Identifier::operator=(const string &str) {
+		id = Intern(str);
+		return *this;
+	}
+
+	/*
+	=====================
+	Identifier::operator==
+	=====================
+	*/
+	bool Identifier::operator==(const char *str) const {
+		if (!str) {
+			return id == 0;
+		}
+
+		return Lookup(id) == str;
+	}
+
+	/*
+	=====================
+	Identifier::operator==
+	=====================
+	*/
+	bool Identifier::operator==(const string &str) const {
+		return Lookup(id) == str;
+	}
+
+	/*
+	=====================
+	Identifier::operator const string&
+	=====================
+	*/
+	Identifier::operator const string&() const {
+		return Lookup(id);
+	}
+
+	/*
+	=====================
+	Identifier::GetString
+	=====================
+	*/
+	const string& Identifier::GetString() const {
+		return Lookup(id);
+	}
+}
@@ -4,10 +4,17 @@
 #include "PimGameNode.h"
 #include "PimAssert.h"
 #include "PimGameControl.h"
+#include "PimSpatialIndex.h"
+#include "PimTrace.h"
 
 #include "PimInput.h"
 
 #include <iostream>
+#include <algorithm>
+#include <ctime>
+
+// The number of cells along the longest axis of the mouse hit index
+#define PIM_MOUSE_HIT_CELLS		16
 
 namespace Pim {
 	// --- KeyEvent ---
@@ -18,6 +25,7 @@ namespace Pim {
 	*/
 	KeyEvent::KeyEvent() {
 		activePrevFrame = false;
+		actionsActive = false;
 		Reset();
 	}
 
@@ -27,6 +35,8 @@ namespace Pim {
 	=====================
 	*/
 	KeyEvent::KeyEvent(const KeyEvent&) {
+		activePrevFrame = false;
+		actionsActive = false;
 		Reset();
 	}
 
@@ -41,6 +51,11 @@ namespace Pim {
 			keyField[i]		= 0;
 			freshField[i]   = 0;
 		}
+
+		for (unsigned i=0; i<actionDown.size(); i++) {
+			actionDown[i]	= 0;
+			actionFresh[i]	= 0;
+		}
 	}
 
 	/*
@@ -87,7 +102,7 @@ namespace Pim {
 	=====================
 	*/
 	bool KeyEvent::IsKeyDown(const string str) const {
-		return IsKeyDown(binds.find(str)->second);
+		return IsKeyDown(FindBinding(str));
 	}
 
 	/*
@@ -96,7 +111,33 @@ namespace Pim {
 	=====================
 	*/
 	bool KeyEvent::IsKeyFresh(const string str) const {
-		return IsKeyFresh(binds.find(str)->second);
+		return IsKeyFresh(FindBinding(str));
+	}
+
+	/*
+	=====================
+	KeyEvent::IsKeyDown
+	=====================
+	*/
+	bool KeyEvent::IsKeyDown(const KeyBinding b) const {
+		if (b < 0 || b >= (int)actions.size()) {
+			return false;
+		}
+
+		return (actionDown[b / 32] & (1u << (b % 32))) != 0;
+	}
+
+	/*
+	=====================
+	KeyEvent::IsKeyFresh
+	=====================
+	*/
+	bool KeyEvent::IsKeyFresh(const KeyBinding b) const {
+		if (b < 0 || b >= (int)actions.size()) {
+			return false;
+		}
+
+		return (actionFresh[b / 32] & (1u << (b % 32))) != 0;
 	}
 
 	/*
@@ -108,13 +149,72 @@ namespace Pim {
 		return count;
 	}
 
+	/*
+	=====================
+	KeyEvent::BindKey
+	=====================
+	*/
+	KeyBinding KeyEvent::GetBinding(const string &str) {
+		map<string,KeyBinding>::iterator it = binds.find(str);
+		if (it != binds.end()) {
+			return it->second;
+		}
+
+		KeyBinding b = (KeyBinding)actions.size();
+		binds[str] = b;
+
+		Action action;
+		action.buttons = 0;
+		actions.push_back(action);
+
+		actionDown.resize((actions.size() + 31) / 32, 0);
+		actionFresh.resize(actionDown.size(), 0);
+
+		return b;
+	}
+
+	/*
+	=====================
+	KeyEvent::FindBinding
+
+	Returns -1 if there is no binding named 'str'.
+	=====================
+	*/
+	KeyBinding KeyEvent::FindBinding(const string &str) const {
+		map<string,KeyBinding>::const_iterator it = binds.find(str);
+		return (it != binds.end()) ? it->second : -1;
+	}
+
 	/*
 	=====================
 	KeyEvent::BindKey
 	=====================
 	*/
 	void KeyEvent::BindKey(const string &str, const KeyCode k) {
-		binds[str] = k;
+		UnbindKey(str);
+		AddKey(str, k);
+	}
+
+	/*
+	=====================
+	KeyEvent::AddKey
+	=====================
+	*/
+	void KeyEvent::AddKey(const string &str, const KeyCode k) {
+		Action &action = actions[GetBinding(str)];
+
+		if (std::find(action.keys.begin(), action.keys.end(), k) == action.keys.end()) {
+			action.keys.push_back(k);
+		}
+	}
+
+	/*
+	=====================
+	KeyEvent::AddButtons
+	=====================
+	*/
+	void KeyEvent::AddButtons(const string &str, int buttons) {
+		actions[GetBinding(str)].buttons |= buttons;
 	}
 
 	/*
@@ -123,7 +223,56 @@ namespace Pim {
 	=====================
 	*/
 	void KeyEvent::UnbindKey(const string &str) {
-		binds.erase(str);
+		KeyBinding b = FindBinding(str);
+
+		if (b >= 0) {
+			actions[b].keys.clear();
+			actions[b].buttons = 0;
+		}
+	}
+
+	/*
+	=====================
+	KeyEvent::UpdateActions
+
+	Evaluates every binding into the action bitsets. Called once per
+	frame, before the key listeners are called.
+	=====================
+	*/
+	void KeyEvent::UpdateActions(int buttons, int prevButtons) {
+		bool active = false;
+
+		for (unsigned i=0; i<actionDown.size(); i++) {
+			active |= actionDown[i] != 0;
+			actionDown[i]	= 0;
+			actionFresh[i]	= 0;
+		}
+
+		for (unsigned i=0; i<actions.size(); i++) {
+			const Action &action = actions[i];
+			unsigned bit = 1u << (i % 32);
+			bool down = (buttons & action.buttons) != 0;
+			bool fresh = (buttons & ~prevButtons & action.buttons) != 0;
+
+			for (unsigned j=0; j<action.keys.size() && !fresh; j++) {
+				if (IsKeyDown(action.keys[j])) {
+					down = true;
+					fresh = IsKeyFresh(action.keys[j]);
+				}
+			}
+
+			if (down) {
+				actionDown[i / 32] |= bit;
+				active = true;
+			}
+
+			if (fresh) {
+				actionFresh[i / 32] |= bit;
+			}
+		}
+
+		// Key listeners are called while an action is down, and once after
+		actionsActive = active;
 	}
 
 
@@ -155,6 +304,9 @@ namespace Pim {
 		position		= Vec2(0.f,0.f);
 		lastPosition	= Vec2(0.f,0.f);
 		dirty			= false;
+		hitTested		= false;
+		over			= false;
+		consumed		= false;
 		
 		for (int i=0; i<7; i++) {
 			keys[i]		= false;
@@ -236,6 +388,42 @@ namespace Pim {
 				* Vec2(1.f, -1.f);
 	}
 
+	/*
+	=====================
+	MouseEvent::IsHitTested
+	=====================
+	*/
+	bool MouseEvent::IsHitTested() const {
+		return hitTested;
+	}
+
+	/*
+	=====================
+	MouseEvent::IsOver
+	=====================
+	*/
+	bool MouseEvent::IsOver() const {
+		return over;
+	}
+
+	/*
+	=====================
+	MouseEvent::Consume
+	=====================
+	*/
+	void MouseEvent::Consume() {
+		consumed = true;
+	}
+
+	/*
+	=====================
+	MouseEvent::IsConsumed
+	=====================
+	*/
+	bool MouseEvent::IsConsumed() const {
+		return consumed;
+	}
+
 
 	// --- ControllerEvent ---
 	/*
@@ -383,8 +571,24 @@ namespace Pim {
 	Input::Input
 	=====================
 	*/
-	Input::Input() {
+	Input::Input() : kl(ListenerList::KEYS), ml(ListenerList::MOUSE), 
+					 cl(ListenerList::CONTROLLER) {
 		PimAssert(singleton == NULL, "Input singleton is already initialized");
+
+		hitIndex		= NULL;
+		mouseCapture	= NULL;
+		exitAfterReplay	= false;
+	}
+
+	/*
+	=====================
+	Input::~Input
+	=====================
+	*/
+	Input::~Input() {
+		if (hitIndex) {
+			delete hitIndex;
+		}
 	}
 
 	/*
@@ -408,6 +612,15 @@ namespace Pim {
 		}
 	}
 
+	/*
+	=====================
+	Input::GetBinding
+	=====================
+	*/
+	KeyBinding Input::GetBinding(string id) {
+		return keyEvent.GetBinding(id);
+	}
+
 	/*
 	=====================
 	Input::BindKey
@@ -418,10 +631,29 @@ namespace Pim {
 		keyEvent.BindKey(id, key);
 
 		#ifdef _DEBUG
-		cout<<"Bound key - " <<id <<": " <<keyEvent.binds[id] <<"\n";
+		cout<<"Bound key - " <<id <<": " <<key <<"\n";
 		#endif /* _DEBUG */
 	}
 
+	/*
+	=====================
+	Input::AddKeyBinding
+	=====================
+	*/
+	void Input::AddKeyBinding(string id, KeyEvent::KeyCode key) {
+		PimAssert(key >= 0 && key < 256, "Key out of range.");
+		keyEvent.AddKey(id, key);
+	}
+
+	/*
+	=====================
+	Input::AddControllerBinding
+	=====================
+	*/
+	void Input::AddControllerBinding(string id, ControllerEvent::Xbox button) {
+		keyEvent.AddButtons(id, button);
+	}
+
 	/*
 	=====================
 	Input::UnbindKey
@@ -437,7 +669,7 @@ namespace Pim {
 	=====================
 	*/
 	void Input::AddKeyListener(GameNode *node) {
-		kl.push_back(node);
+		kl.Add(node);
 	}
 
 	/*
@@ -446,11 +678,7 @@ namespace Pim {
 	=====================
 	*/
 	void Input::RemoveKeyListener(GameNode *node) {
-		for (unsigned int i=0; i<kl.size(); i++) {
-			if (kl[i] == node) {
-				kl.erase(kl.begin() + i);
-			}
-		}
+		kl.Remove(node);
 	}
 
 	/*
@@ -459,7 +687,19 @@ namespace Pim {
 	=====================
 	*/
 	void Input::AddMouseListener(GameNode *node) {
-		ml.push_back(node);
+		ml.Add(node);
+
+		if (node->mouseHitTest) {
+			if (!hitIndex) {
+				Vec2 size = GameControl::GetSingleton()->GetCreationData().coordinateSystem;
+				float cell = std::max(size.x, size.y) / PIM_MOUSE_HIT_CELLS;
+
+				hitIndex = new SpatialIndex(AABB(Vec2(0.f, 0.f), size), cell,
+											SpatialIndex::SCREEN_SPACE);
+			}
+
+			hitIndex->Insert(node);
+		}
 	}
 
 	/*
@@ -468,10 +708,18 @@ namespace Pim {
 	=====================
 	*/
 	void Input::RemoveMouseListener(GameNode *node) {
-		for (unsigned int i=0; i<ml.size(); i++) {
-			if (ml[i] == node) {
-				ml.erase(ml.begin() + i);
-			}
+		ml.Remove(node);
+
+		if (hitIndex) {
+			hitIndex->Remove(node);
+		}
+
+		// The hit lists may be iterated, leave a NULL-slot behind
+		std::replace(mouseHits.begin(), mouseHits.end(), node, (GameNode*)NULL);
+		std::replace(mouseOver.begin(), mouseOver.end(), node, (GameNode*)NULL);
+
+		if (mouseCapture == node) {
+			mouseCapture = NULL;
 		}
 	}
 
@@ -481,7 +729,7 @@ namespace Pim {
 	=====================
 	*/
 	void Input::AddControlListener(GameNode *node) {
-		cl.push_back(node);
+		cl.Add(node);
 	}
 
 	/*
@@ -490,11 +738,7 @@ namespace Pim {
 	=====================
 	*/
 	void Input::RemoveControlListener(GameNode *node) {
-		for (unsigned int i=0; i<cl.size(); i++) {
-			if (cl[i] == node) {
-				cl.erase(cl.begin() + i);
-			}
-		}
+		cl.Remove(node);
 	}
 
 	/*
@@ -506,12 +750,113 @@ namespace Pim {
 		contEvent.Vibrate(leftVib, rightVib);
 	}
 
+	/*
+	=====================
+	Input::CaptureMouse
+	=====================
+	*/
+	void Input::CaptureMouse(GameNode *node) {
+		mouseCapture = node;
+	}
+
+	/*
+	=====================
+	Input::GetMouseCapture
+	=====================
+	*/
+	GameNode* Input::GetMouseCapture() const {
+		return mouseCapture;
+	}
+
+	/*
+	=====================
+	Input::StartRecording
+	=====================
+	*/
+	bool Input::StartRecording(const string &file) {
+		unsigned int seed = (unsigned int)time(NULL);
+
+		if (!recorder.StartRecording(file, seed)) {
+			return false;
+		}
+
+		srand(seed);
+		RecordState();
+		return true;
+	}
+
+	/*
+	=====================
+	Input::StopRecording
+	=====================
+	*/
+	void Input::StopRecording() {
+		if (recorder.IsRecording()) {
+			recorder.Stop();
+		}
+	}
+
+	/*
+	=====================
+	Input::IsRecording
+	=====================
+	*/
+	bool Input::IsRecording() const {
+		return recorder.IsRecording();
+	}
+
+	/*
+	=====================
+	Input::StartReplay
+	=====================
+	*/
+	bool Input::StartReplay(const string &file, bool exitWhenDone) {
+		unsigned int seed;
+
+		if (!recorder.StartReplay(file, seed)) {
+			return false;
+		}
+
+		// The recording restores the state it was started in
+		keyEvent.Reset();
+		keyEvent.activePrevFrame = true;
+		mouseEvent.Reset();
+		mouseEvent.dirty = true;
+		contEvent.Reset();
+
+		srand(seed);
+		exitAfterReplay = exitWhenDone;
+		return true;
+	}
+
+	/*
+	=====================
+	Input::StopReplay
+	=====================
+	*/
+	void Input::StopReplay() {
+		if (recorder.IsReplaying()) {
+			recorder.Stop();
+		}
+	}
+
+	/*
+	=====================
+	Input::IsReplaying
+	=====================
+	*/
+	bool Input::IsReplaying() const {
+		return recorder.IsReplaying();
+	}
+
 	/*
 	=====================
 	Input::KeyPressed
 	=====================
 	*/
 	void Input::KeyPressed(int key) {
+		recorder.Record(InputRecorder::KEY_PRESSED, key);
+
 		// Key is a number between 0 and 512. 
 		// The key-th bit in the bit fields should be flagged to 1.
 		char idx = key / 32;
@@ -529,6 +874,8 @@ namespace Pim {
 	=====================
 	*/
 	void Input::KeyReleased(int key) {
+		recorder.Record(InputRecorder::KEY_RELEASED, key);
+
 		// Key is a number between 0 and 512.
 		// the key-th bit in keyField should be flagged to 0.
 		char idx = key / 32;
@@ -546,6 +893,8 @@ namespace Pim {
 	=====================
 	*/
 	void Input::MouseMoved(int x, int y) {
+		recorder.Record(InputRecorder::MOUSE_MOVED, x, y);
+
 		mouseEvent.MouseMoved(Vec2((float)x, (float)y));
 		mouseEvent.dirty = true;
 	}
@@ -556,6 +905,8 @@ namespace Pim {
 	=====================
 	*/
 	void Input::MousePressed(int id) {
+		recorder.Record(InputRecorder::MOUSE_PRESSED, id);
+
 		mouseEvent.keys[id] = true;
 		mouseEvent.fresh[id] = true;
 		mouseEvent.dirty = true;
@@ -567,6 +918,8 @@ namespace Pim {
 	=====================
 	*/
 	void Input::MouseReleased(int id) {
+		recorder.Record(InputRecorder::MOUSE_RELEASED, id);
+
 		mouseEvent.keys[id] = false;
 		mouseEvent.dirty = true;
 	}
@@ -578,6 +931,8 @@ namespace Pim {
 	=====================
 	*/
 	void Input::ControllerButtonPressed(int button) {
+		recorder.Record(InputRecorder::CONTROLLER_PRESSED, button);
+
 		contEvent.buttons |= 1 << button;
 		contEvent.dirty = true;
 	}
@@ -588,6 +943,8 @@ namespace Pim {
 	=====================
 	*/
 	void Input::ControllerButtonReleased(int button) {
+		recorder.Record(InputRecorder::CONTROLLER_RELEASED, button);
+
 		contEvent.buttons &= ~(1 << button);
 		contEvent.dirty = true;
 	}
@@ -598,6 +955,8 @@ namespace Pim {
 	=====================
 	*/
 	void Input::ControllerAxisMoved(int axis, int value) {
+		recorder.Record(InputRecorder::CONTROLLER_AXIS, axis, value);
+
 		contEvent.axes[axis] = value / ControllerEvent::XAXIS_AXIS_MAX;
 
 		if (contEvent.axes[axis] > ControllerEvent::XAXIS_AXIS_MIN) {
@@ -611,10 +970,21 @@ namespace Pim {
 	=====================
 	*/
 	void Input::Dispatch() {
+		PIM_TRACE_ZONE("Input::Dispatch");
+
+		// Listeners removed during the previous dispatch leave NULL-slots
+		kl.Compact();
+		ml.Compact();
+		cl.Compact();
+
 		// dispatch keys..
-		if (keyEvent.count || keyEvent.activePrevFrame) {
-			for (unsigned int i=0; i<kl.size(); i++) {
-				kl[i]->OnKeyEvent(keyEvent);
+		keyEvent.UpdateActions(contEvent.buttons, contEvent.prevButtons);
+
+		if (keyEvent.count || keyEvent.activePrevFrame || keyEvent.actionsActive) {
+			for (unsigned int i=0; i<kl.Size(); i++) {
+				if (kl[i]) {
+					kl[i]->OnKeyEvent(keyEvent);
+				}
 			}
 
 			keyEvent.activePrevFrame = false;
@@ -623,16 +993,26 @@ namespace Pim {
 
 		// dispatch mouse..
 		if (mouseEvent.dirty) {
-			for (unsigned int i=0; i<ml.size(); i++) {
-				ml[i]->OnMouseEvent(mouseEvent);
+			mouseEvent.hitTested = false;
+
+			for (unsigned int i=0; i<ml.Size(); i++) {
+				if (ml[i] && !ml[i]->mouseHitTest) {
+					ml[i]->OnMouseEvent(mouseEvent);
+				}
+			}
+
+			if (hitIndex) {
+				DispatchMouseHits();
 			}
 		}
 		mouseEvent.Unfresh();
 
 		// dispatch control...
-		if (cl.size() && contEvent.IsConnected()) {
-			for (unsigned int i=0; i<cl.size(); i++) {
-				cl[i]->OnControllerEvent(contEvent);
+		if (cl.Count() && contEvent.IsConnected()) {
+			for (unsigned int i=0; i<cl.Size(); i++) {
+				if (cl[i]) {
+					cl[i]->OnControllerEvent(contEvent);
+				}
 			}
 		}
 		contEvent.Unfresh();
@@ -645,6 +1025,8 @@ namespace Pim {
 	*/
 	void Input::DispatchPaused(GameNode *n) {
 		bool controller = contEvent.IsConnected();
+		mouseEvent.hitTested = false;
+		keyEvent.UpdateActions(contEvent.buttons, contEvent.prevButtons);
 
 		// Dispatch to the pause-layer regardless of what has occured
 		Dispatch_r(n, controller);
@@ -672,4 +1054,219 @@ namespace Pim {
 			Dispatch_r(n->children[i], controller);
 		}
 	}
+
+	/*
+	=====================
+	Input::DrawnAbove
+
+	True if 'a' is drawn after 'b'. Children are drawn after their
+	parents, siblings in order of (zOrder, sequence) and the layers of
+	the scene in descending z-order. Flattened layers are not taken
+	into account.
+	=====================
+	*/
+	bool Input::DrawnAbove(GameNode *a, GameNode *b) {
+		int da = 0;
+		int db = 0;
+
+		for (GameNode *n=a->GetParent(); n; n=n->GetParent()) da++;
+		for (GameNode *n=b->GetParent(); n; n=n->GetParent()) db++;
+
+		GameNode *x = a;
+		GameNode *y = b;
+
+		for (int i=da; i>db; i--) x = x->GetParent();
+		for (int i=db; i>da; i--) y = y->GetParent();
+
+		if (x == y) {
+			return da > db;
+		}
+
+		while (x->GetParent() != y->GetParent()) {
+			x = x->GetParent();
+			y = y->GetParent();
+		}
+
+		if (!x->GetParent()) {
+			return x->GetZOrder() < y->GetZOrder();
+		}
+
+		if (x->GetZOrder() != y->GetZOrder()) {
+			return x->GetZOrder() > y->GetZOrder();
+		}
+
+		return x->sequence > y->sequence;
+	}
+
+	/*
+	=====================
+	Input::UpdateHitBounds
+	=====================
+	*/
+	void Input::UpdateHitBounds(GameNode *node) {
+		if (hitIndex && node->mouseHitTest) {
+			hitIndex->Update(node);
+		}
+	}
+
+	/*
+	=====================
+	Input::RefreshHitBounds
+
+	Called by GameControl once per frame, before the input is
+	dispatched. The listeners may have moved since the last frame.
+	=====================
+	*/
+	void Input::RefreshHitBounds() {
+		if (hitIndex && mouseEvent.dirty) {
+			hitIndex->Refresh();
+		}
+	}
+
+	/*
+	=====================
+	Input::DispatchMouseHits
+
+	The listeners under the cursor are called top-most first. Then the
+	listeners the cursor has left, and finally the one capturing the
+	mouse. No listener is called twice.
+	=====================
+	*/
+	void Input::DispatchMouseHits() {
+		Vec2 pos = mouseEvent.GetPosition();
+		hitIndex->QueryRect(AABB(pos, pos), mouseHits);
+		std::sort(mouseHits.begin(), mouseHits.end(), DrawnAbove);
+
+		mouseEvent.hitTested = true;
+		mouseEvent.consumed = false;
+
+		// The cursor is over the listeners called before the event was consumed
+		unsigned int overCount = 0;
+
+		for (unsigned int i=0; i<mouseHits.size(); i++) {
+			if (!mouseEvent.consumed) {
+				overCount = i + 1;
+			}
+
+			if (mouseHits[i]) {
+				DeliverMouse(mouseHits[i], i < overCount);
+			}
+		}
+
+		for (unsigned int i=0; i<mouseOver.size(); i++) {
+			GameNode *n = mouseOver[i];
+
+			if (n && std::find(mouseHits.begin(), mouseHits.end(), n) == mouseHits.end()) {
+				DeliverMouse(n, false);
+			}
+		}
+
+		GameNode *cap = mouseCapture;
+
+		if (cap &&
+			std::find(mouseHits.begin(), mouseHits.end(), cap) == mouseHits.end() &&
+			std::find(mouseOver.begin(), mouseOver.end(), cap) == mouseOver.end()) {
+			DeliverMouse(cap, false);
+		}
+
+		mouseOver.assign(mouseHits.begin(), mouseHits.begin() + overCount);
+		mouseOver.erase(std::remove(mouseOver.begin(), mouseOver.end(), (GameNode*)NULL),
+						mouseOver.end());
+
+		mouseEvent.hitTested = false;
+	}
+
+	/*
+	=====================
+	Input::DeliverMouse
+	=====================
+	*/
+	void Input::DeliverMouse(GameNode *n, bool over) {
+		mouseEvent.over = over;
+		n->OnMouseEvent(mouseEvent);
+	}
+
+	/*
+	=====================
+	Input::RecordState
+
+	Records events recreating the current state of the input.
+	=====================
+	*/
+	void Input::RecordState() {
+		for (int k=0; k<512; k++) {
+			if (keyEvent.keyField[k / 32] & (1u << (k % 32))) {
+				recorder.Record(InputRecorder::KEY_PRESSED, k);
+			}
+		}
+
+		recorder.Record(InputRecorder::MOUSE_MOVED,
+						(int)mouseEvent.position.x, (int)mouseEvent.position.y);
+
+		for (int i=0; i<7; i++) {
+			if (mouseEvent.keys[i]) {
+				recorder.Record(InputRecorder::MOUSE_PRESSED, i);
+			}
+		}
+
+		for (int i=0; i<16; i++) {
+			if (contEvent.buttons & (1 << i)) {
+				recorder.Record(InputRecorder::CONTROLLER_PRESSED, i);
+			}
+		}
+
+		for (int i=0; i<6; i++) {
+			if (contEvent.axes[i] != 0.f) {
+				recorder.Record(InputRecorder::CONTROLLER_AXIS, i,
+								int(contEvent.axes[i] * ControllerEvent::XAXIS_AXIS_MAX));
+			}
+		}
+	}
+
+	/*
+	=====================
+	Input::RecordFrame
+	=====================
+	*/
+	void Input::RecordFrame(float dt) {
+		recorder.EndFrame(dt);
+	}
+
+	/*
+	=====================
+	Input::ReplayFrame
+
+	Feeds the recorded events of the next frame to Input, in place of
+	the events from SDL.
+	=====================
+	*/
+	bool Input::ReplayFrame(float &dt) {
+		if (!recorder.IsReplaying()) {
+			return false;
+		}
+
+		if (!recorder.ReadFrame(dt, replayEvents)) {
+			if (exitAfterReplay) {
+				GameControl::GetSingleton()->Exit();
+			}
+			return false;
+		}
+
+		for (unsigned i=0; i<replayEvents.size(); i++) {
+			const InputRecorder::Event &evt = replayEvents[i];
+
+			switch (evt.type) {
+				case InputRecorder::KEY_PRESSED:			KeyPressed(evt.a);					break;
+				case InputRecorder::KEY_RELEASED:			KeyReleased(evt.a);					break;
+				case InputRecorder::MOUSE_MOVED:			MouseMoved(evt.a, evt.b);			break;
+				case InputRecorder::MOUSE_PRESSED:			MousePressed(evt.a);				break;
+				case InputRecorder::MOUSE_RELEASED:			MouseReleased(evt.a);				break;
+				case InputRecorder::CONTROLLER_PRESSED:		ControllerButtonPressed(evt.a);		break;
+				case InputRecorder::CONTROLLER_RELEASED:	ControllerButtonReleased(evt.a);	break;
+				case InputRecorder::CONTROLLER_AXIS:		ControllerAxisMoved(evt.a, evt.b);	break;
+			}
+		}
+
+		return true;
+	}
 }
\ No newline at end of file
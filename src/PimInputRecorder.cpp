@@ -0,0 +1,296 @@
+#include "PimInternal.h"
+
+#include "PimInputRecorder.h"
+#include "PimAssert.h"
+
+#include <string.h>
+
+// Increase when the file format changes
+#define PIM_INPUT_RECORDING_VERSION		1
+
+namespace Pim {
+	static const char recordingMagic[4] = { 'P', 'I', 'M', 'I' };
+
+	// The number of keys, buttons and axes tracked by Input
+	static const unsigned int numKeys				= 512;
+	static const unsigned int numMouseButtons		= 7;
+	static const unsigned int numControllerButtons	= 16;
+	static const unsigned int numControllerAxes		= 6;
+
+	/*
+	=====================
+	InputRecorder::InputRecorder
+	=====================
+	*/
+	InputRecorder::InputRecorder() {
+		file	= NULL;
+		mode	= IDLE;
+		frame	= 0;
+	}
+
+	/*
+	=====================
+	InputRecorder::~InputRecorder
+	=====================
+	*/
+	InputRecorder::~InputRecorder() {
+		Stop();
+	}
+
+	/*
+	=====================
+	InputRecorder::StartRecording
+	=====================
+	*/
+	bool InputRecorder::StartRecording(const string &path, unsigned int seed) {
+		Stop();
+
+		if (!(file = fopen(path.c_str(), "wb"))) {
+			PimWarning("Unable to create the input recording", path.c_str());
+			return false;
+		}
+
+		fwrite(recordingMagic, 1, 4, file);
+		WriteInt(PIM_INPUT_RECORDING_VERSION, 4);
+		WriteInt(seed, 4);
+
+		mode	= RECORDING;
+		frame	= 0;
+		pending.clear();
+		return true;
+	}
+
+	/*
+	=====================
+	InputRecorder::StartReplay
+	=====================
+	*/
+	bool InputRecorder::StartReplay(const string &path, unsigned int &seed) {
+		Stop();
+
+		if (!(file = fopen(path.c_str(), "rb"))) {
+			PimWarning("Unable to open the input recording", path.c_str());
+			return false;
+		}
+
+		char magic[4];
+		unsigned int version;
+
+		if (fread(magic, 1, 4, file) != 4 || memcmp(magic, recordingMagic, 4) ||
+			!ReadInt(version, 4) || version != PIM_INPUT_RECORDING_VERSION ||
+			!ReadInt(seed, 4)) {
+			PimWarning("The file is not a valid input recording", path.c_str());
+			fclose(file);
+			file = NULL;
+			return false;
+		}
+
+		mode	= REPLAYING;
+		frame	= 0;
+		return true;
+	}
+
+	/*
+	=====================
+	InputRecorder::Stop
+	=====================
+	*/
+	void InputRecorder::Stop() {
+		if (file) {
+			fclose(file);
+			file = NULL;
+		}
+
+		mode = IDLE;
+		pending.clear();
+	}
+
+	/*
+	=====================
+	InputRecorder::IsRecording
+	=====================
+	*/
+	bool InputRecorder::IsRecording() const {
+		return mode == RECORDING;
+	}
+
+	/*
+	=====================
+	InputRecorder::IsReplaying
+	=====================
+	*/
+	bool InputRecorder::IsReplaying() const {
+		return mode == REPLAYING;
+	}
+
+	/*
+	=====================
+	InputRecorder::GetFrame
+	=====================
+	*/
+	unsigned int InputRecorder::GetFrame() const {
+		return frame;
+	}
+
+	/*
+	=====================
+	InputRecorder::Record
+	=====================
+	*/
+	void InputRecorder::Record(EventType type, int a, int b) {
+		if (mode != RECORDING) {
+			return;
+		}
+
+		Event evt = { type, a, b };
+		pending.push_back(evt);
+	}
+
+	/*
+	=====================
+	InputRecorder::EndFrame
+	=====================
+	*/
+	void InputRecorder::EndFrame(float dt) {
+		if (mode != RECORDING) {
+			return;
+		}
+
+		PimAssert(pending.size() <= 0xFFFF, "Error: Too many input events in one frame");
+
+		unsigned int bits;
+		memcpy(&bits, &dt, 4);
+
+		WriteInt(bits, 4);
+		WriteInt((unsigned)pending.size(), 2);
+
+		for (unsigned i=0; i<pending.size(); i++) {
+			WriteInt(pending[i].type, 1);
+			WriteInt(pending[i].a, 4);
+
+			if (HasTwoArgs(pending[i].type)) {
+				WriteInt(pending[i].b, 4);
+			}
+		}
+
+		pending.clear();
+		frame++;
+	}
+
+	/*
+	=====================
+	InputRecorder::ReadFrame
+	=====================
+	*/
+	bool InputRecorder::ReadFrame(float &dt, vector<Event> &events) {
+		events.clear();
+
+		if (mode != REPLAYING) {
+			return false;
+		}
+
+		unsigned int bits, count;
+
+		if (!ReadInt(bits, 4) || !ReadInt(count, 2)) {
+			Stop();
+			return false;
+		}
+
+		memcpy(&dt, &bits, 4);
+
+		for (unsigned i=0; i<count; i++) {
+			unsigned int type, a, b = 0;
+
+			if (!ReadInt(type, 1) || !ReadInt(a, 4) ||
+				(HasTwoArgs((EventType)type) && !ReadInt(b, 4))) {
+				Stop();
+				return false;
+			}
+
+			Event evt = { (EventType)type, (int)a, (int)b };
+
+			if (!IsValid(evt)) {
+				char desc[96];
+				sprintf(desc, "Invalid event in frame %u, the replay is stopped", frame);
+				PimWarning(desc, "Invalid input recording");
+				events.clear();
+				Stop();
+				return false;
+			}
+
+			events.push_back(evt);
+		}
+
+		frame++;
+		return true;
+	}
+
+	/*
+	=====================
+	InputRecorder::WriteInt
+	=====================
+	*/
+	void InputRecorder::WriteInt(unsigned int value, int bytes) {
+		unsigned char buf[4];
+
+		for (int i=0; i<bytes; i++) {
+			buf[i] = (unsigned char)(value >> (i * 8));
+		}
+
+		fwrite(buf, 1, bytes, file);
+	}
+
+	/*
+	=====================
+	InputRecorder::ReadInt
+	=====================
+	*/
+	bool InputRecorder::ReadInt(unsigned int &value, int bytes) {
+		unsigned char buf[4];
+
+		if (fread(buf, 1, bytes, file) != (size_t)bytes) {
+			return false;
+		}
+
+		value = 0;
+		for (int i=0; i<bytes; i++) {
+			value |= (unsigned int)buf[i] << (i * 8);
+		}
+
+		return true;
+	}
+
+	/*
+	=====================
+	InputRecorder::HasTwoArgs
+	=====================
+	*/
+	bool InputRecorder::HasTwoArgs(EventType type) {
+		return type == MOUSE_MOVED || type == CONTROLLER_AXIS;
+	}
+
+	/*
+	=====================
+	InputRecorder::IsValid
+
+	Input indexes it's arrays with the first argument of all events
+	but MOUSE_MOVED, which has the mouse position.
+	=====================
+	*/
+	bool InputRecorder::IsValid(const Event &evt) {
+		unsigned int idx = (unsigned int)evt.a;
+
+		switch (evt.type) {
+			case KEY_PRESSED:
+			case KEY_RELEASED:			return idx < numKeys;
+			case MOUSE_MOVED:			return true;
+			case MOUSE_PRESSED:
+			case MOUSE_RELEASED:		return idx < numMouseButtons;
+			case CONTROLLER_PRESSED:
+			case CONTROLLER_RELEASED:	return idx < numControllerButtons;
+			case CONTROLLER_AXIS:		return idx < numControllerAxes;
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "PimInternal.h"
+
+#include <stdio.h>
+
+namespace Pim {
+	/**
+	 @class 		InputRecorder
+	 @brief 		Writes and reads the input of a play session.
+	 @details 		Used by Input to record the key, mouse and controller events
+	 				of every frame along with the frame's time step, and to feed
+	 				them back in place of SDL. See Input::StartRecording().
+
+	 				The file starts with the magic "PIMI", the format version
+	 				and the random seed. Each frame follows as the time step
+	 				(float), the number of events (16 bit) and the events. An
+	 				event is a one byte type, followed by one 32 bit argument,
+	 				or two for MOUSE_MOVED and CONTROLLER_AXIS. All values are
+	 				little endian, so recordings can be shared across platforms.
+	 */
+
+	class InputRecorder {
+	public:
+		enum EventType {
+			KEY_PRESSED,
+			KEY_RELEASED,
+			MOUSE_MOVED,
+			MOUSE_PRESSED,
+			MOUSE_RELEASED,
+			CONTROLLER_PRESSED,
+			CONTROLLER_RELEASED,
+			CONTROLLER_AXIS,
+		};
+
+		struct Event {
+			EventType			type;
+			int					a;
+			int					b;
+		};
+
+								InputRecorder();
+								~InputRecorder();
+		bool					StartRecording(const string &path, unsigned int seed);
+		bool					StartReplay(const string &path, unsigned int &seed);
+		void					Stop();
+		bool					IsRecording() const;
+		bool					IsReplaying() const;
+		unsigned int			GetFrame() const;
+		void					Record(EventType type, int a, int b=0);
+		void					EndFrame(float dt);
+		bool					ReadFrame(float &dt, vector<Event> &events);
+
+	private:
+		enum Mode {
+			IDLE,
+			RECORDING,
+			REPLAYING,
+		};
+
+		FILE					*file;
+		Mode					mode;
+		unsigned int			frame;
+		vector<Event>			pending;	// The events of the frame being recorded
+
+								InputRecorder(const InputRecorder&);
+		InputRecorder&			operator=(const InputRecorder&);
+
+		void					WriteInt(unsigned int value, int bytes);
+		bool					ReadInt(unsigned int &value, int bytes);
+		static bool				HasTwoArgs(EventType type);
+		static bool				IsValid(const Event &evt);
+	};
+
+	/**
+	 @fn 			InputRecorder::StartRecording
+	 @brief 		Creates the file and writes the header. Returns false if the
+	 				file could not be created.
+	 */
+
+	/**
+	 @fn 			InputRecorder::StartReplay
+	 @brief 		Opens a recording and reads the header. Returns false if the
+	 				file could not be opened or is not a recording.
+	 */
+
+	/**
+	 @fn 			InputRecorder::Record
+	 @brief 		Adds an event to the frame being recorded. Does nothing
+	 				unless recording.
+	 */
+
+	/**
+	 @fn 			InputRecorder::EndFrame
+	 @brief 		Writes the events recorded since the last call, along with
+	 				the time step of the frame. Does nothing unless recording.
+	 */
+
+	/**
+	 @fn 			InputRecorder::ReadFrame
+	 @brief 		Reads the next frame of the replay. Returns false and stops
+	 				the replay at the end of the file, or if the frame holds an
+	 				event of an unknown type or with an index out of range.
+	 */
+}
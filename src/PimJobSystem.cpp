@@ -0,0 +1,322 @@
+#include "PimInternal.h"
+
+#include "PimJobSystem.h"
+#include "PimAssert.h"
+#include "PimTrace.h"
+
+namespace Pim {
+	// The queue of the current thread. Threads not owned by the
+	// JobSystem share the queue of the main thread.
+	static PIM_THREAD_LOCAL unsigned int threadQueue = 0;
+
+	/*
+	=====================
+	JobCounter::JobCounter
+	=====================
+	*/
+	JobCounter::JobCounter() {
+		count = 0;
+	}
+
+	/*
+	=====================
+	JobCounter::IsDone
+	=====================
+	*/
+	bool JobCounter::IsDone() const {
+		if (count > 0) {
+			return false;
+		}
+
+		// Wait for the last job to let go of the counter
+		lock_guard<mutex> guard(lock);
+		return true;
+	}
+
+	/*
+	=====================
+	JobSystem::JobSystem
+	=====================
+	*/
+	JobSystem::JobSystem(unsigned int numWorkers) {
+		if (!numWorkers) {
+			numWorkers = thread::hardware_concurrency();
+			numWorkers = (numWorkers > 1) ? numWorkers - 1 : 1;
+		}
+
+		pending		= 0;
+		quit		= false;
+		numQueues	= numWorkers + 1;
+		queues		= new Queue[numQueues];
+
+		for (unsigned i=1; i<numQueues; i++) {
+			workers.push_back(thread(&JobSystem::WorkerLoop, this, i));
+		}
+	}
+
+	/*
+	=====================
+	JobSystem::~JobSystem
+	=====================
+	*/
+	JobSystem::~JobSystem() {
+		quit = true;
+
+		{
+			lock_guard<mutex> guard(sleepLock);
+		}
+		wake.notify_all();
+
+		for (unsigned i=0; i<workers.size(); i++) {
+			workers[i].join();
+		}
+
+		delete[] queues;
+	}
+
+	/*
+	=====================
+	JobSystem::Run
+	=====================
+	*/
+	void JobSystem::Run(const Job &job, JobCounter *counter, JobCounter *dependency) {
+		if (counter) {
+			counter->count++;
+		}
+
+		if (dependency) {
+			lock_guard<mutex> guard(dependency->lock);
+
+			if (dependency->count > 0) {
+				JobCounter::Continuation cont = { job, counter };
+				dependency->continuations.push_back(cont);
+				return;
+			}
+		}
+
+		Entry entry = { job, counter };
+		Push(entry);
+	}
+
+	/*
+	=====================
+	JobSystem::Wait
+	=====================
+	*/
+	void JobSystem::Wait(JobCounter *counter) {
+		while (counter->count > 0) {
+			Entry entry;
+
+			if (Pop(entry)) {
+				Execute(entry);
+			} else {
+				this_thread::yield();
+			}
+		}
+
+		// Wait for the last job to let go of the counter
+		lock_guard<mutex> guard(counter->lock);
+	}
+
+	/*
+	=====================
+	JobSystem::ParallelFor
+	=====================
+	*/
+	void JobSystem::ParallelFor(unsigned int count, unsigned int grain, const RangeJob &job) {
+		if (!count) {
+			return;
+		}
+
+		if (!grain) {
+			grain = count / (numQueues * 4);
+			if (!grain) grain = 1;
+		}
+
+		if (grain >= count) {
+			job(0, count);
+			return;
+		}
+
+		JobCounter counter;
+
+		for (unsigned first=0; first<count; first+=grain) {
+			unsigned last = (first + grain < count) ? first + grain : count;
+
+			Run([&job, first, last]() {
+				job(first, last);
+			}, &counter);
+		}
+
+		Wait(&counter);
+	}
+
+	/*
+	=====================
+	JobSystem::RunOnMainThread
+	=====================
+	*/
+	void JobSystem::RunOnMainThread(const Job &job) {
+		lock_guard<mutex> guard(mainLock);
+		mainJobs.push_back(job);
+	}
+
+	/*
+	=====================
+	JobSystem::DispatchMainThreadJobs
+	=====================
+	*/
+	void JobSystem::DispatchMainThreadJobs() {
+		PIM_TRACE_ZONE("JobSystem::DispatchMainThreadJobs");
+
+		vector<Job> jobs;
+
+		{
+			lock_guard<mutex> guard(mainLock);
+			jobs.swap(mainJobs);
+		}
+
+		for (unsigned i=0; i<jobs.size(); i++) {
+			jobs[i]();
+		}
+	}
+
+	/*
+	=====================
+	JobSystem::GetWorkerCount
+	=====================
+	*/
+	unsigned int JobSystem::GetWorkerCount() const {
+		return workers.size();
+	}
+
+	/*
+	=====================
+	JobSystem::Push
+	=====================
+	*/
+	void JobSystem::Push(const Entry &entry) {
+		Queue &queue = queues[threadQueue];
+
+		{
+			lock_guard<mutex> guard(queue.lock);
+			queue.jobs.push_back(entry);
+		}
+
+		pending++;
+
+		// Taking the lock ensures a worker about to sleep sees the job
+		{
+			lock_guard<mutex> guard(sleepLock);
+		}
+		wake.notify_one();
+	}
+
+	/*
+	=====================
+	JobSystem::Pop
+
+	Takes the newest job of the thread's own queue, or steals
+	the oldest job of another queue.
+	=====================
+	*/
+	bool JobSystem::Pop(Entry &entry) {
+		if (pending <= 0) {
+			return false;
+		}
+
+		{
+			Queue &own = queues[threadQueue];
+			lock_guard<mutex> guard(own.lock);
+
+			if (!own.jobs.empty()) {
+				entry = own.jobs.back();
+				own.jobs.pop_back();
+				pending--;
+				return true;
+			}
+		}
+
+		for (unsigned i=1; i<numQueues; i++) {
+			Queue &victim = queues[(threadQueue + i) % numQueues];
+			lock_guard<mutex> guard(victim.lock);
+
+			if (!victim.jobs.empty()) {
+				entry = victim.jobs.front();
+				victim.jobs.pop_front();
+				pending--;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/*
+	=====================
+	JobSystem::Execute
+	=====================
+	*/
+	void JobSystem::Execute(Entry &entry) {
+		{
+			PIM_TRACE_ZONE("JobSystem::Job");
+			entry.job();
+		}
+
+		if (entry.counter) {
+			Finish(entry.counter);
+		}
+	}
+
+	/*
+	=====================
+	JobSystem::Finish
+
+	Decrements the counter, and queues the jobs depending on it
+	if it reached zero. The counter is locked while decremented,
+	as the waiting thread may destroy it as soon as it's unlocked.
+	=====================
+	*/
+	void JobSystem::Finish(JobCounter *counter) {
+		vector<JobCounter::Continuation> conts;
+
+		{
+			lock_guard<mutex> guard(counter->lock);
+
+			if (--counter->count > 0) {
+				return;
+			}
+
+			conts.swap(counter->continuations);
+		}
+
+		for (unsigned i=0; i<conts.size(); i++) {
+			Entry entry = { conts[i].job, conts[i].counter };
+			Push(entry);
+		}
+	}
+
+	/*
+	=====================
+	JobSystem::WorkerLoop
+	=====================
+	*/
+	void JobSystem::WorkerLoop(unsigned int idx) {
+		threadQueue = idx;
+		Trace::SetThreadName("Worker");
+
+		while (!quit) {
+			Entry entry;
+
+			if (Pop(entry)) {
+				Execute(entry);
+				continue;
+			}
+
+			unique_lock<mutex> guard(sleepLock);
+			wake.wait(guard, [this]() {
+				return pending > 0 || quit;
+			});
+		}
+	}
+}
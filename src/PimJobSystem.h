@@ -0,0 +1,167 @@
+#pragma once
+
+#include "PimInternal.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+
+// Thread local storage of plain data
+#ifdef WIN32
+	#define PIM_THREAD_LOCAL	__declspec(thread)
+#else
+	#define PIM_THREAD_LOCAL	__thread
+#endif
+
+namespace Pim {
+	/**
+	 @class 		JobCounter
+	 @brief 		Counts the unfinished jobs of a group of jobs.
+	 @details 		Pass the same counter to several calls to JobSystem::Run(),
+	 				and wait for all of them with JobSystem::Wait(). A counter
+	 				can also be passed as the dependency of another job, which
+	 				will not start before the counter reaches zero.
+
+	 				The counter must outlive the jobs it counts.
+	 */
+
+	class JobSystem;
+
+	class JobCounter {
+	public:
+								JobCounter();
+		bool					IsDone() const;
+
+	private:
+		friend class JobSystem;
+
+		struct Continuation {
+			function<void()>	job;
+			JobCounter			*counter;
+		};
+
+		atomic<int>				count;
+		mutable mutex			lock;
+		vector<Continuation>	continuations;	// Jobs waiting for this counter
+
+								JobCounter(const JobCounter&);
+		JobCounter&				operator=(const JobCounter&);
+	};
+
+	/**
+	 @class 		JobSystem
+	 @brief 		Runs jobs on a pool of worker threads.
+	 @details 		The JobSystem is owned by GameControl, and is available
+	 				via GameControl::GetJobSystem() while the game is running.
+	 				It runs one worker thread per core, except for the one
+	 				used by the main thread.
+
+	 				Every thread has it's own job queue. Jobs are pushed to the
+	 				queue of the thread running Run(), and are popped from the
+	 				back of the queue by it's owner. Idle workers steal jobs from
+	 				the front of the other queues.
+
+	 				A thread waiting for a JobCounter runs queued jobs while
+	 				waiting, so jobs may safely wait for other jobs.
+
+	 				OpenGL must only be used on the main thread. Jobs needing
+	 				OpenGL, like uploading a texture decoded by a worker, can
+	 				be passed to RunOnMainThread(). These are run by GameControl
+	 				once every frame, before the frame is rendered.
+
+	 				@code
+	 				JobSystem *js = GameControl::GetJobSystem();
+	 				js->Run([=]() {
+	 					DecodeImage(file, pixels);
+	 					js->RunOnMainThread([=]() {
+	 						UploadTexture(pixels);
+	 					});
+	 				});
+	 				@endcode
+	 */
+
+	class JobSystem {
+	public:
+		typedef function<void()>						Job;
+		typedef function<void(unsigned int,unsigned int)>	RangeJob;
+
+								JobSystem(unsigned int numWorkers=0);
+								~JobSystem();
+		void					Run(const Job &job, JobCounter *counter=NULL,
+									JobCounter *dependency=NULL);
+		void					Wait(JobCounter *counter);
+		void					ParallelFor(unsigned int count, unsigned int grain,
+											const RangeJob &job);
+		void					RunOnMainThread(const Job &job);
+		void					DispatchMainThreadJobs();
+		unsigned int			GetWorkerCount() const;
+
+	private:
+		struct Entry {
+			Job					job;
+			JobCounter			*counter;
+		};
+
+		struct Queue {
+			mutex				lock;
+			deque<Entry>		jobs;
+		};
+
+		vector<thread>			workers;
+		Queue					*queues;		// Index 0 is used by the main thread
+		unsigned int			numQueues;
+		atomic<int>				pending;		// Number of queued jobs
+		atomic<bool>			quit;
+		mutex					sleepLock;
+		condition_variable		wake;
+		mutex					mainLock;
+		vector<Job>				mainJobs;
+
+								JobSystem(const JobSystem&);
+		JobSystem&				operator=(const JobSystem&);
+
+		void					Push(const Entry &entry);
+		bool					Pop(Entry &entry);
+		void					Execute(Entry &entry);
+		void					Finish(JobCounter *counter);
+		void					WorkerLoop(unsigned int idx);
+	};
+
+	/**
+	 @fn 			JobSystem::JobSystem
+	 @brief 		Starts the worker threads. If numWorkers is 0, one worker
+	 				is created for each core but one.
+	 */
+
+	/**
+	 @fn 			JobSystem::Run
+	 @brief 		Queue a job.
+	 @param 		counter
+	 				Incremented now, and decremented when the job has finished.
+	 @param 		dependency
+	 				The job is not queued before this counter reaches zero.
+	 */
+
+	/**
+	 @fn 			JobSystem::Wait
+	 @brief 		Returns when the counter reaches zero. The calling thread runs
+	 				queued jobs in the meantime.
+	 */
+
+	/**
+	 @fn 			JobSystem::ParallelFor
+	 @brief 		Splits [0, count) into ranges of 'grain' indices, and calls
+	 				job(first, last) for each range in parallel. Returns when
+	 				all ranges are done.
+	 @details 		If grain is 0, the range is split into a few ranges per thread.
+	 */
+
+	/**
+	 @fn 			JobSystem::DispatchMainThreadJobs
+	 @brief 		Runs the jobs passed to RunOnMainThread(). Must only be called
+	 				from the main thread. Called by GameControl every frame.
+	 */
+}
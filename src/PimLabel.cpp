@@ -11,6 +11,8 @@ namespace Pim {
 	=====================
 	*/
 	Label::Label(const Font *pfont) {
+		kind |= NODE_KIND;
+
 		PimAssert(pfont != NULL, "Error: cannot pass NULL-font!");
 		fontOwner	= false;
 		anchor		= Vec2(0.5f, 0.5f);
@@ -26,6 +28,8 @@ namespace Pim {
 	=====================
 	*/
 	Label::Label(const Font *pfont, const string ptext) {
+		kind |= NODE_KIND;
+
 		PimAssert(pfont != NULL, "Error: cannot pass NULL-font!");
 		fontOwner	= false;
 		anchor		= Vec2(0.5f, 0.5f);
@@ -142,6 +146,8 @@ namespace Pim {
 		} else if (align == TEXT_RIGHT) {
 			anchor = Vec2(1.f, 0.5f);
 		}
+
+		MarkMoved();
 	}
 
 	/*
@@ -178,6 +184,8 @@ namespace Pim {
 
 		dim.x = (float)lon;
 		dim.y = (float)(font->size + (font->size + linePadding) * (lines.size()-1));
+
+		MarkMoved();
 	}
 
 	/*
@@ -224,13 +232,66 @@ namespace Pim {
 			glPopMatrix();
 		}
 
-		OrderChildren();
+		DrawChildren();
+
+		glPopMatrix();
+	}
+
+	/*
+	=====================
+	Label::ApplyChildTransform
+	=====================
+	*/
+	void Label::ApplyChildTransform() {
+		GameNode::ApplyChildTransform();
+
+		Vec2 fac = GameControl::GetSingleton()->GetWindowScale();
+		glScalef(scale.x * fac.x, scale.y * fac.y, 1.f);
+		glTranslatef(0.f, dim.y/2 - font->size, 0.f);
+	}
 
-		for (unsigned int i=0; i<children.size(); i++) {
-			children[i]->Draw();
+	/*
+	=====================
+	Label::GetChildTransform
+	=====================
+	*/
+	void Label::GetChildTransform(Transform2D &t) const {
+		GameNode::GetChildTransform(t);
+
+		Vec2 fac = GameControl::GetSingleton()->GetWindowScale();
+		t.Scale(scale.x * fac.x, scale.y * fac.y);
+		t.Translate(0.f, dim.y/2 - font->size);
+	}
+
+	/*
+	=====================
+	Label::GetContentBounds
+
+	The lines are bounded by their width, and one font height above
+	and below their baseline.
+	=====================
+	*/
+	bool Label::GetContentBounds(const Transform2D &parent, AABB &bounds) const {
+		bounds = AABB();
+
+		if (!font || lines.empty()) {
+			return true;
 		}
 
-		glPopMatrix();
+		Transform2D t = parent;
+		GetChildTransform(t);
+
+		float height = (float)font->size;
+
+		for (unsigned int i=0; i<lines.size() && i<lineWidth.size(); i++) {
+			float x = -(anchor.x) * lineWidth[i];
+			float y = -float(i*(font->size+linePadding));
+
+			bounds.Extend(t.Apply(AABB(Vec2(x, y - height),
+									   Vec2(x + lineWidth[i], y + height))));
+		}
+
+		return true;
 	}
 
 	/*
@@ -10,6 +10,8 @@
 #include "PimRenderTexture.h"
 #include "PimShaderManager.h"
 #include "PimRenderWindow.h"
+#include "PimCommandBuffer.h"
+#include "PimTrace.h"
 
 namespace Pim {
 	/*
@@ -18,6 +20,8 @@ namespace Pim {
 	=====================
 	*/
 	Layer::Layer(void) {
+		kind |= NODE_KIND;
+
 		color		= Color(1.f, 1.f, 1.f, 1.f);
 		immovable	= false;
 		scale		= Vec2(1.f, 1.f);
@@ -25,6 +29,15 @@ namespace Pim {
 		parentScene = NULL;
 		shader		= NULL;
 		rt			= NULL;
+
+		flatten			= false;
+		drawListDirty	= true;
+		drawOrderDirty	= false;
+		culling			= false;
+		cullFactor		= Vec2(0.f, 0.f);
+		cullScale		= Vec2(0.f, 0.f);
+		spatialIndex	= NULL;
+		drawTime		= 0.f;
 	}
 
 	/*
@@ -34,6 +47,7 @@ namespace Pim {
 	*/
 	Layer::~Layer(void) {
 		DestroyLightingSystem();
+		DestroySpatialIndex();
 
 		if (rt) {
 			delete rt;
@@ -125,6 +139,11 @@ namespace Pim {
 	=====================
 	*/
 	void Layer::Draw() {
+		PIM_TRACE_ZONE("Layer::Draw");
+
+		Tick start = GameControl::GetTime();
+		FrameStats *stats = GameControl::GetFrameStats();
+
 		PrepareRT();
 
 		glPushMatrix();
@@ -142,23 +161,42 @@ namespace Pim {
 		fac = GameControl::GetSingleton()->GetWindowScale();
 		glScalef(scale.x, scale.y, 1.f);
 
-		OrderChildren();
-
 		if (lightSys) {
+			Tick lightStart = GameControl::GetTime();
 			lightSys->UpdateShaderUniforms();
+			stats->AddTime(FrameStats::LIGHTING, float(GameControl::GetTime() - lightStart));
 		}
 
-		for (unsigned int i=0; i<children.size(); i++) {
-			children[i]->Draw();
+		// Nested layers are drawn as usual within a flattened layer
+		bool outerFlat = drawingFlat;
+		bool outerCulling = cullingActive;
+		drawingFlat = false;
+		cullingActive = culling;
+
+		if (culling) {
+			CullChildren();
 		}
 
+		if (flatten) {
+			DrawFlattened();
+		} else {
+			DrawChildren();
+		}
+
+		drawingFlat = outerFlat;
+		cullingActive = outerCulling;
+
 		if (lightSys) {
+			Tick lightStart = GameControl::GetTime();
 			lightSys->RenderLightTexture();
+			stats->AddTime(FrameStats::LIGHTING, float(GameControl::GetTime() - lightStart));
 		}
 
 		glPopMatrix();
 
 		RenderRT();
+
+		drawTime = float(GameControl::GetTime() - start);
 	}
 
 	/*
@@ -167,13 +205,19 @@ namespace Pim {
 	=====================
 	*/
 	void Layer::SetZOrder(const int z) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->SetZOrder(this, z);
+			return;
+		}
+
+		zOrder = z;
+
 		if (parent) {
 			parent->dirtyZOrder = true;
+			parent->InvalidateDrawList(false);
 		} else if (parentScene) {
 			parentScene->dirtyZOrder = true;
 		}
-
-		zOrder = z;
 	}
 
 	/*
@@ -199,6 +243,246 @@ namespace Pim {
 		return color;
 	}
 
+	/*
+	=====================
+	Layer::SetFlattenDrawOrder
+	=====================
+	*/
+	void Layer::SetFlattenDrawOrder(bool flag) {
+		flatten = flag;
+		drawList.clear();
+		drawListDirty = true;
+	}
+
+	/*
+	=====================
+	Layer::SetCulling
+	=====================
+	*/
+	void Layer::SetCulling(bool flag) {
+		culling = flag;
+	}
+
+	/*
+	=====================
+	Layer::GetCulling
+	=====================
+	*/
+	bool Layer::GetCulling() const {
+		return culling;
+	}
+
+	/*
+	=====================
+	Layer::GetViewBounds
+	=====================
+	*/
+	const AABB& Layer::GetViewBounds() const {
+		return viewBounds;
+	}
+
+	/*
+	=====================
+	Layer::CreateSpatialIndex
+	=====================
+	*/
+	void Layer::CreateSpatialIndex(const AABB &area, float cellSize) {
+		DestroySpatialIndex();
+		spatialIndex = new SpatialIndex(area, cellSize);
+	}
+
+	/*
+	=====================
+	Layer::DestroySpatialIndex
+	=====================
+	*/
+	void Layer::DestroySpatialIndex() {
+		if (spatialIndex) {
+			delete spatialIndex;
+			spatialIndex = NULL;
+		}
+	}
+
+	/*
+	=====================
+	Layer::GetSpatialIndex
+	=====================
+	*/
+	SpatialIndex* Layer::GetSpatialIndex() const {
+		return spatialIndex;
+	}
+
+	/*
+	=====================
+	Layer::GetDrawTime
+	=====================
+	*/
+	float Layer::GetDrawTime() const {
+		return drawTime;
+	}
+
+	/*
+	=====================
+	Layer::GetScreenTransform
+
+	Mirrors the matrices applied by Draw().
+	=====================
+	*/
+	void Layer::GetScreenTransform(Transform2D &t) const {
+		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+
+		if (parent && !immovable) {
+			Transform2D p;
+			parent->GetParentLayer()->GetScreenTransform(t);
+			parent->GetLayerTransform(p);
+			t = t * p;
+		} else {
+			t = Transform2D();
+			t.Scale(fac.x, fac.y);
+		}
+
+		t.Translate(position.x / fac.x, position.y / fac.y);
+		t.Rotate(rotation);
+		t.Scale(scale.x, scale.y);
+		t.Scale(1.f / fac.x, 1.f / fac.y);
+	}
+
+	/*
+	=====================
+	Layer::CullChildren
+
+	Computes the visible area from the current OpenGL matrices, and
+	flags the nodes whose subtrees are outside of it. The cached bounds
+	are in OpenGL units, so they are all recomputed when the coordinate
+	factor or the window scale changes.
+	=====================
+	*/
+	void Layer::CullChildren() {
+		float mv[16];
+		float proj[16];
+		glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+		glGetFloatv(GL_PROJECTION_MATRIX, proj);
+
+		Transform2D toClip = Transform2D::FromGLMatrix(proj) * Transform2D::FromGLMatrix(mv);
+
+		// The children are transformed in OpenGL units, the bounds are in coordinates
+		Vec2 fac = GameControl::GetSingleton()->GetCoordinateFactor();
+		Transform2D toLayer;
+		toLayer.Scale(fac.x, fac.y);
+
+		viewBounds = (toLayer * toClip.Inverse()).Apply(AABB(Vec2(-1.f, -1.f), Vec2(1.f, 1.f)));
+
+		Vec2 winScale = GameControl::GetSingleton()->GetWindowScale();
+		bool rescaled = (fac != cullFactor || winScale != cullScale);
+		cullFactor = fac;
+		cullScale = winScale;
+
+		for (unsigned i=0; i<children.size(); i++) {
+			if (!(children[i]->kind & KIND_BASE_ACTION)) {
+				CullSubtree(children[i], toLayer, rescaled, viewBounds);
+			}
+		}
+	}
+
+	/*
+	=====================
+	Layer::BuildDrawList
+	=====================
+	*/
+	void Layer::BuildDrawList() {
+		static vector<DrawEntry> ordered;
+		static vector<DrawEntry> displaced;
+
+		if (drawListDirty) {
+			drawList.clear();
+			CollectDrawList(this);
+
+			drawListDirty = false;
+			drawOrderDirty = true;
+		}
+
+		if (drawOrderDirty) {
+			SortAdaptive(drawList.data(), drawList.data() + drawList.size(),
+						 DrawEntryLess, ordered, displaced);
+			drawOrderDirty = false;
+		}
+	}
+
+	/*
+	=====================
+	Layer::CollectDrawList
+	=====================
+	*/
+	void Layer::CollectDrawList(GameNode *node) {
+		for (unsigned i=0; i<node->children.size(); i++) {
+			GameNode *child = node->children[i];
+
+			if (child->GetKind() & KIND_BASE_ACTION) {
+				continue;
+			}
+
+			DrawEntry entry = { child, (unsigned int)drawList.size() };
+			drawList.push_back(entry);
+
+			// These draw their own children
+			if (!(child->GetKind() & (KIND_LAYER | KIND_SPRITE_BATCH_NODE))) {
+				CollectDrawList(child);
+			}
+		}
+	}
+
+	/*
+	=====================
+	Layer::DrawEntryLess
+	=====================
+	*/
+	bool Layer::DrawEntryLess(const DrawEntry &a, const DrawEntry &b) {
+		if (a.node->zOrder != b.node->zOrder) {
+			return a.node->zOrder < b.node->zOrder;
+		}
+
+		return a.order < b.order;
+	}
+
+	/*
+	=====================
+	Layer::ApplyParentTransforms
+	=====================
+	*/
+	void Layer::ApplyParentTransforms(GameNode *node) {
+		if (!node || node == this) {
+			return;
+		}
+
+		ApplyParentTransforms(node->parent);
+		node->ApplyChildTransform();
+	}
+
+	/*
+	=====================
+	Layer::DrawFlattened
+	=====================
+	*/
+	void Layer::DrawFlattened() {
+		BuildDrawList();
+
+		drawingFlat = true;
+
+		for (unsigned i=0; i<drawList.size(); i++) {
+			GameNode *node = drawList[i].node;
+
+			if (cullingActive && node->culled) {
+				continue;
+			}
+
+			glPushMatrix();
+			ApplyParentTransforms(node->parent);
+			node->drawn = true;
+			node->Draw();
+			glPopMatrix();
+		}
+	}
+
 
 	// ---------- LIGHTING SYSTEM METHODS ----------
 	/*
@@ -356,6 +640,28 @@ namespace Pim {
 		}
 	}
 
+	/*
+	=====================
+	Layer::SetSmoothShadowQuality
+	=====================
+	*/
+	void Layer::SetSmoothShadowQuality(LightingSystem::SmoothShadowQuality q) {
+		if (lightSys) {
+			lightSys->SetSmoothShadowQuality(q);
+		}
+	}
+
+	/*
+	=====================
+	Layer::SetShadowMode
+	=====================
+	*/
+	void Layer::SetShadowMode(LightingSystem::ShadowMode mode) {
+		if (lightSys) {
+			lightSys->SetShadowMode(mode);
+		}
+	}
+
 	/*
 	=====================
 	Layer::Layer
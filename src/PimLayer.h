@@ -3,6 +3,7 @@
 #include "PimVec2.h"
 #include "PimGameNode.h"
 #include "PimLightingSystem.h"
+#include "PimSpatialIndex.h"
 
 namespace Pim {
 	/**
@@ -41,8 +42,10 @@ namespace Pim {
 	protected:
 		friend class Scene;
 		friend class GameControl;
+		friend class GameNode;
 
 	public:
+		enum { NODE_KIND = KIND_LAYER };
 
 		Vec2					scale;
 		bool					immovable;
@@ -63,6 +66,15 @@ namespace Pim {
 		virtual void			SetZOrder(const int z);
 		void					SetShader(Shader *shader);
 		Color					GetColor() const;
+		void					SetFlattenDrawOrder(bool flag);
+		void					SetCulling(bool flag);
+		bool					GetCulling() const;
+		const AABB&				GetViewBounds() const;
+		void					CreateSpatialIndex(const AABB &area, float cellSize);
+		void					DestroySpatialIndex();
+		SpatialIndex*			GetSpatialIndex() const;
+		void					GetScreenTransform(Transform2D &t) const;
+		float					GetDrawTime() const;
 
 		// ---------- LIGHTING SYSTEM METHODS ----------
 		void					CreateLightingSystem(Vec2 resolution);
@@ -77,6 +89,8 @@ namespace Pim {
 		void					SetLightingUnlitColor(const Color color);
 		void					SetLightAlpha(const float a);
 		void					SetSmoothShadows(const bool flag);
+		void					SetSmoothShadowQuality(LightingSystem::SmoothShadowQuality q);
+		void					SetShadowMode(LightingSystem::ShadowMode mode);
 		void					SetShadowcasterDebugDraw(const bool);
 		LightingSystem*			GetLightingSystem() const;
 
@@ -90,6 +104,28 @@ namespace Pim {
 	private:
 		RenderTexture*			rt;			// Used for post processing effects (shader)
 		Vec2					curRTRes;	// Resolution of the RT
+		bool					flatten;
+		struct DrawEntry {
+			GameNode			*node;
+			unsigned int		order;		// Pre-order index in the layer, breaks z-order ties
+		};
+
+		vector<DrawEntry>		drawList;	// All nodes in the layer, sorted by z-order
+		bool					drawListDirty;	// Nodes were added or removed
+		bool					drawOrderDirty;	// Nodes were reordered
+		bool					culling;
+		AABB					viewBounds;	// The visible area, in layer coordinates
+		Vec2					cullFactor;	// The coordinate factor and window scale
+		Vec2					cullScale;	// the cached bounds were computed with
+		SpatialIndex			*spatialIndex;
+		float					drawTime;	// Seconds spent in the last Draw()
+
+		void					BuildDrawList();
+		void					CollectDrawList(GameNode *node);
+		static bool				DrawEntryLess(const DrawEntry &a, const DrawEntry &b);
+		void					ApplyParentTransforms(GameNode *node);
+		void					DrawFlattened();
+		void					CullChildren();
 	};
 	
 	/**
@@ -111,6 +147,85 @@ namespace Pim {
 	 				systems are guaranteed to be instantiated and ready.
 	 */
 	
+	/**
+	 @fn 			Layer::SetCulling
+	 @brief 		Skip drawing the nodes outside of the screen.
+	 @details 		Before drawing, the layer computes the bounds of every node
+	 				(see GameNode::GetContentBounds()) and every subtree in the
+	 				layer. Subtrees entirely outside of the screen are not drawn,
+	 				and their Draw() methods are not called.
+
+	 				The bounds are cached on the nodes, and only recomputed for
+	 				the nodes marked by GameNode::MarkMoved(), and their
+	 				ancestors. Subtrees which stay entirely on or off the screen
+	 				are not walked into, so a mostly static layer costs little
+	 				more than what changes in it. Nodes moved by assigning
+	 				their position, rotation or scale directly @b must be
+	 				marked, or they may be culled by their old bounds. Nested
+	 				layers cull their own children.
+
+	 				Nodes with unknown bounds are never culled, but their
+	 				children may be. Classes deriving from GameNode directly
+	 				have unknown bounds unless they override
+	 				GameNode::GetContentBounds(). Disabled by default.
+	 */
+
+	/**
+	 @fn 			Layer::GetViewBounds
+	 @brief 		The area visible on screen in layer coordinates, as of the
+	 				last frame drawn with culling enabled.
+	 */
+
+	/**
+	 @fn 			Layer::CreateSpatialIndex
+	 @brief 		Instantiate a SpatialIndex covering 'area' of this Layer.
+	 @details 		Replaces the current index, if any. The index starts out
+	 				empty; insert the nodes which should be found by queries.
+	 				Only insert nodes in this layer, and not in nested layers,
+	 				as the bounds are in the coordinates of the node's layer.
+	 */
+
+	/**
+	 @fn 			Layer::DestroySpatialIndex
+	 @brief 		Destroys the SpatialIndex of this layer (if there is one).
+	 */
+
+	/**
+	 @fn 			Layer::GetDrawTime
+	 @brief 		The seconds spent drawing this layer in the last frame,
+	 				including nested layers and the lighting system. See
+	 				FrameStats for the timings of the whole frame.
+	 */
+
+	/**
+	 @fn 			Layer::GetScreenTransform
+	 @brief 		Computes the transformation from the coordinates of this
+	 				layer to the coordinates of MouseEvent::GetPosition().
+	 */
+
+	/**
+	 @fn 			Layer::SetFlattenDrawOrder
+	 @brief 		Draw all nodes in the layer ordered by their Z-order,
+	 				regardless of their depth in the node tree.
+	 @details 		By default, the Z-order of a node only orders it among it's
+	 				siblings. When the draw order is flattened, the layer gathers
+	 				all it's descendants in a single list sorted by Z-order (ties
+	 				are broken by the order of the node tree, parents before
+	 				their children). This is useful for sorting characters by
+	 				their Y-position, even if they are children of different
+	 				nodes.
+
+	 				The list is rebuilt only when nodes have been added to or
+	 				removed from this layer, and resorted only when nodes in it
+	 				have been reordered. Nested Layers and SpriteBatchNodes are
+	 				placed in the list as a whole, and draw their children as
+	 				usual. Actions are not in the list.
+
+	 				Nodes overriding Draw() must draw their children through
+	 				GameNode::DrawChildren(), and override ApplyChildTransform()
+	 				if they transform their children differently than GameNode.
+	 */
+
 	/**
 	 @fn 			Layer::CreateLightingSystem
 	 @brief 		Instantiate the LightingSystem in this Layer.
@@ -205,6 +320,18 @@ namespace Pim {
 	 @brief 		Enable or disable gaussian blur on the LightingSystem texture.
 	 */
 	
+	/**
+	 @fn 			Layer::SetSmoothShadowQuality
+	 @brief 		Select the blur used by smooth shadows. See LightingSystem
+	 				for details.
+	 */
+	
+	/**
+	 @fn 			Layer::SetShadowMode
+	 @brief 		Select stencil, polar shadow map or visibility polygon shadows. 
+	 				See LightingSystem for details.
+	 */
+	
 	/**
 	 @fn 			Layer::SetShadowCasterDebugDraw
 	 @brief 		Debug draw shadow casters. This is NOT related to the shadow-shape
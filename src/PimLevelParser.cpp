@@ -7,6 +7,7 @@
 #include "PimSprite.h"
 #include "PimVec2.h"
 #include "PimLightDef.h"
+#include "PimTrace.h"
 
 namespace Pim {
 	/*
@@ -62,6 +63,8 @@ namespace Pim {
 	=====================
 	*/
 	bool LevelParser::Parse(const string path, Layer *layer) {
+		PIM_TRACE_ZONE("LevelParser::Parse");
+
 		PimAssert(layer != NULL, "Error: must pass a non-nil layer to LevelParser::parse()!");
 
 	#ifdef PIMEDIT
@@ -80,7 +83,7 @@ namespace Pim {
 		root = doc.FirstChildElement("layer");
 		if (root) {
 			data.layer = layer;
-			data.layer->identifier = "layer";
+			data.layer->SetIdentifier("layer");
 
 			// Parse all childless batch nodes (defined at root level in the XML)
 			ParseRootBatchNodes(&doc);
@@ -178,7 +181,7 @@ namespace Pim {
 			ParseIdentifier(cur, sbn);
 			ParseImage(cur, sbn);
 
-			batchNodes[sbn->identifier] = sbn;
+			batchNodes[sbn->GetIdentifier()] = sbn;
 		}
 	}
 
@@ -236,6 +239,9 @@ namespace Pim {
 
 		// Sprite & GameNode attribute
 		ParseLight(elem, node);
+
+		// The attributes are set after the node is added to it's parent
+		node->MarkMoved();
 	}
 
 	/*
@@ -277,6 +283,9 @@ namespace Pim {
 		ParseScale(elem, sprite);
 		ParseRect(elem, sprite);
 		ParseBatch(elem, sprite);
+
+		// The attributes are set after the sprite is added to it's parent
+		sprite->MarkMoved();
 	}
 
 
@@ -376,7 +385,7 @@ namespace Pim {
 		const char *attr = elem->Attribute("identifier");
 
 		if (attr != NULL) {
-			node->identifier = attr;
+			node->SetIdentifier(attr);
 		}
 	}
 
@@ -17,6 +17,7 @@ namespace Pim {
 		lightType		= -1;
 
 		isPreloaded		= false;
+		isCached		= false;
 	}
 
 	/*
@@ -25,7 +26,9 @@ namespace Pim {
 	=====================
 	*/
 	LightDef::~LightDef() {
-		if (lTex && !isPreloaded) {
+		if (lTex && isCached) {
+			LightingSystem::ReleaseLightTexture(lTex);
+		} else if (lTex && !isPreloaded) {
 			glDeleteTextures(1, &lTex);
 		}
 	}
@@ -47,6 +47,7 @@ namespace Pim {
 		short			lightType;		// 0=flat, 1=smooth
 		GLuint			lTex;			// Texture containing the light itself
 		bool			isPreloaded;	// Is the texture used preloaded?
+		bool			isCached;		// Is the texture owned by the texture cache?
 	};
 
 	// Flat lights have the same color in the radius area, and a "falloff" zone
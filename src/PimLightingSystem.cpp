@@ -11,13 +11,208 @@
 #include "PimSprite.h"
 #include "PimPolygonShape.h"
 #include "PimAssert.h"
+#include "PimJobSystem.h"
+#include "PimTrace.h"
 
 #include "PimLightingSystemShaders.h"
 
+// Distance at which a light no longer affects normal-maps
+#define PIM_LS_NORMALMAP_RANGE	400.f
+
+// Maximum number of tiles in each direction of the tile grid
+#define PIM_LS_MAX_TILES		64
+
+// Width of the tile list texture
+#define PIM_LS_TILE_LIST_WIDTH	1024
+
+// Number of angles in a polar shadow map
+#define PIM_LS_POLAR_RES		512
+
+// Number of lights per visibility polygon job
+#define PIM_LS_VIS_LIGHTS_PER_JOB		4
 
 namespace Pim {
 	int LightingSystem::numSystemsCreated = 0;
 
+	map<LightingSystem::LightTexKey,LightingSystem::LightTexEntry> LightingSystem::texCache;
+	unsigned LightingSystem::texCacheMaxUnused	= 8;
+	unsigned LightingSystem::texCacheClock		= 0;
+
+	/*
+	=====================
+	LightingSystem::LightTexKey::LightTexKey
+	=====================
+	*/
+	LightingSystem::LightTexKey::LightTexKey(const LightDef *lDef) {
+		lightType	= lDef->lightType;
+		radius		= lDef->radius;
+		innerColor	= lDef->innerColor;
+		outerColor	= lDef->outerColor;
+		falloff		= 0.f;
+		innerPasses = 0;
+
+		// Only include the parameters actually read by the texture renderers
+		if (lightType == 0) {
+			falloff = (lDef->falloff < 0.f) ? 0.f : lDef->falloff;
+		} else if (lightType == 1) {
+			innerPasses = ((const SmoothLightDef*)lDef)->innerPasses;
+		}
+	}
+
+	/*
+	=====================
+	LightingSystem::LightTexKey::operator<
+	=====================
+	*/
+	bool LightingSystem::LightTexKey::operator<(const LightTexKey &o) const {
+		if (lightType != o.lightType)			return lightType < o.lightType;
+		if (radius != o.radius)					return radius < o.radius;
+		if (falloff != o.falloff)				return falloff < o.falloff;
+		if (innerPasses != o.innerPasses)		return innerPasses < o.innerPasses;
+
+		const float *a = &innerColor.r;
+		const float *b = &o.innerColor.r;
+		for (int i=0; i<4; i++) {
+			if (a[i] != b[i]) return a[i] < b[i];
+		}
+
+		a = &outerColor.r;
+		b = &o.outerColor.r;
+		for (int i=0; i<4; i++) {
+			if (a[i] != b[i]) return a[i] < b[i];
+		}
+
+		return false;
+	}
+
+	/*
+	=====================
+	LightingSystem::AcquireLightTexture
+
+	Assigns a light texture to the LightDef, either from the texture 
+	cache or by rendering and caching a new one.
+	=====================
+	*/
+	void LightingSystem::AcquireLightTexture(LightDef *lDef) {
+		if (lDef->lightType != 0 && lDef->lightType != 1) {
+			PimAssert(0, "Error: invalid light type!");
+			return;
+		}
+
+		LightTexKey key(lDef);
+		auto it = texCache.find(key);
+
+		if (it == texCache.end()) {
+			if (lDef->lightType == 0) {
+				CreateFlatLightTexture(lDef);
+			} else {
+				CreateSmoothLightTexture(lDef);
+			}
+
+			LightTexEntry entry;
+			entry.tex		= lDef->lTex;
+			entry.radius	= lDef->radius;
+			entry.refs		= 0;
+			entry.lastUse	= 0;
+
+			it = texCache.insert(make_pair(key, entry)).first;
+		} else {
+			// Apply the modifications the renderers would have made
+			if (lDef->lightType == 0 && lDef->falloff < 0.f) {
+				lDef->falloff = 0.f;
+			}
+
+			lDef->lTex		= it->second.tex;
+			lDef->radius	= it->second.radius;
+		}
+
+		it->second.refs++;
+		it->second.lastUse = ++texCacheClock;
+
+		lDef->isCached = true;
+	}
+
+	/*
+	=====================
+	LightingSystem::ReleaseLightTexture
+
+	Called by LightDef upon deletion. The number of unique cached
+	textures is expected to be low, so the linear scan is fine.
+	=====================
+	*/
+	void LightingSystem::ReleaseLightTexture(GLuint tex) {
+		for (auto it=texCache.begin(); it!=texCache.end(); it++) {
+			if (it->second.tex == tex) {
+				it->second.refs--;
+				it->second.lastUse = ++texCacheClock;
+				break;
+			}
+		}
+
+		EvictLightTextures(texCacheMaxUnused);
+	}
+
+	/*
+	=====================
+	LightingSystem::EvictLightTextures
+
+	Deletes the least recently used unreferenced textures until
+	at most 'maxUnused' unreferenced textures remain.
+	=====================
+	*/
+	void LightingSystem::EvictLightTextures(unsigned maxUnused) {
+		unsigned unused = 0;
+		for (auto it=texCache.begin(); it!=texCache.end(); it++) {
+			if (it->second.refs <= 0) {
+				unused++;
+			}
+		}
+
+		while (unused > maxUnused) {
+			auto oldest = texCache.end();
+			for (auto it=texCache.begin(); it!=texCache.end(); it++) {
+				if (it->second.refs <= 0 && 
+					(oldest == texCache.end() || it->second.lastUse < oldest->second.lastUse)) {
+					oldest = it;
+				}
+			}
+
+			glDeleteTextures(1, &oldest->second.tex);
+			texCache.erase(oldest);
+			unused--;
+		}
+	}
+
+	/*
+	=====================
+	LightingSystem::SetLightTextureCacheSize
+	=====================
+	*/
+	void LightingSystem::SetLightTextureCacheSize(unsigned maxUnused) {
+		texCacheMaxUnused = maxUnused;
+		EvictLightTextures(texCacheMaxUnused);
+	}
+
+	/*
+	=====================
+	LightingSystem::PurgeLightTextureCache
+
+	Deletes all unreferenced light textures.
+	=====================
+	*/
+	void LightingSystem::PurgeLightTextureCache() {
+		EvictLightTextures(0);
+	}
+
+	/*
+	=====================
+	LightingSystem::GetLightTextureCacheCount
+	=====================
+	*/
+	int LightingSystem::GetLightTextureCacheCount() {
+		return (int)texCache.size();
+	}
+
 	/*
 	=====================
 	LightingSystem::CreateSmoothLightTexture
@@ -157,10 +352,36 @@ namespace Pim {
 		shaderLightTex	= NULL;
 		shaderGauss		= NULL;
 		shaderNormalMap = NULL;
+		shaderDualDown	= NULL;
+		shaderDualUp	= NULL;
+		shaderPolar		= NULL;
+		smoothQuality	= SMOOTH_GAUSS;
+		shadowMode		= SHADOW_STENCIL;
+		polarTex		= 0;
 
 		mainRT = new RenderTexture(resolution, true);
 		gaussRT = new RenderTexture(resolution);
 
+		tileSize		= 128.f;
+		tileSizeUsed	= tileSize;
+		tilesX			= 0;
+		tilesY			= 0;
+		tileListRows	= 1;
+
+		GLuint tex[2];
+		glGenTextures(2, tex);
+		tileGridTex		= tex[0];
+		tileListTex		= tex[1];
+
+		for (int i=0; i<2; i++) {
+			glBindTexture(GL_TEXTURE_2D, tex[i]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
 		LoadShaders();
 	}
 
@@ -192,8 +413,31 @@ namespace Pim {
 			ShaderManager::RemoveShader(shaderNormalMap);
 		}
 
+		if (shaderDualDown) {
+			ShaderManager::RemoveShader(shaderDualDown);
+		}
+
+		if (shaderDualUp) {
+			ShaderManager::RemoveShader(shaderDualUp);
+		}
+
+		if (shaderPolar) {
+			ShaderManager::RemoveShader(shaderPolar);
+		}
+
+		if (polarTex) {
+			glDeleteTextures(1, &polarTex);
+		}
+
 		delete mainRT;
 		delete gaussRT;
+
+		for (unsigned i=0; i<dualRT.size(); i++) {
+			delete dualRT[i];
+		}
+
+		glDeleteTextures(1, &tileGridTex);
+		glDeleteTextures(1, &tileListTex);
 	}
 
 
@@ -216,6 +460,7 @@ namespace Pim {
 		color = c;
 		shaderLightTex->SetUniform4f("ulcolor", c.r, c.g, c.b, c.a);
 		shaderGauss->SetUniform4f("ulcolor", c.r, c.g, c.b, c.a);
+		shaderDualUp->SetUniform4f("ulcolor", c.r, c.g, c.b, c.a);
 	}
 
 	/*
@@ -230,6 +475,7 @@ namespace Pim {
 		a = 1.f - a;
 		shaderLightTex->SetUniform1f("lalpha", a);
 		shaderGauss->SetUniform1f("lalpha", a);
+		shaderDualUp->SetUniform1f("lalpha", a);
 	}
 
 	/*
@@ -250,6 +496,86 @@ namespace Pim {
 		dbgDrawNormal = flag;
 	}
 
+	/*
+	=====================
+	LightingSystem::SetShadowMode
+	=====================
+	*/
+	void LightingSystem::SetShadowMode(ShadowMode mode) {
+		shadowMode = mode;
+
+		if (shadowMode == SHADOW_POLAR && !polarTex) {
+			glGenTextures(1, &polarTex);
+			glBindTexture(GL_TEXTURE_2D, polarTex);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+
+	/*
+	=====================
+	LightingSystem::GetShadowCasters
+	=====================
+	*/
+	const vector<GameNode*>& LightingSystem::GetShadowCasters() const {
+		return casters;
+	}
+
+	/*
+	=====================
+	LightingSystem::GetVisibilityPolygon
+
+	Returns NULL unless the shadow mode is SHADOW_VISIBILITY and the 
+	light casts shadows. The polygon is updated each frame, and is in
+	the coordinate system used to render the lights.
+	=====================
+	*/
+	const VisibilityPolygon* LightingSystem::GetVisibilityPolygon(GameNode *light) const {
+		auto it = visPolys.find(light);
+		if (it != visPolys.end()) {
+			return &it->second;
+		}
+		return NULL;
+	}
+
+	/*
+	=====================
+	LightingSystem::SetSmoothShadowQuality
+
+	(Re)creates the downsample chain used by the dual filter blur.
+	=====================
+	*/
+	void LightingSystem::SetSmoothShadowQuality(SmoothShadowQuality quality) {
+		smoothQuality = quality;
+
+		for (unsigned i=0; i<dualRT.size(); i++) {
+			delete dualRT[i];
+		}
+
+		dualRT.clear();
+		dualRes.clear();
+
+		Vec2 res = resolution;
+		for (int i=0; i<(int)quality; i++) {
+			res = Vec2(floorf(res.x / 2.f), floorf(res.y / 2.f));
+			if (res.x < 1.f) res.x = 1.f;
+			if (res.y < 1.f) res.y = 1.f;
+
+			RenderTexture *rt = new RenderTexture(res);
+
+			rt->BindTex();
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			rt->UnbindTex();
+
+			dualRT.push_back(rt);
+			dualRes.push_back(res);
+		}
+	}
+
 
 	/*
 	=====================
@@ -263,12 +589,8 @@ namespace Pim {
 
 		lights[node] = lDef;
 
-		if (lDef->lightType == 0) {
-			CreateFlatLightTexture(lDef);
-		} else if (lDef->lightType == 1) {
-			CreateSmoothLightTexture(lDef);
-		} else if (lDef->lightType != 2) {
-			PimAssert(0, "Error: invalid light type!");
+		if (lDef->lightType != 2) {
+			AcquireLightTexture(lDef);
 		}
 	}
 
@@ -295,6 +617,7 @@ namespace Pim {
 		if (lights.count(light)) {
 			delete lights[light];
 			lights.erase(light);
+			visPolys.erase(light);
 
 			/* Remove it if it is a normalmap affecting light */
 			for (unsigned i=0; i<normalLights.size(); i++) {
@@ -325,11 +648,6 @@ namespace Pim {
 	==================
 	*/
 	bool LightingSystem::SetNormalLighting(GameNode *light, bool flag) {
-		/* No more room */
-		if (normalLights.size() >= 10 && flag) {
-			return false;
-		}
-
 		/* The light is already flagged for normal lighting */
 		for (unsigned i=0; i<normalLights.size(); i++) {
 			if (light == normalLights[i]) {
@@ -435,6 +753,36 @@ namespace Pim {
 			shaderGauss->SetUniform4f("ulcolor", 0.f, 0.f, 0.f, 1.f);
 		}
 
+		/* Dual filter blur shaders */
+		if (!shaderDualDown) {
+			shaderDualDown = ShaderManager::AddShader(
+				PIM_LS_DUAL_DOWN_FRAG, PIM_BAREBONES_VERT, "ltMgrDualDown" + name.str()
+			);
+
+			shaderDualDown->SetUniform1i("tex", 0);
+		}
+
+		if (!shaderDualUp) {
+			shaderDualUp = ShaderManager::AddShader(
+				PIM_LS_DUAL_UP_FRAG, PIM_BAREBONES_VERT, "ltMgrDualUp" + name.str()
+			);
+
+			shaderDualUp->SetUniform1i("tex", 0);
+			shaderDualUp->SetUniform1f("composite", 0.f);
+			shaderDualUp->SetUniform1f("lalpha", 1.f);
+			shaderDualUp->SetUniform4f("ulcolor", 0.f, 0.f, 0.f, 1.f);
+		}
+
+		/* Polar shadow map shader */
+		if (!shaderPolar) {
+			shaderPolar = ShaderManager::AddShader(
+				PIM_LS_POLAR_FRAG, PIM_BAREBONES_VERT, "ltMgrPolar" + name.str()
+			);
+
+			shaderPolar->SetUniform1i("tex", 0);
+			shaderPolar->SetUniform1i("polarMap", 1);
+		}
+
 		/* Normal map shader */
 		if (!shaderNormalMap) {
 			shaderNormalMap = ShaderManager::AddShader(
@@ -443,6 +791,10 @@ namespace Pim {
 
 			shaderNormalMap->SetUniform1i("tex0", 0);
 			shaderNormalMap->SetUniform1i("tex1", 1);
+			shaderNormalMap->SetUniform1i("tileGrid", 2);
+			shaderNormalMap->SetUniform1i("tileList", 3);
+			shaderNormalMap->SetUniform1f("range", PIM_LS_NORMALMAP_RANGE);
+			shaderNormalMap->SetUniform1f("listWidth", (float)PIM_LS_TILE_LIST_WIDTH);
 		}
 	}
 
@@ -452,27 +804,167 @@ namespace Pim {
 	==================
 	*/
 	void LightingSystem::UpdateShaderUniforms() {
-		GLfloat pos[20] = { 0.f };
-		GLfloat rad[10] = { 0.f };
+		BuildNormalLightTiles();
+
+		shaderNormalMap->EnableShader();
+
+		glUniform2f(shaderNormalMap->GetUniformLocation("gridOrigin"), tileOrigin.x, tileOrigin.y);
+		glUniform2f(shaderNormalMap->GetUniformLocation("gridSize"), (float)tilesX, (float)tilesY);
+		glUniform1f(shaderNormalMap->GetUniformLocation("tileSize"), tileSizeUsed);
+		glUniform1f(shaderNormalMap->GetUniformLocation("listRows"), (float)tileListRows);
+
+		shaderNormalMap->DisableShader();
+	}
+
+	/*
+	==================
+	LightingSystem::BuildNormalLightTiles
+
+	Divides the area affected by the normal-map lights into tiles and 
+	bins the lights into every tile their area of effect overlaps.
+	The tiles are stored as (offset, count) in tileGridTex, and the 
+	binned light positions are stored contiguously in tileListTex.
+	==================
+	*/
+	void LightingSystem::BuildNormalLightTiles() {
+		const float range = PIM_LS_NORMALMAP_RANGE;
+
+		tilesX = 0;
+		tilesY = 0;
+
+		if (normalLights.empty()) {
+			return;
+		}
+
+		/* Find the bounds of the area affected by the lights */
+		Vec2 lo = normalLights[0]->position;
+		Vec2 hi = lo;
+
+		for (unsigned i=1; i<normalLights.size(); i++) {
+			const Vec2 &p = normalLights[i]->position;
+			if (p.x < lo.x) lo.x = p.x;
+			if (p.y < lo.y) lo.y = p.y;
+			if (p.x > hi.x) hi.x = p.x;
+			if (p.y > hi.y) hi.y = p.y;
+		}
 
-		for (unsigned i=0; i<normalLights.size() && i<10; i++) {
-			GameNode *light = normalLights[i];
+		lo -= Vec2(range, range);
+		hi += Vec2(range, range);
 
-			pos[i*2 + 0] = light->position.x;
-			pos[i*2 + 1] = light->position.y;
+		/* Grow the tiles if the grid would be too large */
+		tileSizeUsed = tileSize;
+		if ((hi.x - lo.x) / tileSizeUsed > PIM_LS_MAX_TILES) {
+			tileSizeUsed = (hi.x - lo.x) / PIM_LS_MAX_TILES;
+		}
+		if ((hi.y - lo.y) / tileSizeUsed > PIM_LS_MAX_TILES) {
+			tileSizeUsed = (hi.y - lo.y) / PIM_LS_MAX_TILES;
+		}
+
+		tileOrigin = lo;
+		tilesX = (int)ceilf((hi.x - lo.x) / tileSizeUsed);
+		tilesY = (int)ceilf((hi.y - lo.y) / tileSizeUsed);
+
+		if (tilesX > PIM_LS_MAX_TILES) tilesX = PIM_LS_MAX_TILES;
+		if (tilesY > PIM_LS_MAX_TILES) tilesY = PIM_LS_MAX_TILES;
+
+		const int numTiles = tilesX * tilesY;
+
+		/* Count the lights per tile, then store the light positions 
+		 * contiguously using the prefix sum of the counts as offsets.
+		 */
+		tileCounts.assign(numTiles, 0);
+		tileGridData.assign(numTiles * 4, 0.f);
+
+		for (int pass=0; pass<2; pass++) {
+			for (unsigned i=0; i<normalLights.size(); i++) {
+				const Vec2 &p = normalLights[i]->position;
+				Vec2 rel = p - tileOrigin;
+
+				int x0 = (int)((rel.x - range) / tileSizeUsed);
+				int y0 = (int)((rel.y - range) / tileSizeUsed);
+				int x1 = (int)((rel.x + range) / tileSizeUsed);
+				int y1 = (int)((rel.y + range) / tileSizeUsed);
+
+				if (x0 < 0) x0 = 0;
+				if (y0 < 0) y0 = 0;
+				if (x1 >= tilesX) x1 = tilesX - 1;
+				if (y1 >= tilesY) y1 = tilesY - 1;
+
+				for (int y=y0; y<=y1; y++) {
+					for (int x=x0; x<=x1; x++) {
+						// Skip the tiles outside the circle of effect
+						float cx = rel.x - (float)x * tileSizeUsed;
+						float cy = rel.y - (float)y * tileSizeUsed;
+						float dx = cx - ((cx < 0.f) ? 0.f : (cx > tileSizeUsed) ? tileSizeUsed : cx);
+						float dy = cy - ((cy < 0.f) ? 0.f : (cy > tileSizeUsed) ? tileSizeUsed : cy);
+						if (dx*dx + dy*dy > range*range) {
+							continue;
+						}
+
+						int t = y * tilesX + x;
+
+						if (pass == 0) {
+							tileCounts[t]++;
+						} else {
+							int idx = (int)tileGridData[t*4] + (int)tileGridData[t*4 + 1]++;
+							tileListData[idx*4 + 0] = p.x;
+							tileListData[idx*4 + 1] = p.y;
+						}
+					}
+				}
+			}
 
-			if (lights.count(light)) {
-				rad[i] = lights[light]->radius;
+			if (pass == 0) {
+				int total = 0;
+				for (int t=0; t<numTiles; t++) {
+					tileGridData[t*4] = (float)total;
+					total += tileCounts[t];
+				}
+
+				tileListRows = total / PIM_LS_TILE_LIST_WIDTH + 1;
+				tileListData.assign(tileListRows * PIM_LS_TILE_LIST_WIDTH * 4, 0.f);
 			}
 		}
 
-		shaderNormalMap->EnableShader();
+		/* Upload the tiles */
+		glBindTexture(GL_TEXTURE_2D, tileGridTex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, tilesX, tilesY, 0, 
+					 GL_RGBA, GL_FLOAT, &tileGridData[0]);
 
-		glUniform1i(shaderNormalMap->GetUniformLocation("numLights"), (int)normalLights.size());
-		glUniform2fv(shaderNormalMap->GetUniformLocation("lpos"), 10, pos);
-		glUniform1fv(shaderNormalMap->GetUniformLocation("lrad"), 10, rad);
+		glBindTexture(GL_TEXTURE_2D, tileListTex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, PIM_LS_TILE_LIST_WIDTH, tileListRows, 0,
+					 GL_RGBA, GL_FLOAT, &tileListData[0]);
 
-		shaderNormalMap->DisableShader();
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	/*
+	==================
+	LightingSystem::BindNormalLightTiles
+
+	Binds the tile textures to texture unit 2 and 3. Called by NormalMap
+	objects prior to drawing.
+	==================
+	*/
+	void LightingSystem::BindNormalLightTiles() {
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, tileGridTex);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, tileListTex);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	/*
+	==================
+	LightingSystem::SetNormalLightTileSize
+	==================
+	*/
+	void LightingSystem::SetNormalLightTileSize(float size) {
+		if (size < 1.f) {
+			size = 1.f;
+		}
+
+		tileSize = size;
 	}
 
 	/*
@@ -510,7 +1002,10 @@ namespace Pim {
 		// Unbind the FBO
 		mainRT->UnbindFBO();
 
-		if (hqShadow) {
+		if (hqShadow && dualRT.size()) {
+			DualFilterPass();
+			dualRT[0]->BindTex();
+		} else if (hqShadow) {
 			GaussPass();
 			gaussRT->BindTex();
 		} else {
@@ -561,12 +1056,104 @@ namespace Pim {
 		glUseProgram(shaderGauss->GetProgram());
 	}
 
+	/*
+	=====================
+	LightingSystem::DualFilterPass
+
+	Downsamples mainRT through the dualRT chain, then upsamples back to
+	dualRT[0]. The upsample shader is left bound to composite the final
+	upsample onto the screen.
+	=====================
+	*/
+	void LightingSystem::DualFilterPass() {
+		const unsigned levels = dualRT.size();
+
+		// Straight copies - blending would darken the chain
+		glDisable(GL_BLEND);
+
+		mainRT->BindTex();
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		/* Downsample: mainRT -> dualRT[0] -> ... -> dualRT[levels-1] */
+		glUseProgram(shaderDualDown->GetProgram());
+		GLint locHalf = shaderDualDown->GetUniformLocation("halfpixel");
+
+		for (unsigned i=0; i<levels; i++) {
+			const Vec2 src = (i == 0) ? resolution : dualRes[i-1];
+			const Vec2 &dst = dualRes[i];
+
+			glUniform2f(locHalf, 0.5f / src.x, 0.5f / src.y);
+
+			dualRT[i]->BindFBO();
+			dualRT[i]->Clear();
+
+			if (i == 0) {
+				mainRT->BindTex();
+			} else {
+				dualRT[i-1]->BindTex();
+			}
+
+			glBegin(GL_QUADS);
+				glTexCoord2i(0,0); glVertex2f(0.f, 0.f);
+				glTexCoord2i(1,0); glVertex2f(dst.x, 0.f);
+				glTexCoord2i(1,1); glVertex2f(dst.x, dst.y);
+				glTexCoord2i(0,1); glVertex2f(0.f, dst.y);
+			glEnd();
+
+			dualRT[i]->UnbindFBO();
+		}
+
+		mainRT->BindTex();
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		/* Upsample: dualRT[levels-1] -> ... -> dualRT[0] */
+		glUseProgram(shaderDualUp->GetProgram());
+		locHalf = shaderDualUp->GetUniformLocation("halfpixel");
+		glUniform1f(shaderDualUp->GetUniformLocation("composite"), 0.f);
+
+		for (int i=(int)levels-2; i>=0; i--) {
+			const Vec2 &src = dualRes[i+1];
+			const Vec2 &dst = dualRes[i];
+
+			glUniform2f(locHalf, 0.5f / src.x, 0.5f / src.y);
+
+			dualRT[i]->BindFBO();
+			dualRT[i]->Clear();
+			dualRT[i+1]->BindTex();
+
+			glBegin(GL_QUADS);
+				glTexCoord2i(0,0); glVertex2f(0.f, 0.f);
+				glTexCoord2i(1,0); glVertex2f(dst.x, 0.f);
+				glTexCoord2i(1,1); glVertex2f(dst.x, dst.y);
+				glTexCoord2i(0,1); glVertex2f(0.f, dst.y);
+			glEnd();
+
+			dualRT[i]->UnbindFBO();
+		}
+
+		glEnable(GL_BLEND);
+
+		/* The final upsample is rendered by RenderLightTexture */
+		glUniform2f(locHalf, 0.5f / dualRes[0].x, 0.5f / dualRes[0].y);
+		glUniform1f(shaderDualUp->GetUniformLocation("composite"), 1.f);
+	}
+
 	/*
 	=====================
 	LightingSystem::RenderLights
 	=====================
 	*/
 	void LightingSystem::RenderLights() {
+		if (shadowMode == SHADOW_POLAR) {
+			RenderLightsPolar();
+			return;
+		} else if (shadowMode == SHADOW_VISIBILITY) {
+			RenderLightsVisibility();
+			return;
+		}
+
 		Vec2 renres = GameControl::GetSingleton()->GetCreationData().renderResolution;
 		Vec2 coord = GameControl::GetSingleton()->GetCreationData().coordinateSystem;
 		Vec2 lightScale		= renres / resolution;		// The scale of the light texture
@@ -616,6 +1203,317 @@ namespace Pim {
 		glDisable(GL_STENCIL_TEST);
 	}
 
+	/*
+	=====================
+	LightingSystem::RenderLightsPolar
+
+	Builds the polar shadow maps of all shadow casting lights, uploads
+	them as a single texture (one row per light) and renders the lights
+	with the polar shader. The stencil buffer is not used.
+	=====================
+	*/
+	void LightingSystem::RenderLightsPolar() {
+		Vec2 renres = GameControl::GetSingleton()->GetCreationData().renderResolution;
+		Vec2 coord = GameControl::GetSingleton()->GetCreationData().coordinateSystem;
+		Vec2 lightScale		= renres / resolution;		// The scale of the light texture
+		Vec2 posScale		= resolution / coord;		// The position (coord) scale
+		Vec2 lineScale		= coord / renres;			// The shadow line position scale
+
+		/* Build the shadow maps */
+		vector<int> rows(lights.size(), -1);
+		int numRows = 0;
+
+		if (castShadow) {
+			for (auto it=lights.begin(); it!=lights.end(); it++) {
+				if (it->second->castShadows) {
+					numRows++;
+				}
+			}
+		}
+
+		if (numRows) {
+			polarData.assign(numRows * PIM_LS_POLAR_RES, 0.f);
+
+			/* Gather the edges once, each light clips them to it's range */
+			visSegments.clear();
+			polarNormals.clear();
+
+			for (unsigned int i=0; i<casters.size(); i++) {
+				const auto &lines = casters[i]->shadowShape->lines;
+				for (unsigned int j=0; j<lines.size(); j++) {
+					visSegments.push_back(lines[j]->GetP1(lineScale));
+					visSegments.push_back(lines[j]->GetP2(lineScale));
+					polarNormals.push_back(lines[j]->GetNormal(lineScale));
+				}
+			}
+
+			int idx = 0, row = 0;
+			for (auto it=lights.begin(); it!=lights.end(); it++, idx++) {
+				if (castShadow && it->second->castShadows) {
+					float r = it->second->radius;
+					Vec2 p = (it->first->GetLayerPosition() + it->second->position);
+
+					BuildPolarShadowMap(p, lightScale * r, &polarData[row * PIM_LS_POLAR_RES]);
+					rows[idx] = row++;
+				}
+			}
+
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, polarTex);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, PIM_LS_POLAR_RES, numRows, 0,
+						 GL_RED, GL_FLOAT, &polarData[0]);
+			glActiveTexture(GL_TEXTURE0);
+		}
+
+		/* Render the lights */
+		glUseProgram(shaderPolar->GetProgram());
+		GLint locRow = shaderPolar->GetUniformLocation("row");
+
+		glPushMatrix();						// Layer position & scale
+		glScalef(posScale.x, posScale.y, 1.f);
+		glTranslatef(parent->position.x, parent->position.y, 0.f);
+		glScalef(parent->scale.x, parent->scale.y, 1.f);
+
+		int idx = 0;
+		for (auto it=lights.begin(); it!=lights.end(); it++, idx++) {
+			float r = it->second->radius;
+			Vec2 p = (it->first->GetLayerPosition() + it->second->position);
+
+			if (rows[idx] >= 0) {
+				glUniform1f(locRow, ((float)rows[idx] + 0.5f) / (float)numRows);
+			} else {
+				glUniform1f(locRow, -1.f);
+			}
+
+			glBindTexture(GL_TEXTURE_2D, it->second->lTex);
+			glPushMatrix();					// Light texture
+
+			glTranslatef(p.x, p.y, 0.f);
+			glColor4f(1.f, 1.f, 1.f, 0.2f);
+			glScalef(lightScale.x, lightScale.y, 1.f);
+
+			glBegin(GL_QUADS);
+				glTexCoord2i(0,0); glVertex2f(-r,-r);
+				glTexCoord2i(1,0); glVertex2f(r,-r);
+				glTexCoord2i(1,1); glVertex2f(r,r);
+				glTexCoord2i(0,1); glVertex2f(-r,r);
+			glEnd();
+
+			glPopMatrix();					// Light texture
+		}
+
+		glPopMatrix();						// Layer position & scale
+
+		glUseProgram(0);
+
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	/*
+	=====================
+	LightingSystem::RenderLightsVisibility
+
+	Computes the visibility polygons of all shadow casting lights in
+	parallel, and renders each light texture as a triangle fan.
+	=====================
+	*/
+	void LightingSystem::RenderLightsVisibility() {
+		Vec2 renres = GameControl::GetSingleton()->GetCreationData().renderResolution;
+		Vec2 coord = GameControl::GetSingleton()->GetCreationData().coordinateSystem;
+		Vec2 lightScale		= renres / resolution;		// The scale of the light texture
+		Vec2 posScale		= resolution / coord;		// The position (coord) scale
+		Vec2 lineScale		= coord / renres;			// The shadow line position scale
+
+		/* Gather the edges once, the workers only read them */
+		visSegments.clear();
+		VisibilityPolygon::GatherSegments(casters, visSegments, lineScale);
+
+		vector<VisibilityPolygon*> polys;
+		vector<Vec2> origins;
+		vector<Vec2> extents;
+
+		for (auto it=lights.begin(); it!=lights.end(); it++) {
+			if (castShadow && it->second->castShadows) {
+				polys.push_back(&visPolys[it->first]);
+				origins.push_back(it->first->GetLayerPosition() + it->second->position);
+				extents.push_back(lightScale * it->second->radius);
+			} else {
+				visPolys.erase(it->first);
+			}
+		}
+
+		/* Compute the polygons */
+		GameControl::GetJobSystem()->ParallelFor(polys.size(), PIM_LS_VIS_LIGHTS_PER_JOB,
+			[&](unsigned first, unsigned last) {
+				for (unsigned i=first; i<last; i++) {
+					polys[i]->Compute(origins[i], extents[i], visSegments);
+				}
+			}
+		);
+
+		/* Render the lights */
+		glPushMatrix();						// Layer position & scale
+		glScalef(posScale.x, posScale.y, 1.f);
+		glTranslatef(parent->position.x, parent->position.y, 0.f);
+		glScalef(parent->scale.x, parent->scale.y, 1.f);
+
+		for (auto it=lights.begin(); it!=lights.end(); it++) {
+			float r = it->second->radius;
+			Vec2 p = (it->first->GetLayerPosition() + it->second->position);
+
+			glBindTexture(GL_TEXTURE_2D, it->second->lTex);
+			glPushMatrix();					// Light texture
+
+			glTranslatef(p.x, p.y, 0.f);
+			glColor4f(1.f, 1.f, 1.f, 0.2f);
+
+			auto vis = visPolys.find(it->first);
+			if (vis != visPolys.end() && vis->second.vertices.size()) {
+				const vector<Vec2> &verts = vis->second.vertices;
+				const Vec2 &ext = vis->second.extent;
+
+				glBegin(GL_TRIANGLE_FAN);
+					glTexCoord2f(0.5f, 0.5f); 
+					glVertex2f(0.f, 0.f);
+
+					for (unsigned i=0; i<=verts.size(); i++) {
+						const Vec2 &v = verts[i % verts.size()];
+						glTexCoord2f(v.x / ext.x * 0.5f + 0.5f, v.y / ext.y * 0.5f + 0.5f);
+						glVertex2f(v.x, v.y);
+					}
+				glEnd();
+			} else {
+				glScalef(lightScale.x, lightScale.y, 1.f);
+
+				glBegin(GL_QUADS);
+					glTexCoord2i(0,0); glVertex2f(-r,-r);
+					glTexCoord2i(1,0); glVertex2f(r,-r);
+					glTexCoord2i(1,1); glVertex2f(r,r);
+					glTexCoord2i(0,1); glVertex2f(-r,r);
+				glEnd();
+			}
+
+			glPopMatrix();					// Light texture
+		}
+
+		glPopMatrix();						// Layer position & scale
+	}
+
+	/*
+	=====================
+	LightingSystem::BuildPolarShadowMap
+
+	Rasterizes the edges facing the light into 'row', which holds the
+	distance to the closest edge for PIM_LS_POLAR_RES angles in [-pi,pi].
+	The edges are transformed so that the light quad spans [-1,1] in both 
+	directions, making the distances directly comparable in the shader.
+
+	The edges gathered by RenderLightsPolar() are first clipped to the
+	circle through the corners of the quad, so the rasterizer only walks
+	the bins of the edges, or parts of edges, which can shade the light.
+	=====================
+	*/
+	void LightingSystem::BuildPolarShadowMap(const Vec2 &pos, const Vec2 &extent, GLfloat *row) {
+		// PARAMETERS:
+		//	pos:		The position of the light relative to it's parent
+		//	extent:		Half the size of the light quad
+		//	row:		PIM_LS_POLAR_RES floats to be filled
+
+		const float twoPi	= 6.2831853f;
+		const float binSize = twoPi / PIM_LS_POLAR_RES;
+		const float clipSq	= 1.42f * 1.42f;
+
+		// Anything beyond the corners of the quad is irrelevant
+		for (int i=0; i<PIM_LS_POLAR_RES; i++) {
+			row[i] = 2.f;
+		}
+
+		/* Clip the facing edges */
+		polarEdges.clear();
+
+		for (unsigned int i=0; i<polarNormals.size(); i++) {
+			const Vec2 &p1 = visSegments[i*2];
+			const Vec2 &p2 = visSegments[i*2+1];
+
+			if (polarNormals[i].Dot(pos - (p1 + p2) / 2.f) < 0.f) {
+				continue;
+			}
+
+			Vec2 n1 = p1 - pos;
+			Vec2 n2 = p2 - pos;
+			n1 = Vec2(n1.x / extent.x, n1.y / extent.y);
+			n2 = Vec2(n2.x / extent.x, n2.y / extent.y);
+
+			Vec2 e = n2 - n1;
+			float elen = e.Dot(e);
+			if (elen <= 0.f) {
+				continue;
+			}
+
+			// The part of the edge inside the circle, if any
+			float b = n1.Dot(e);
+			float disc = b*b - elen * (n1.Dot(n1) - clipSq);
+			if (disc < 0.f) {
+				continue;
+			}
+
+			float root = sqrtf(disc);
+			float s1 = max((-b - root) / elen, 0.f);
+			float s2 = min((-b + root) / elen, 1.f);
+			if (s1 >= s2) {
+				continue;
+			}
+
+			PolarEdge edge = { n1, e, s1, s2 };
+			polarEdges.push_back(edge);
+		}
+
+		/* Rasterize the clipped edges */
+		for (unsigned int i=0; i<polarEdges.size(); i++) {
+			const Vec2 &n1 = polarEdges[i].n1;
+			const Vec2 &e = polarEdges[i].e;
+
+			// Only the bins of the part in range are walked, but the
+			// hits are tested against the whole edge
+			Vec2 c1 = n1 + e * polarEdges[i].s1;
+			Vec2 c2 = n1 + e * polarEdges[i].s2;
+
+			float a1 = atan2f(c1.y, c1.x);
+			float a2 = atan2f(c2.y, c2.x);
+			float delta = a2 - a1;
+			if (delta > M_PI)	delta -= twoPi;
+			if (delta < -M_PI)	delta += twoPi;
+
+			if (delta < 0.f) {
+				a1 += delta;
+				delta = -delta;
+			}
+
+			// Walk the bins covered by the edge
+			int first = (int)floorf((a1 / twoPi + 0.5f) * PIM_LS_POLAR_RES);
+			int count = (int)ceilf(delta / binSize) + 1;
+
+			for (int k=0; k<=count; k++) {
+				int bin = ((first + k) % PIM_LS_POLAR_RES + PIM_LS_POLAR_RES) % PIM_LS_POLAR_RES;
+				float angle = (((float)bin + 0.5f) / PIM_LS_POLAR_RES - 0.5f) * twoPi;
+				Vec2 u(cosf(angle), sinf(angle));
+
+				float denom = u.Cross(e);
+				if (fabsf(denom) < 1e-6f) {
+					continue;
+				}
+
+				float t = n1.Cross(e) / denom;
+				float t2 = n1.Cross(u) / denom;
+				if (t > 0.f && t2 >= -0.01f && t2 <= 1.01f && t < row[bin]) {
+					row[bin] = t;
+				}
+			}
+		}
+	}
+
 	/*
 	=====================
 	LightingSystem::RenderShadows
@@ -623,6 +1521,8 @@ namespace Pim {
 	*/
 	void LightingSystem::RenderShadows(LightDef *ld, GameNode *light, 
 										const Vec2 &pos, const Vec2 &sc) {
+		PIM_TRACE_ZONE("LightingSystem::RenderShadows");
+
 		// PARAMETERS:
 		//	ld:			The light definition struct
 		//	light:		The game node, acting as a light
@@ -654,7 +1554,7 @@ namespace Pim {
 		#endif /* _DEBUG */
 
 		for (unsigned int i=0; i<casters.size(); i++) {
-			auto lines = casters[i]->shadowShape->lines;
+			const auto &lines = casters[i]->shadowShape->lines;
 			for (unsigned int i=0; i<lines.size(); i++) {
 				/* TODO: Use AABB instead of length */
 				if ((pos-lines[i]->GetMid(sc)).Length() <= r ||
@@ -0,0 +1,107 @@
+#include "PimInternal.h"
+
+#include "PimListenerList.h"
+#include "PimGameNode.h"
+
+namespace Pim {
+	/*
+	=====================
+	ListenerList::ListenerList
+	=====================
+	*/
+	ListenerList::ListenerList(ListenerType t) {
+		type		= t;
+		tombstones	= 0;
+	}
+
+	/*
+	=====================
+	ListenerList::Add
+	=====================
+	*/
+	void ListenerList::Add(GameNode *node) {
+		if (node->listenSlot[type] >= 0) {
+			return;
+		}
+
+		node->listenSlot[type] = (int)nodes.size();
+		nodes.push_back(node);
+	}
+
+	/*
+	=====================
+	ListenerList::Remove
+	=====================
+	*/
+	void ListenerList::Remove(GameNode *node) {
+		int slot = node->listenSlot[type];
+
+		if (slot < 0 || slot >= (int)nodes.size() || nodes[slot] != node) {
+			return;
+		}
+
+		nodes[slot] = NULL;
+		node->listenSlot[type] = -1;
+		tombstones++;
+	}
+
+	/*
+	=====================
+	ListenerList::Contains
+	=====================
+	*/
+	bool ListenerList::Contains(const GameNode *node) const {
+		return node->listenSlot[type] >= 0;
+	}
+
+	/*
+	=====================
+	ListenerList::Compact
+
+	Removes the tombstones while preserving the order of the nodes.
+	=====================
+	*/
+	void ListenerList::Compact() {
+		if (!tombstones) {
+			return;
+		}
+
+		unsigned dst = 0;
+		for (unsigned i=0; i<nodes.size(); i++) {
+			if (nodes[i]) {
+				nodes[i]->listenSlot[type] = (int)dst;
+				nodes[dst++] = nodes[i];
+			}
+		}
+
+		nodes.resize(dst);
+		tombstones = 0;
+	}
+
+	/*
+	=====================
+	ListenerList::Size
+	=====================
+	*/
+	unsigned ListenerList::Size() const {
+		return nodes.size();
+	}
+
+	/*
+	=====================
+	ListenerList::Count
+	=====================
+	*/
+	unsigned ListenerList::Count() const {
+		return nodes.size() - tombstones;
+	}
+
+	/*
+	=====================
+	ListenerList::operator[]
+	=====================
+	*/
+	GameNode* ListenerList::operator[](unsigned idx) const {
+		return nodes[idx];
+	}
+}
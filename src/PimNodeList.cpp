@@ -0,0 +1,75 @@
+#include "PimInternal.h"
+
+#include "PimNodeList.h"
+
+namespace Pim {
+	/*
+	=====================
+	NodeList::NodeList
+	=====================
+	*/
+	NodeList::NodeList() {
+		count		= 0;
+		capacity	= PIM_NODELIST_INLINE;
+	}
+
+	/*
+	=====================
+	NodeList::~NodeList
+	=====================
+	*/
+	NodeList::~NodeList() {
+		if (capacity > PIM_NODELIST_INLINE) {
+			delete[] heap;
+		}
+	}
+
+	/*
+	=====================
+	NodeList::push_back
+	=====================
+	*/
+	void NodeList::push_back(GameNode *node) {
+		if (count == capacity) {
+			GameNode **grown = new GameNode*[capacity * 2];
+
+			GameNode **data = Data();
+			for (unsigned i=0; i<count; i++) {
+				grown[i] = data[i];
+			}
+
+			if (capacity > PIM_NODELIST_INLINE) {
+				delete[] heap;
+			}
+
+			heap = grown;
+			capacity *= 2;
+		}
+
+		Data()[count++] = node;
+	}
+
+	/*
+	=====================
+	NodeList::erase
+	=====================
+	*/
+	void NodeList::erase(GameNode **pos) {
+		GameNode **data = Data();
+
+		for (GameNode **it=pos; it+1<data+count; it++) {
+			*it = *(it+1);
+		}
+
+		count--;
+	}
+
+	/*
+	=====================
+	NodeList::clear
+	=====================
+	*/
+	void NodeList::clear() {
+		count = 0;
+	}
+}
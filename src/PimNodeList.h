@@ -0,0 +1,58 @@
+#pragma once
+
+#include "PimInternal.h"
+
+namespace Pim {
+	/**
+	 @class 		NodeList
+	 @brief 		The list of children of a GameNode.
+	 @details 		Behaves like a vector<GameNode*>, but stores up to
+	 				PIM_NODELIST_INLINE children within the object itself. Most
+	 				nodes have few or no children, and they never allocate
+	 				memory for them. When the list outgrows the inline storage,
+	 				it moves to the heap.
+
+	 				The inline storage shares memory with the heap pointer, so a
+	 				NodeList is only one pointer larger than a vector.
+	 */
+
+	#define PIM_NODELIST_INLINE			3
+
+	class GameNode;
+
+	class NodeList {
+	public:
+								NodeList();
+								~NodeList();
+		unsigned int			size() const						{ return count; }
+		bool					empty() const						{ return count == 0; }
+		GameNode*&				operator[](unsigned int idx)		{ return Data()[idx]; }
+		GameNode*				operator[](unsigned int idx) const	{ return Data()[idx]; }
+		GameNode**				begin()								{ return Data(); }
+		GameNode**				end()								{ return Data() + count; }
+		GameNode* const*		begin() const						{ return Data(); }
+		GameNode* const*		end() const							{ return Data() + count; }
+		void					push_back(GameNode *node);
+		void					erase(GameNode **pos);
+		void					clear();
+
+	private:
+		unsigned int			count;
+		unsigned int			capacity;
+		union {
+			GameNode			*local[PIM_NODELIST_INLINE];
+			GameNode			**heap;
+		};
+
+								NodeList(const NodeList&);
+		NodeList&				operator=(const NodeList&);
+
+		GameNode**				Data()			{ return (capacity > PIM_NODELIST_INLINE) ? heap : local; }
+		GameNode* const*		Data() const	{ return (capacity > PIM_NODELIST_INLINE) ? heap : local; }
+	};
+
+	/**
+	 @fn 			NodeList::clear
+	 @brief 		Removes all nodes. Heap storage is kept for reuse.
+	 */
+}
@@ -0,0 +1,144 @@
+#include "PimInternal.h"
+
+#include "PimNodePool.h"
+#include "PimCommandBuffer.h"
+#include "PimAssert.h"
+
+#include <new>
+
+namespace Pim {
+	NodePool::SizeClass NodePool::classes[PIM_POOL_MAX_BLOCK / PIM_POOL_GRANULARITY];
+	unsigned int NodePool::heapAllocs = 0;
+
+	/*
+	=====================
+	NodePool::Allocate
+	=====================
+	*/
+	void* NodePool::Allocate(size_t size) {
+		PimAssert(!CommandBuffer::GetRecording(),
+				  "Error: Node allocated during a parallel update");
+
+		if (!size) {
+			size = 1;
+		}
+
+		if (size > PIM_POOL_MAX_BLOCK) {
+			heapAllocs++;
+			return ::operator new(size);
+		}
+
+		unsigned idx = unsigned((size - 1) / PIM_POOL_GRANULARITY);
+		SizeClass &sc = classes[idx];
+
+		if (!sc.freeList) {
+			Grow(sc, (idx + 1) * PIM_POOL_GRANULARITY);
+		}
+
+		Block *block = sc.freeList;
+		sc.freeList = block->next;
+		sc.live++;
+
+		return block;
+	}
+
+	/*
+	=====================
+	NodePool::Free
+	=====================
+	*/
+	void NodePool::Free(void *ptr, size_t size) {
+		PimAssert(!CommandBuffer::GetRecording(),
+				  "Error: Node deleted during a parallel update");
+
+		if (!ptr) {
+			return;
+		}
+
+		if (!size) {
+			size = 1;
+		}
+
+		if (size > PIM_POOL_MAX_BLOCK) {
+			::operator delete(ptr);
+			return;
+		}
+
+		SizeClass &sc = classes[(size - 1) / PIM_POOL_GRANULARITY];
+
+		Block *block = (Block*)ptr;
+		block->next = sc.freeList;
+		sc.freeList = block;
+		sc.live--;
+	}
+
+	/*
+	=====================
+	NodePool::Purge
+	=====================
+	*/
+	void NodePool::Purge() {
+		for (unsigned i=0; i<PIM_POOL_MAX_BLOCK/PIM_POOL_GRANULARITY; i++) {
+			SizeClass &sc = classes[i];
+
+			if (sc.live) {
+				continue;
+			}
+
+			for (unsigned j=0; j<sc.chunks.size(); j++) {
+				free(sc.chunks[j]);
+			}
+
+			sc.chunks.clear();
+			sc.freeList = NULL;
+		}
+	}
+
+	/*
+	=====================
+	NodePool::GetLiveCount
+	=====================
+	*/
+	unsigned int NodePool::GetLiveCount() {
+		unsigned int count = 0;
+
+		for (unsigned i=0; i<PIM_POOL_MAX_BLOCK/PIM_POOL_GRANULARITY; i++) {
+			count += classes[i].live;
+		}
+
+		return count;
+	}
+
+	/*
+	=====================
+	NodePool::GetHeapAllocationCount
+	=====================
+	*/
+	unsigned int NodePool::GetHeapAllocationCount() {
+		return heapAllocs;
+	}
+
+	/*
+	=====================
+	NodePool::Grow
+
+	Allocates a new chunk, and links all of it's blocks
+	into the free list.
+	=====================
+	*/
+	void NodePool::Grow(SizeClass &sc, size_t blockSize) {
+		char *chunk = (char*)malloc(blockSize * PIM_POOL_CHUNK_BLOCKS);
+		if (!chunk) {
+			throw bad_alloc();
+		}
+
+		sc.chunks.push_back(chunk);
+		heapAllocs++;
+
+		for (int i=PIM_POOL_CHUNK_BLOCKS-1; i>=0; i--) {
+			Block *block = (Block*)(chunk + i * blockSize);
+			block->next = sc.freeList;
+			sc.freeList = block;
+		}
+	}
+}
@@ -11,10 +11,17 @@ namespace Pim {
 	==================
 	*/
 	NormalMap::NormalMap(string spriteFile, string normalFile) : Sprite(spriteFile) {
+		kind |= NODE_KIND;
+
 		LoadSprite(normalFile);
 	
 		normalTex = texID;
 		texID = 0;
+
+		lightSys	= NULL;
+		locDims		= -1;
+		locWpos		= -1;
+		locAnchor	= -1;
 	
 		LoadSprite(spriteFile);
 	}
@@ -39,7 +46,12 @@ namespace Pim {
 				);
 			}
 
-			SetShader(layer->GetLightingSystem()->GetNormalMapShader());
+			lightSys = layer->GetLightingSystem();
+			SetShader(lightSys->GetNormalMapShader());
+
+			locDims		= shader->GetUniformLocation("dims");
+			locWpos		= shader->GetUniformLocation("wpos");
+			locAnchor	= shader->GetUniformLocation("anchor");
 		}
 	}
 
@@ -49,7 +61,9 @@ namespace Pim {
 	==================
 	*/
 	void NormalMap::Draw() {
-		UpdateShaderUniforms();
+		if (lightSys) {
+			lightSys->BindNormalLightTiles();
+		}
 
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, normalTex);
@@ -61,19 +75,15 @@ namespace Pim {
 	/*
 	==================
 	NormalMap::UpdateShaderUniforms
+
+	Called by Sprite::Draw() while the shader is bound.
 	==================
 	*/
 	void NormalMap::UpdateShaderUniforms() {
-		if (shader) {
-			Vec2 lpos = GetLayerPosition();
-
-			glUseProgram(shader->GetProgram());
-		
-			glUniform2f(shader->GetUniformLocation("dims"), rect.width*scale.x, rect.height*scale.y);
-			glUniform2f(shader->GetUniformLocation("wpos"), lpos.x, lpos.y);
-			glUniform2f(shader->GetUniformLocation("anchor"), anchor.x, anchor.y);
+		Vec2 lpos = GetLayerPosition();
 
-			glUseProgram(0);
-		}
+		glUniform2f(locDims, rect.width*scale.x, rect.height*scale.y);
+		glUniform2f(locWpos, lpos.x, lpos.y);
+		glUniform2f(locAnchor, anchor.x, anchor.y);
 	}
 }
\ No newline at end of file
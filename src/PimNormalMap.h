@@ -22,6 +22,8 @@ namespace Pim {
 
 	class NormalMap : public Sprite {
 	public:
+		enum { NODE_KIND = KIND_NORMAL_MAP };
+
 						NormalMap(string spriteFile, string normalFile);
 		
 	protected:
@@ -31,5 +33,9 @@ namespace Pim {
 
 	private:
 		GLuint 			normalTex;
+		LightingSystem	*lightSys;
+		GLint			locDims;		// Uniform locations in the shader
+		GLint			locWpos;
+		GLint			locAnchor;
 	};
 }
\ No newline at end of file
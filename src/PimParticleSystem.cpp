@@ -2,6 +2,13 @@
 #include "PimGameControl.h"
 #include "PimVec2.h"
 #include "PimHelperFunctions.h"
+#include "PimJobSystem.h"
+
+// Systems with fewer living particles are updated on the calling thread
+#define PIM_PARTICLE_PARALLEL_MIN		512
+
+// Number of particles per update job
+#define PIM_PARTICLE_PER_JOB			256
 
 namespace Pim {
 
@@ -55,6 +62,8 @@ namespace Pim {
 	*/
 	ParticleSystem::ParticleSystem(string texturePath)
 	: Sprite(texturePath) {
+		kind |= NODE_KIND;
+
 		ListenFrame();
 		
 		positionType 			= PART_RELATIVE;
@@ -84,6 +93,8 @@ namespace Pim {
 	==================
 	*/
 	ParticleSystem::ParticleSystem() {
+		kind |= NODE_KIND;
+
 		ListenFrame();
 		
 		positionType 			= PART_RELATIVE;
@@ -160,6 +171,7 @@ namespace Pim {
 		}
 		
 		CreateVertexData();
+		MarkMoved();
 	}
 
 	/*
@@ -206,14 +218,63 @@ namespace Pim {
 			glPopMatrix();
 		}
 		
-		OrderChildren();
-		for (unsigned int i=0; i<children.size(); i++) {
-			children[i]->Draw();
-		}
+		DrawChildren();
 
 		glPopMatrix();
 	}
 
+	/*
+	==================
+	ParticleSystem::ApplyChildTransform
+
+	The scale of the particles is never cascaded.
+	==================
+	*/
+	void ParticleSystem::ApplyChildTransform() {
+		GameNode::ApplyChildTransform();
+	}
+
+	/*
+	==================
+	ParticleSystem::GetChildTransform
+	==================
+	*/
+	void ParticleSystem::GetChildTransform(Transform2D &t) const {
+		GameNode::GetChildTransform(t);
+	}
+
+	/*
+	==================
+	ParticleSystem::GetContentBounds
+
+	Absolute particles are drawn in screen space, and are never culled.
+	==================
+	*/
+	bool ParticleSystem::GetContentBounds(const Transform2D &parent, AABB &bounds) const {
+		bounds = AABB();
+
+		if (particles.empty()) {
+			return true;
+		}
+
+		if (positionType == PART_ABSOLUTE) {
+			return false;
+		}
+
+		AABB local;
+		for (unsigned i=0; i<vertices.size(); i++) {
+			local.Extend(vertices[i].position);
+		}
+
+		Vec2 fac = GameControl::GetSingleton()->GetWindowScale();
+
+		Transform2D t = GetNodeTransform(parent);
+		t.Scale(scale.x * fac.x, scale.y * fac.y);
+
+		bounds = t.Apply(local);
+		return true;
+	}
+
 	/*
 	==================
 	ParticleSystem::BatchDraw
@@ -243,21 +304,42 @@ namespace Pim {
 		}
 
 		UpdateAllParticles(0.f);
+		MarkMoved();
 	}
 
 	/*
 	==================
 	ParticleSystem::UpdateAllParticles
+
+	Dead particles are removed in a single pass, keeping the order of
+	the living ones. Large systems are then updated in parallel.
 	==================
 	*/
 	void ParticleSystem::UpdateAllParticles(float dt) {
+		/* Erase 'dead' particles */
+		unsigned alive = 0;
 		for (unsigned i=0; i<particles.size(); i++) {
 			if (particles[i]->age >= particles[i]->lifetime) {
-				/* Erase 'dead' particles */
 				delete particles[i];
-				particles.erase(particles.begin() + i--);
 			} else {
-				/* Update 'living' particles */
+				particles[alive++] = particles[i];
+			}
+		}
+		particles.resize(alive);
+
+		/* Update 'living' particles */
+		JobSystem *jobs = GameControl::GetJobSystem();
+
+		if (jobs && particles.size() >= PIM_PARTICLE_PARALLEL_MIN) {
+			jobs->ParallelFor(particles.size(), PIM_PARTICLE_PER_JOB,
+				[&](unsigned first, unsigned last) {
+					for (unsigned i=first; i<last; i++) {
+						UpdateParticle(particles[i], dt);
+					}
+				}
+			);
+		} else {
+			for (unsigned i=0; i<particles.size(); i++) {
 				UpdateParticle(particles[i], dt);
 			}
 		}
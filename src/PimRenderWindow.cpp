@@ -5,6 +5,7 @@
 #include "PimAssert.h"
 #include "PimLayer.h"
 #include "PimScene.h"
+#include "PimTrace.h"
 
 #include <stdlib.h>
 
@@ -18,6 +19,8 @@ namespace Pim {
 	RenderWindow::RenderWindow() {
 		window = NULL;
 		sdlWindow = true;
+		swapInterval = 0;
+		swapWait = 0.f;
 	}
 
 	/*
@@ -84,6 +87,48 @@ namespace Pim {
 		}
 	}
 
+	/*
+	=====================
+	RenderWindow::SetSwapInterval
+	=====================
+	*/
+	bool RenderWindow::SetSwapInterval(int interval) {
+		if (SDL_GL_SetSwapInterval(interval) == 0) {
+			swapInterval = interval;
+			return true;
+		}
+
+		// Adaptive vsync is not supported everywhere
+		if (interval == -1 && SDL_GL_SetSwapInterval(1) == 0) {
+			swapInterval = 1;
+			return true;
+		}
+
+#		ifdef _DEBUG
+			printf("Failed to set swap interval %i: %s\n", interval, SDL_GetError());
+#		endif /* _DEBUG */
+
+		return false;
+	}
+
+	/*
+	=====================
+	RenderWindow::GetSwapInterval
+	=====================
+	*/
+	int RenderWindow::GetSwapInterval() const {
+		return swapInterval;
+	}
+
+	/*
+	=====================
+	RenderWindow::GetSwapWait
+	=====================
+	*/
+	float RenderWindow::GetSwapWait() const {
+		return swapWait;
+	}
+
 	/*
 	=====================
 	RenderWindow::SetupWindow
@@ -303,6 +348,8 @@ namespace Pim {
 	=====================
 	*/
 	void RenderWindow::RenderFrame() {
+		PIM_TRACE_ZONE("RenderWindow::RenderFrame");
+
 #		ifdef _DEBUG
 			PrintOpenGLErrors("PRERENDER FRAME (Should never occur)");
 #		endif /* _DEBUG */
@@ -366,14 +413,22 @@ namespace Pim {
 			glEnable(GL_TEXTURE_2D);
 		}
 
-		if (sdlWindow) {
-			SDL_GL_SwapWindow(window);
-		} else {
+		Tick swapStart = GameControl::GetTime();
+
+		{
+			PIM_TRACE_ZONE("RenderWindow::Swap");
+
+			if (sdlWindow) {
+				SDL_GL_SwapWindow(window);
+			} else {
 #ifdef WIN32
-			//SwapBuffers(winData.devCtx);
-			wglSwapLayerBuffers(winData.devCtx, WGL_SWAP_MAIN_PLANE);
+				//SwapBuffers(winData.devCtx);
+				wglSwapLayerBuffers(winData.devCtx, WGL_SWAP_MAIN_PLANE);
 #endif
+			}
 		}
+
+		swapWait = float(GameControl::GetTime() - swapStart);
 		
 		#ifdef _DEBUG
 		PrintOpenGLErrors("POSTRENDER FRAME");
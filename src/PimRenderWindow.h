@@ -37,6 +37,9 @@ namespace Pim {
 		Vec2						GetOrtho() const;
 		Vec2						GetOrthoOffset() const;
 		void						PrintOpenGLErrors(string identifier) const;
+		bool						SetSwapInterval(int interval);
+		int							GetSwapInterval() const;
+		float						GetSwapWait() const;
 
 	protected:
 		enum BORDERPOS {
@@ -53,6 +56,8 @@ namespace Pim {
 		BORDERPOS					bpos;		// Border position
 		int							bdim;		// Border dimensions
 		bool						sdlWindow;	// Was an SDL window created?
+		int							swapInterval;
+		float						swapWait;	// Seconds spent in the last buffer swap
 
 		virtual bool				SetupWindow(WinStyle::CreationData &data);
 		virtual void				KillWindow();
@@ -62,4 +67,21 @@ namespace Pim {
 		void						SetCreationData(WinStyle::CreationData &data);
 		void						RenderFrame(); 
 	};
+
+	/**
+	 @fn 			RenderWindow::SetSwapInterval
+	 @brief 		Set the buffer swap interval.
+	 @details 		0 swaps immediately, 1 waits for the vertical retrace (vsync),
+	 				and -1 enables adaptive vsync: late frames are swapped 
+	 				immediately instead of waiting for the next retrace. If 
+	 				adaptive vsync is unsupported, regular vsync is used. 
+	 				
+	 				Returns false if the interval could not be set.
+	 */
+
+	/**
+	 @fn 			RenderWindow::GetSwapWait
+	 @brief 		The time (in seconds) the last buffer swap blocked. With
+	 				vsync, this is roughly the idle time of the frame.
+	 */
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "PimLayer.h"
 #include "PimGameControl.h"
 #include "PimRenderWindow.h"
+#include "PimGameNode.h"
+#include "PimTrace.h"
 
 namespace Pim {
 	/*
@@ -19,6 +21,13 @@ namespace Pim {
 	=====================
 	*/
 	Scene::~Scene() {
+		// The index is going away - skip erasing the entries one by one
+		nodeIndex.clear();
+
+		for (unsigned i=0; i<layers.size(); i++) {
+			UnindexSubtree(layers[i]);
+		}
+
 		for (unsigned i=0; i<layers.size(); i++) {
 			GameControl::GetSingleton()->AddNodeToDelete(layers[i]);
 		}
@@ -32,6 +41,7 @@ namespace Pim {
 	void Scene::AddLayer(Layer *l) {
 		layers.push_back(l);
 		l->parentScene = this;
+		IndexSubtree(l);
 		l->LoadResources();
 
 		dirtyZOrder = true;
@@ -46,6 +56,7 @@ namespace Pim {
 		for (unsigned int i=0; i<layers.size(); i++) {
 			if (layers[i] == l) {
 				layers.erase(layers.begin() + i);
+				UnindexSubtree(l);
 				delete l;
 			}
 		}
@@ -82,9 +93,12 @@ namespace Pim {
 	=====================
 	*/
 	void Scene::DrawScene() {
+		PIM_TRACE_ZONE("Scene::DrawScene");
+
 		OrderLayers();
 
 		for (unsigned int i=0; i<layers.size(); i++) {
+			layers[i]->drawn = true;
 			layers[i]->Draw();
 		}
 	}
@@ -124,4 +138,116 @@ namespace Pim {
 			layers[i]->ReloadTextures();
 		}
 	}
-}
\ No newline at end of file
+
+	/*
+	=====================
+	Scene::FindNode
+	=====================
+	*/
+	GameNode* Scene::FindNode(const Identifier &id) const {
+		NodeIndex::const_iterator it = nodeIndex.find(id.GetID());
+
+		if (it != nodeIndex.end()) {
+			return it->second;
+		}
+
+		return NULL;
+	}
+
+	/*
+	=====================
+	Scene::FindNode
+	=====================
+	*/
+	GameNode* Scene::FindNode(const string &id) const {
+		return FindNode(Identifier::Find(id));
+	}
+
+	/*
+	=====================
+	Scene::FindNodes
+	=====================
+	*/
+	void Scene::FindNodes(const Identifier &id, vector<GameNode*> &nodes) const {
+		auto range = nodeIndex.equal_range(id.GetID());
+
+		for (NodeIndex::const_iterator it=range.first; it!=range.second; it++) {
+			nodes.push_back(it->second);
+		}
+	}
+
+	/*
+	=====================
+	Scene::FindNodes
+	=====================
+	*/
+	void Scene::FindNodes(const string &id, vector<GameNode*> &nodes) const {
+		FindNodes(Identifier::Find(id), nodes);
+	}
+
+	/*
+	=====================
+	Scene::IndexNode
+	=====================
+	*/
+	void Scene::IndexNode(GameNode *node) {
+		if (!node->identifier.IsEmpty()) {
+			nodeIndex.insert(make_pair(node->identifier.GetID(), node));
+		}
+	}
+
+	/*
+	=====================
+	Scene::UnindexNode
+	=====================
+	*/
+	void Scene::UnindexNode(GameNode *node) {
+		auto range = nodeIndex.equal_range(node->identifier.GetID());
+
+		for (NodeIndex::iterator it=range.first; it!=range.second; it++) {
+			if (it->second == node) {
+				nodeIndex.erase(it);
+				return;
+			}
+		}
+	}
+
+	/*
+	=====================
+	Scene::IndexSubtree
+	=====================
+	*/
+	void Scene::IndexSubtree(GameNode *node) {
+		if (node->indexed) {
+			return;
+		}
+
+		IndexNode(node);
+		node->indexed = true;
+
+		for (unsigned i=0; i<node->children.size(); i++) {
+			IndexSubtree(node->children[i]);
+		}
+	}
+
+	/*
+	=====================
+	Scene::UnindexSubtree
+
+	The children of an unindexed node are never indexed, so
+	the recursion ends at the first unindexed node.
+	=====================
+	*/
+	void Scene::UnindexSubtree(GameNode *node) {
+		if (!node->indexed) {
+			return;
+		}
+
+		UnindexNode(node);
+		node->indexed = false;
+
+		for (unsigned i=0; i<node->children.size(); i++) {
+			UnindexSubtree(node->children[i]);
+		}
+	}
+}
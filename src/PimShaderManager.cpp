@@ -2,6 +2,7 @@
 
 #include "PimShaderManager.h"
 #include "PimAssert.h"
+#include "PimTrace.h"
 
 namespace Pim {
 	/*
@@ -286,6 +287,8 @@ namespace Pim {
 	=====================
 	*/
 	Shader* ShaderManager::AddShader(string fragString, string vertString, string nm) {
+		PIM_TRACE_ZONE("ShaderManager::AddShader");
+
 		printf("\nCreating shader %s...\n", nm.c_str());
 
 		Shader *shader = new Shader;
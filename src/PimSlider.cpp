@@ -15,6 +15,8 @@ namespace Pim {
 					Sprite *background,		Sprite *handleNormal,
 					Sprite *handleHovered,	Sprite *handlePressed,
 					Sprite *handleDeactivated) {
+		kind |= NODE_KIND;
+
 		handle = new Pim::Button(
 			handleNormal, handleHovered,
 			handlePressed, handleDeactivated
@@ -75,6 +77,7 @@ namespace Pim {
 		}
 
 		handle->position = minPt + (maxPt-minPt)*fac;
+		handle->MarkMoved();
 
 		if (callback) {
 			callback->SliderValueChanged(this,GetValue());
@@ -127,6 +130,7 @@ namespace Pim {
 			}
 
 			handle->position = handlePos;
+			handle->MarkMoved();
 
 			if (callback) {
 				callback->SliderValueChanged(this,GetValue());
@@ -30,6 +30,8 @@ namespace Pim {
 	 */
 	class Slider : public Pim::GameNode, public Pim::ButtonCallback {
 	public:
+		enum { NODE_KIND = KIND_SLIDER };
+
 								Slider(Vec2 pointZero,			Vec2 pointMax,
 									   Sprite *background,		Sprite *handleNormal,
 									   Sprite *handleHovered,	Sprite *handlePressed,
@@ -2,6 +2,7 @@
 #include "PimAudioManager.h"
 #include "PimVec2.h"
 #include "PimAssert.h"
+#include "PimTrace.h"
 
 namespace Pim {
 
@@ -393,6 +394,8 @@ namespace Pim {
 	==================
 	*/
 	bool Sound::FillBuffer(ALuint buffer) {
+		PIM_TRACE_ZONE("Sound::FillBuffer");
+
 		char	data[BUFFER_SIZE];
 		int		size	= 0;
 		int		section = 0;
@@ -0,0 +1,590 @@
+#include "PimInternal.h"
+
+#include "PimSpatialIndex.h"
+#include "PimGameNode.h"
+#include "PimCommandBuffer.h"
+#include "PimAssert.h"
+
+#include <algorithm>
+#include <float.h>
+
+namespace Pim {
+	vector<SpatialIndex*> SpatialIndex::instances;
+
+	/*
+	=====================
+	HitLess
+
+	Orders hits by distance. Used as a max-heap by QueryNearest.
+	=====================
+	*/
+	static bool HitLess(const SpatialIndex::Hit &a, const SpatialIndex::Hit &b) {
+		return a.distance < b.distance;
+	}
+
+	/*
+	=====================
+	SegmentHitsBox
+
+	Slab test of the segment from + t*delta, t in [0,1]. Returns the
+	first t inside the box.
+	=====================
+	*/
+	static bool SegmentHitsBox(const Vec2 &from, const Vec2 &delta, const AABB &box, float &t) {
+		float tmin = 0.f;
+		float tmax = 1.f;
+
+		const float org[2]	= { from.x, from.y };
+		const float dir[2]	= { delta.x, delta.y };
+		const float lo[2]	= { box.lower.x, box.lower.y };
+		const float hi[2]	= { box.upper.x, box.upper.y };
+
+		for (int i=0; i<2; i++) {
+			if (dir[i] == 0.f) {
+				if (org[i] < lo[i] || org[i] > hi[i]) {
+					return false;
+				}
+				continue;
+			}
+
+			float t0 = (lo[i] - org[i]) / dir[i];
+			float t1 = (hi[i] - org[i]) / dir[i];
+			if (t0 > t1) {
+				std::swap(t0, t1);
+			}
+
+			if (t0 > tmin) tmin = t0;
+			if (t1 < tmax) tmax = t1;
+
+			if (tmin > tmax) {
+				return false;
+			}
+		}
+
+		t = tmin;
+		return true;
+	}
+
+	/*
+	=====================
+	SpatialIndex::SpatialIndex
+	=====================
+	*/
+	SpatialIndex::SpatialIndex(const AABB &a, float size, Space s) {
+		PimAssert(!a.IsEmpty() && size > 0.f, "Error: Invalid spatial index area or cell size");
+
+		area		= a;
+		cellSize	= size;
+		space		= s;
+		cols		= (int)ceilf(area.GetSize().x / cellSize);
+		rows		= (int)ceilf(area.GetSize().y / cellSize);
+		freeEntry	= -1;
+		margin		= 0.f;
+		count		= 0;
+
+		if (cols < 1) cols = 1;
+		if (rows < 1) rows = 1;
+
+		// The overflow list is kept after the grid cells
+		overflow = cols * rows;
+		cells.resize(cols * rows + 1, -1);
+		instances.push_back(this);
+	}
+
+	/*
+	=====================
+	SpatialIndex::~SpatialIndex
+	=====================
+	*/
+	SpatialIndex::~SpatialIndex() {
+		instances.erase(std::find(instances.begin(), instances.end(), this));
+	}
+
+	/*
+	=====================
+	SpatialIndex::Insert
+	=====================
+	*/
+	void SpatialIndex::Insert(GameNode *node) {
+		PimAssert(!CommandBuffer::GetRecording(),
+				  "Error: SpatialIndex modified during a parallel update");
+
+		if (Contains(node)) {
+			Update(node);
+			return;
+		}
+
+		int idx;
+		if (freeEntry >= 0) {
+			idx = freeEntry;
+			freeEntry = entries[idx].next;
+		} else {
+			idx = (int)entries.size();
+			entries.push_back(Entry());
+		}
+
+		Entry &e = entries[idx];
+		e.node	= node;
+		e.cell	= -1;
+		e.prev	= -1;
+		e.next	= -1;
+
+		lookup[node] = idx;
+		node->spatial = true;
+		count++;
+
+		Place(idx, ComputeBounds(node));
+	}
+
+	/*
+	=====================
+	SpatialIndex::Remove
+	=====================
+	*/
+	void SpatialIndex::Remove(GameNode *node) {
+		PimAssert(!CommandBuffer::GetRecording(),
+				  "Error: SpatialIndex modified during a parallel update");
+
+		auto it = lookup.find(node);
+		if (it == lookup.end()) {
+			return;
+		}
+
+		int idx = it->second;
+		lookup.erase(it);
+
+		Unlink(idx);
+
+		entries[idx].node = NULL;
+		entries[idx].cell = -1;
+		entries[idx].next = freeEntry;
+		freeEntry = idx;
+		count--;
+	}
+
+	/*
+	=====================
+	SpatialIndex::Update
+	=====================
+	*/
+	void SpatialIndex::Update(GameNode *node) {
+		PimAssert(!CommandBuffer::GetRecording(),
+				  "Error: SpatialIndex modified during a parallel update");
+
+		auto it = lookup.find(node);
+		if (it != lookup.end()) {
+			Place(it->second, ComputeBounds(node));
+		}
+	}
+
+	/*
+	=====================
+	SpatialIndex::Refresh
+	=====================
+	*/
+	void SpatialIndex::Refresh() {
+		margin = 0.f;
+
+		for (unsigned i=0; i<entries.size(); i++) {
+			if (entries[i].node) {
+				Place(i, ComputeBounds(entries[i].node));
+			}
+		}
+	}
+
+	/*
+	=====================
+	SpatialIndex::Contains
+	=====================
+	*/
+	bool SpatialIndex::Contains(const GameNode *node) const {
+		return lookup.count(node) != 0;
+	}
+
+	/*
+	=====================
+	SpatialIndex::GetCount
+	=====================
+	*/
+	unsigned int SpatialIndex::GetCount() const {
+		return count;
+	}
+
+	/*
+	=====================
+	SpatialIndex::QueryRect
+	=====================
+	*/
+	void SpatialIndex::QueryRect(const AABB &rect, vector<GameNode*> &out) const {
+		out.clear();
+
+		if (rect.IsEmpty()) {
+			return;
+		}
+
+		int x0, y0, x1, y1;
+		CellRange(rect, x0, y0, x1, y1);
+
+		for (int y=y0; y<=y1; y++) {
+			for (int x=x0; x<=x1; x++) {
+				for (int i=cells[CellIndex(x,y)]; i>=0; i=entries[i].next) {
+					if (entries[i].bounds.Overlaps(rect)) {
+						out.push_back(entries[i].node);
+					}
+				}
+			}
+		}
+
+		for (int i=cells[overflow]; i>=0; i=entries[i].next) {
+			if (entries[i].bounds.Overlaps(rect)) {
+				out.push_back(entries[i].node);
+			}
+		}
+	}
+
+	/*
+	=====================
+	SpatialIndex::QueryRadius
+	=====================
+	*/
+	void SpatialIndex::QueryRadius(const Vec2 &center, float radius,
+								   vector<GameNode*> &out) const {
+		out.clear();
+
+		int x0, y0, x1, y1;
+		CellRange(AABB(center - Vec2(radius, radius), center + Vec2(radius, radius)),
+				  x0, y0, x1, y1);
+
+		for (int y=y0; y<=y1; y++) {
+			for (int x=x0; x<=x1; x++) {
+				for (int i=cells[CellIndex(x,y)]; i>=0; i=entries[i].next) {
+					if (Distance(entries[i].bounds, center) <= radius) {
+						out.push_back(entries[i].node);
+					}
+				}
+			}
+		}
+
+		for (int i=cells[overflow]; i>=0; i=entries[i].next) {
+			if (Distance(entries[i].bounds, center) <= radius) {
+				out.push_back(entries[i].node);
+			}
+		}
+	}
+
+	/*
+	=====================
+	SpatialIndex::QueryRay
+
+	Only the cells whose loose bounds are crossed by the segment are
+	searched. The border cells extend indefinitely outwards.
+	=====================
+	*/
+	void SpatialIndex::QueryRay(const Vec2 &from, const Vec2 &to, vector<Hit> &out) const {
+		out.clear();
+
+		Vec2 delta = to - from;
+		float length = delta.Length();
+
+		AABB span;
+		span.Extend(from);
+		span.Extend(to);
+
+		int x0, y0, x1, y1;
+		CellRange(span, x0, y0, x1, y1);
+
+		for (int y=y0; y<=y1; y++) {
+			for (int x=x0; x<=x1; x++) {
+				float t;
+
+				AABB loose(
+					Vec2(area.lower.x + x * cellSize - margin, area.lower.y + y * cellSize - margin),
+					Vec2(area.lower.x + (x+1) * cellSize + margin, area.lower.y + (y+1) * cellSize + margin)
+				);
+
+				if (x == 0)			loose.lower.x = -FLT_MAX;
+				if (y == 0)			loose.lower.y = -FLT_MAX;
+				if (x == cols-1)	loose.upper.x = FLT_MAX;
+				if (y == rows-1)	loose.upper.y = FLT_MAX;
+
+				if (!SegmentHitsBox(from, delta, loose, t)) {
+					continue;
+				}
+
+				for (int i=cells[CellIndex(x,y)]; i>=0; i=entries[i].next) {
+					if (SegmentHitsBox(from, delta, entries[i].bounds, t)) {
+						Hit hit = { entries[i].node, t * length };
+						out.push_back(hit);
+					}
+				}
+			}
+		}
+
+		for (int i=cells[overflow]; i>=0; i=entries[i].next) {
+			float t;
+
+			if (SegmentHitsBox(from, delta, entries[i].bounds, t)) {
+				Hit hit = { entries[i].node, t * length };
+				out.push_back(hit);
+			}
+		}
+
+		std::sort(out.begin(), out.end(), HitLess);
+	}
+
+	/*
+	=====================
+	SpatialIndex::QueryNearest
+
+	Searches the overflow list, and then rings of cells around the
+	point. The search stops when the k closest nodes found so far are
+	closer than any node in the cells not yet searched can be.
+	=====================
+	*/
+	void SpatialIndex::QueryNearest(const Vec2 &point, unsigned int k, vector<Hit> &out) const {
+		out.clear();
+
+		if (!k || !count) {
+			return;
+		}
+
+		int cx, cy;
+		CellOf(point, cx, cy);
+
+		for (int i=cells[overflow]; i>=0; i=entries[i].next) {
+			PushNearest(entries[i], point, k, out);
+		}
+
+		int maxRing = (cols > rows) ? cols : rows;
+
+		for (int r=0; r<=maxRing; r++) {
+			for (int y=cy-r; y<=cy+r; y++) {
+				if (y < 0 || y >= rows) {
+					continue;
+				}
+
+				// Inner rows of the ring only have their two end cells
+				bool edge = (y == cy-r || y == cy+r);
+				int step = (edge || r == 0) ? 1 : 2*r;
+
+				for (int x=cx-r; x<=cx+r; x+=step) {
+					if (x < 0 || x >= cols) {
+						continue;
+					}
+
+					for (int i=cells[CellIndex(x,y)]; i>=0; i=entries[i].next) {
+						PushNearest(entries[i], point, k, out);
+					}
+				}
+			}
+
+			if (out.size() == k) {
+				// The distance from the point to the cells not yet searched
+				float left		= (cx-r <= 0)		? -FLT_MAX : area.lower.x + (cx-r) * cellSize;
+				float right		= (cx+r >= cols-1)	?  FLT_MAX : area.lower.x + (cx+r+1) * cellSize;
+				float bottom	= (cy-r <= 0)		? -FLT_MAX : area.lower.y + (cy-r) * cellSize;
+				float top		= (cy+r >= rows-1)	?  FLT_MAX : area.lower.y + (cy+r+1) * cellSize;
+
+				float reach = std::min(std::min(point.x - left, right - point.x),
+									   std::min(point.y - bottom, top - point.y));
+
+				if (reach - margin >= out.front().distance) {
+					break;
+				}
+			}
+		}
+
+		std::sort_heap(out.begin(), out.end(), HitLess);
+	}
+
+	/*
+	=====================
+	SpatialIndex::PushNearest
+
+	Adds the entry to the max-heap of the k closest hits, if it is
+	closer than the farthest of them.
+	=====================
+	*/
+	void SpatialIndex::PushNearest(const Entry &e, const Vec2 &point, unsigned int k,
+								   vector<Hit> &out) {
+		Hit hit = { e.node, Distance(e.bounds, point) };
+
+		if (out.size() < k) {
+			out.push_back(hit);
+			std::push_heap(out.begin(), out.end(), HitLess);
+		} else if (hit.distance < out.front().distance) {
+			std::pop_heap(out.begin(), out.end(), HitLess);
+			out.back() = hit;
+			std::push_heap(out.begin(), out.end(), HitLess);
+		}
+	}
+
+	/*
+	=====================
+	SpatialIndex::RefreshAll
+	=====================
+	*/
+	void SpatialIndex::RefreshAll() {
+		for (unsigned i=0; i<instances.size(); i++) {
+			if (instances[i]->space == LAYER_SPACE) {
+				instances[i]->Refresh();
+			}
+		}
+	}
+
+	/*
+	=====================
+	SpatialIndex::RemoveFromAll
+	=====================
+	*/
+	void SpatialIndex::RemoveFromAll(GameNode *node) {
+		for (unsigned i=0; i<instances.size(); i++) {
+			instances[i]->Remove(node);
+		}
+	}
+
+	/*
+	=====================
+	SpatialIndex::ComputeBounds
+	=====================
+	*/
+	AABB SpatialIndex::ComputeBounds(GameNode *node) const {
+		AABB bounds;
+
+		if (space == SCREEN_SPACE) {
+			if (!node->GetScreenBounds(bounds)) {
+				bounds = AABB();
+			}
+		} else if (!node->GetLayerBounds(bounds) || bounds.IsEmpty()) {
+			Vec2 pos = node->GetLayerPosition();
+			bounds = AABB(pos, pos);
+		}
+
+		return bounds;
+	}
+
+	/*
+	=====================
+	SpatialIndex::Distance
+	=====================
+	*/
+	float SpatialIndex::Distance(const AABB &box, const Vec2 &point) {
+		float dx = std::max(std::max(box.lower.x - point.x, point.x - box.upper.x), 0.f);
+		float dy = std::max(std::max(box.lower.y - point.y, point.y - box.upper.y), 0.f);
+		return sqrtf(dx*dx + dy*dy);
+	}
+
+	/*
+	=====================
+	SpatialIndex::CellIndex
+	=====================
+	*/
+	int SpatialIndex::CellIndex(int x, int y) const {
+		return y * cols + x;
+	}
+
+	/*
+	=====================
+	SpatialIndex::CellOf
+	=====================
+	*/
+	void SpatialIndex::CellOf(const Vec2 &point, int &x, int &y) const {
+		x = (int)floorf((point.x - area.lower.x) / cellSize);
+		y = (int)floorf((point.y - area.lower.y) / cellSize);
+
+		x = std::min(std::max(x, 0), cols-1);
+		y = std::min(std::max(y, 0), rows-1);
+	}
+
+	/*
+	=====================
+	SpatialIndex::CellRange
+
+	The range of cells which may hold nodes overlapping the rect.
+	=====================
+	*/
+	void SpatialIndex::CellRange(const AABB &rect, int &x0, int &y0, int &x1, int &y1) const {
+		CellOf(rect.lower - Vec2(margin, margin), x0, y0);
+		CellOf(rect.upper + Vec2(margin, margin), x1, y1);
+	}
+
+	/*
+	=====================
+	SpatialIndex::Link
+	=====================
+	*/
+	void SpatialIndex::Link(int idx) {
+		Entry &e = entries[idx];
+		int &head = cells[e.cell];
+
+		e.prev = -1;
+		e.next = head;
+
+		if (head >= 0) {
+			entries[head].prev = idx;
+		}
+
+		head = idx;
+	}
+
+	/*
+	=====================
+	SpatialIndex::Unlink
+	=====================
+	*/
+	void SpatialIndex::Unlink(int idx) {
+		Entry &e = entries[idx];
+
+		if (e.cell < 0) {
+			return;
+		}
+
+		if (e.prev >= 0) {
+			entries[e.prev].next = e.next;
+		} else {
+			cells[e.cell] = e.next;
+		}
+
+		if (e.next >= 0) {
+			entries[e.next].prev = e.prev;
+		}
+
+		e.prev = -1;
+		e.next = -1;
+	}
+
+	/*
+	=====================
+	SpatialIndex::Place
+
+	Nodes larger than a cell go to the overflow list, which keeps the
+	margin of the grid at most half a cell.
+	=====================
+	*/
+	void SpatialIndex::Place(int idx, const AABB &bounds) {
+		Entry &e = entries[idx];
+		e.bounds = bounds;
+
+		Vec2 size = bounds.GetSize();
+		float half = std::max(size.x, size.y) * 0.5f;
+		int cell;
+
+		if (half > cellSize * 0.5f) {
+			cell = overflow;
+		} else {
+			if (half > margin) {
+				margin = half;
+			}
+
+			int x, y;
+			CellOf(bounds.GetCenter(), x, y);
+			cell = CellIndex(x, y);
+		}
+
+		if (cell != e.cell) {
+			Unlink(idx);
+			e.cell = cell;
+			Link(idx);
+		}
+	}
+}
@@ -8,6 +8,8 @@
 #include "PimGameControl.h"
 #include "PimSpriteBatchNode.h"
 #include "PimAction.h"
+#include "PimCommandBuffer.h"
+#include "PimTrace.h"
 
 namespace Pim {
 	/*
@@ -16,6 +18,8 @@ namespace Pim {
 	=====================
 	*/
 	Sprite::Sprite(string file) {
+		kind |= NODE_KIND;
+
 		anchor			= Vec2(0.5f, 0.5f);
 		scale			= Vec2(1.f, 1.f);
 		color			= Color(1.f, 1.f, 1.f, 1.f);
@@ -34,6 +38,8 @@ namespace Pim {
 	=====================
 	*/
 	Sprite::Sprite() {
+		kind |= NODE_KIND;
+
 		anchor			= Vec2(0.5f, 0.5f);
 		scale			= Vec2(1.f, 1.f);
 		color			= Color(1.f, 1.f, 1.f, 1.f);
@@ -61,6 +67,8 @@ namespace Pim {
 	=====================
 	*/
 	void Sprite::LoadSprite(string file) {
+		PIM_TRACE_ZONE("Sprite::LoadSprite");
+
 		textureFile = file;
 
 		png_structp		png_ptr;
@@ -133,6 +141,7 @@ namespace Pim {
 		// Default rect is the texture size. Crop at free!
 		rect.width = _tw;
 		rect.height = _th;
+		MarkMoved();
 
 		// Create the texture
 		glGenTextures(1, &texID);
@@ -175,6 +184,7 @@ namespace Pim {
 
 		if (shader) {
 			glUseProgram(shader->GetProgram());
+			UpdateShaderUniforms();
 		}
 
 		if (!hidden) {
@@ -216,16 +226,62 @@ namespace Pim {
 			glScalef(scale.x, scale.y, 1.f);
 		}
 
-		OrderChildren();
-
-		for (unsigned int i=0; i<children.size(); i++) {
-			children[i]->Draw();
-		}
+		DrawChildren();
 
 		// Restore this parent's view matrix
 		glPopMatrix();
 	}
 
+	/*
+	=====================
+	Sprite::ApplyChildTransform
+	=====================
+	*/
+	void Sprite::ApplyChildTransform() {
+		GameNode::ApplyChildTransform();
+
+		if (cascadeScale) {
+			glScalef(scale.x, scale.y, 1.f);
+		}
+	}
+
+	/*
+	=====================
+	Sprite::GetChildTransform
+	=====================
+	*/
+	void Sprite::GetChildTransform(Transform2D &t) const {
+		GameNode::GetChildTransform(t);
+
+		if (cascadeScale) {
+			t.Scale(scale.x, scale.y);
+		}
+	}
+
+	/*
+	=====================
+	Sprite::GetContentBounds
+	=====================
+	*/
+	bool Sprite::GetContentBounds(const Transform2D &parent, AABB &bounds) const {
+		bounds = AABB();
+
+		if (hidden) {
+			return true;
+		}
+
+		Vec2 fac = GameControl::GetSingleton()->GetWindowScale();
+
+		Transform2D t = GetNodeTransform(parent);
+		t.Scale(scale.x * fac.x, scale.y * fac.y);
+
+		AABB quad(Vec2(-anchor.x * rect.width, -anchor.y * rect.height),
+				  Vec2((1.f-anchor.x) * rect.width, (1.f-anchor.y) * rect.height));
+
+		bounds = t.Apply(quad);
+		return true;
+	}
+
 	/*
 	=====================
 	Sprite::BatchDraw
@@ -288,11 +344,7 @@ namespace Pim {
 		// Children are unaffected by their parent's scale. Restore.
 		glPopMatrix();
 
-		OrderChildren();
-
-		for (unsigned int i=0; i<children.size(); i++) {
-			children[i]->BatchDraw();
-		}
+		BatchDrawChildren();
 
 		// Restore this parent's view matrix
 		glPopMatrix();
@@ -304,6 +356,11 @@ namespace Pim {
 	=====================
 	*/
 	void Sprite::RunAction(SpriteAction *a) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->RunAction(this, a);
+			return;
+		}
+
 		AddChild(a);
 		a->Activate();
 	}
@@ -317,6 +374,15 @@ namespace Pim {
 		GameNode::RunAction(a);
 	}
 
+	/*
+	=====================
+	Sprite::UpdateShaderUniforms
+	=====================
+	*/
+	void Sprite::UpdateShaderUniforms() {
+		// Nothing to do by default
+	}
+
 	/*
 	=====================
 	Sprite::SetShader
@@ -357,6 +423,8 @@ namespace Pim {
 
 		_usebatch = true;
 		_batchNode = batch;
+
+		MarkMoved();
 	}
 
 	/*
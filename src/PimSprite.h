@@ -37,6 +37,8 @@ namespace Pim {
 		friend class SpriteBatchNode;
 
 	public:
+		enum { NODE_KIND = KIND_SPRITE };
+
 		bool					hidden;			// Hidden?
 		bool					cascadeScale;	// Is the scale inherited by children?
 		Vec2					anchor;			// (0.5,0.5) puts the sprites anchor in the center
@@ -51,6 +53,9 @@ namespace Pim {
 		virtual void			LoadSprite(string file);
 		virtual void			Draw();
 		virtual void			BatchDraw();
+		virtual void			ApplyChildTransform();
+		virtual void			GetChildTransform(Transform2D &t) const;
+		virtual bool			GetContentBounds(const Transform2D &parent, AABB &bounds) const;
 		void					RunAction(SpriteAction *action);
 		void					RunAction(Action *action);
 		void					SetShader(Shader *s);
@@ -59,6 +64,7 @@ namespace Pim {
 		virtual void			ReloadTextures();
 
 	protected:
+		virtual void			UpdateShaderUniforms();
 
 		string					textureFile;
 		GLuint					texID;			// The texture ID
@@ -80,6 +86,13 @@ namespace Pim {
 	 @brief 		Set a shader that will be used when the Sprite is drawn.
 	 */
 	
+	/**
+	 @fn 			UpdateShaderUniforms
+	 @brief 		Called by Draw() while the Sprite's shader is bound.
+	 @details 		Override to set per-sprite uniforms without having to
+	 				bind and unbind the shader program an additional time.
+	 */
+	
 	/**
 	 @fn 			UseBatchNode
 	 @brief 		Use the texture of the provided SpriteBatchNode.
@@ -2,6 +2,7 @@
 
 #include "PimSpriteBatchNode.h"
 #include "PimGameNode.h"
+#include "PimCommandBuffer.h"
 
 #include <functional>
 
@@ -14,6 +15,7 @@ namespace Pim {
 	SpriteBatchNode::SpriteBatchNode(string file)
 		: Sprite(file) {
 		// Using Pim::Sprite's init method
+		kind |= NODE_KIND;
 	}
 
 	/*
@@ -24,6 +26,7 @@ namespace Pim {
 	SpriteBatchNode::SpriteBatchNode()
 		: Sprite() {
 		// Using Pim::Sprite's default init method
+		kind |= NODE_KIND;
 	}
 
 	/*
@@ -41,9 +44,14 @@ namespace Pim {
 	=====================
 	*/
 	void SpriteBatchNode::AddChild(GameNode *ch) {
+		if (CommandBuffer *cmd = CommandBuffer::GetRecording()) {
+			cmd->AddChild(this, ch);
+			return;
+		}
+
 		GameNode::AddChild(ch);
 
-		if (Sprite *s = dynamic_cast<Sprite*>(ch)) {
+		if (Sprite *s = ch->As<Sprite>()) {
 			s->UseBatchNode(this);
 		}
 	}
@@ -66,12 +74,28 @@ namespace Pim {
 		glPushMatrix();
 		glBindTexture(GL_TEXTURE_2D, texID);
 
-		OrderChildren();
-
-		for (unsigned int i=0; i<children.size(); i++) {
-			children[i]->BatchDraw();
-		}
+		BatchDrawChildren();
 
 		glPopMatrix();
 	}
+
+	/*
+	=====================
+	SpriteBatchNode::GetChildTransform
+
+	The children are drawn in the space of the batch node's parent.
+	=====================
+	*/
+	void SpriteBatchNode::GetChildTransform(Transform2D &/*t*/) const {
+	}
+
+	/*
+	=====================
+	SpriteBatchNode::GetContentBounds
+	=====================
+	*/
+	bool SpriteBatchNode::GetContentBounds(const Transform2D &/*parent*/, AABB &bounds) const {
+		bounds = AABB();
+		return true;
+	}
 }
\ No newline at end of file
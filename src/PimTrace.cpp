@@ -0,0 +1,216 @@
+#include "PimInternal.h"
+
+#include "PimTrace.h"
+#include "PimGameControl.h"
+#include "PimJobSystem.h"
+#include "PimAssert.h"
+
+#include <stdio.h>
+
+namespace Pim {
+	atomic<bool> Trace::active(false);
+	mutex Trace::buffersLock;
+	vector<Trace::ThreadBuffer*> Trace::buffers;
+
+	static PIM_THREAD_LOCAL void *threadBuffer = NULL;
+
+	/*
+	=====================
+	Trace::Start
+	=====================
+	*/
+	void Trace::Start() {
+		active = true;
+	}
+
+	/*
+	=====================
+	Trace::Stop
+	=====================
+	*/
+	void Trace::Stop() {
+		active = false;
+	}
+
+	/*
+	=====================
+	Trace::IsActive
+	=====================
+	*/
+	bool Trace::IsActive() {
+		return active.load(memory_order_relaxed);
+	}
+
+	/*
+	=====================
+	Trace::Clear
+	=====================
+	*/
+	void Trace::Clear() {
+		lock_guard<mutex> guard(buffersLock);
+
+		for (unsigned i=0; i<buffers.size(); i++) {
+			lock_guard<mutex> bufGuard(buffers[i]->lock);
+			buffers[i]->events.clear();
+			buffers[i]->dropped = 0;
+		}
+	}
+
+	/*
+	=====================
+	Trace::Export
+
+	The timestamps and durations are written in microseconds.
+	=====================
+	*/
+	bool Trace::Export(const string &path) {
+		FILE *file = fopen(path.c_str(), "w");
+		if (!file) {
+			PimWarning("Unable to create the trace file", path.c_str());
+			return false;
+		}
+
+		lock_guard<mutex> guard(buffersLock);
+
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+		bool first = true;
+		for (unsigned i=0; i<buffers.size(); i++) {
+			ThreadBuffer *buf = buffers[i];
+			lock_guard<mutex> bufGuard(buf->lock);
+
+			if (!buf->name.empty()) {
+				fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+						"\"args\":{\"name\":", first ? "" : ",\n", buf->id);
+				WriteString(file, buf->name.c_str());
+				fprintf(file, "}}");
+				first = false;
+			}
+
+			if (buf->dropped) {
+				printf("[Trace] %u events dropped on thread %u\n", buf->dropped, buf->id);
+			}
+
+			for (unsigned j=0; j<buf->events.size(); j++) {
+				const Event &evt = buf->events[j];
+
+				fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+				WriteString(file, evt.name);
+				fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+						buf->id, evt.start * 1000000.0, (evt.end - evt.start) * 1000000.0);
+				first = false;
+			}
+		}
+
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		return true;
+	}
+
+	/*
+	=====================
+	Trace::SetThreadName
+	=====================
+	*/
+	void Trace::SetThreadName(const char *name) {
+		ThreadBuffer *buf = GetThreadBuffer();
+
+		lock_guard<mutex> guard(buf->lock);
+		buf->name = name;
+	}
+
+	/*
+	=====================
+	Trace::BeginZone
+	=====================
+	*/
+	double Trace::BeginZone() {
+		return GameControl::GetTime();
+	}
+
+	/*
+	=====================
+	Trace::EndZone
+	=====================
+	*/
+	void Trace::EndZone(const char *name, double start) {
+		Event evt = { name, start, GameControl::GetTime() };
+		ThreadBuffer *buf = GetThreadBuffer();
+
+		lock_guard<mutex> guard(buf->lock);
+
+		if (buf->events.size() < PIM_TRACE_MAX_EVENTS) {
+			buf->events.push_back(evt);
+		} else {
+			buf->dropped++;
+		}
+	}
+
+	/*
+	=====================
+	Trace::GetThreadBuffer
+
+	The buffer is created on the first zone of each thread. The
+	lock of a thread's buffer is only contended while exporting.
+	=====================
+	*/
+	Trace::ThreadBuffer* Trace::GetThreadBuffer() {
+		if (!threadBuffer) {
+			ThreadBuffer *buf = new ThreadBuffer;
+			buf->dropped = 0;
+
+			lock_guard<mutex> guard(buffersLock);
+			buf->id = (unsigned int)buffers.size() + 1;
+			buffers.push_back(buf);
+
+			threadBuffer = buf;
+		}
+
+		return (ThreadBuffer*)threadBuffer;
+	}
+
+	/*
+	=====================
+	Trace::WriteString
+	=====================
+	*/
+	void Trace::WriteString(FILE *file, const char *str) {
+		fputc('"', file);
+
+		for (; *str; str++) {
+			if (*str == '"' || *str == '\\') {
+				fputc('\\', file);
+			}
+
+			if ((unsigned char)*str >= 0x20) {
+				fputc(*str, file);
+			}
+		}
+
+		fputc('"', file);
+	}
+
+	/*
+	=====================
+	TraceZone::TraceZone
+	=====================
+	*/
+	TraceZone::TraceZone(const char *zoneName) {
+		name = Trace::IsActive() ? zoneName : NULL;
+
+		if (name) {
+			start = Trace::BeginZone();
+		}
+	}
+
+	/*
+	=====================
+	TraceZone::~TraceZone
+	=====================
+	*/
+	TraceZone::~TraceZone() {
+		if (name) {
+			Trace::EndZone(name, start);
+		}
+	}
+}
@@ -0,0 +1,412 @@
+#include "PimInternal.h"
+
+#include "PimVisibilityPolygon.h"
+#include "PimGameNode.h"
+#include "PimPolygonShape.h"
+
+#include <algorithm>
+
+namespace Pim {
+	/*
+	=====================
+	ClipEdge
+
+	One edge of a Liang-Barsky clip. Narrows [t0, t1] to the part of
+	the segment inside the edge, and returns false if nothing is left.
+	=====================
+	*/
+	static bool ClipEdge(float p, float q, float &t0, float &t1) {
+		if (p == 0.f) {
+			return q >= 0.f;
+		}
+
+		float r = q / p;
+
+		if (p < 0.f) {
+			if (r > t1) {
+				return false;
+			}
+			if (r > t0) {
+				t0 = r;
+			}
+		} else {
+			if (r < t0) {
+				return false;
+			}
+			if (r < t1) {
+				t1 = r;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::GatherSegments
+	=====================
+	*/
+	void VisibilityPolygon::GatherSegments(const vector<GameNode*> &casters,
+											vector<Vec2> &segments, const Vec2 &sc) {
+		for (unsigned i=0; i<casters.size(); i++) {
+			PolygonShape *shape = casters[i]->GetShadowShape();
+			if (!shape) {
+				continue;
+			}
+
+			for (unsigned j=0; j<shape->lines.size(); j++) {
+				segments.push_back(shape->lines[j]->GetP1(sc));
+				segments.push_back(shape->lines[j]->GetP2(sc));
+			}
+		}
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::VisibilityPolygon
+	=====================
+	*/
+	VisibilityPolygon::VisibilityPolygon() {
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::Compute
+	=====================
+	*/
+	void VisibilityPolygon::Compute(const Vec2 &o, float radius,
+									const vector<GameNode*> &casters) {
+		gathered.clear();
+		GatherSegments(casters, gathered);
+		Compute(o, Vec2(radius, radius), gathered);
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::Compute
+
+	Sweeps counter-clockwise from -PI to PI. Between two consecutive
+	event angles, no segment starts or ends, and the segments in the
+	heap do not change order as long as they do not cross.
+	=====================
+	*/
+	void VisibilityPolygon::Compute(const Vec2 &o, const Vec2 &ext,
+									const vector<Vec2> &segments) {
+		origin = o;
+		extent = ext;
+		vertices.clear();
+		angles.clear();
+		segs.clear();
+		events.clear();
+		heap.clear();
+
+		/* The segments clipped to the box, relative to the origin, and the box */
+		for (unsigned i=0; i+1<segments.size(); i+=2) {
+			Vec2 a = segments[i] - origin;
+			Vec2 e = segments[i+1] - segments[i];
+
+			float t0 = 0.f;
+			float t1 = 1.f;
+
+			if (ClipEdge(-e.x, a.x + extent.x, t0, t1) &&
+				ClipEdge(e.x, extent.x - a.x, t0, t1) &&
+				ClipEdge(-e.y, a.y + extent.y, t0, t1) &&
+				ClipEdge(e.y, extent.y - a.y, t0, t1)) {
+				AddSegment(a + e*t0, a + e*t1);
+			}
+		}
+
+		Vec2 corners[4] = {
+			Vec2(-extent.x, -extent.y), Vec2(extent.x, -extent.y),
+			Vec2(extent.x, extent.y), Vec2(-extent.x, extent.y),
+		};
+
+		for (int i=0; i<4; i++) {
+			AddSegment(corners[i], corners[(i+1)%4]);
+		}
+
+		sort(events.begin(), events.end(), [](const Event &e1, const Event &e2) {
+			return e1.angle < e2.angle;
+		});
+
+		heapPos.assign(segs.size() / 2, -1);
+
+		/* Sweep */
+		int closest = -1;
+		unsigned i = 0;
+
+		while (i < events.size()) {
+			float angle = events[i].angle;
+
+			unsigned last = i;
+			while (last < events.size() && events[last].angle == angle) {
+				last++;
+			}
+
+			// Remove while the heap is ordered along the previous interval,
+			// where all of the segments in it are present
+			for (unsigned j=i; j<last; j++) {
+				if (!events[j].start) {
+					HeapRemove(events[j].seg);
+				}
+			}
+
+			// Order the heap along the middle of the next interval
+			if (last < events.size()) {
+				float mid = (angle + events[last].angle) * 0.5f;
+				sweepDir = Vec2(cosf(mid), sinf(mid));
+			}
+
+			for (unsigned j=i; j<last; j++) {
+				if (events[j].start) {
+					HeapPush(events[j].seg);
+				}
+			}
+
+			int next = heap.empty() ? -1 : heap[0];
+
+			if (next != closest) {
+				Vec2 dir(cosf(angle), sinf(angle));
+
+				if (closest >= 0) {
+					AddVertex(dir * RayDistance(closest, dir), angle);
+				}
+
+				if (next >= 0) {
+					AddVertex(dir * RayDistance(next, dir), angle);
+				}
+
+				closest = next;
+			}
+
+			i = last;
+		}
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::Contains
+	=====================
+	*/
+	bool VisibilityPolygon::Contains(const Vec2 &point) const {
+		if (vertices.size() < 3) {
+			return false;
+		}
+
+		Vec2 p = point - origin;
+		float a = atan2f(p.y, p.x);
+
+		// Find the wedge [i-1, i] containing the angle. Wedges wrap around.
+		unsigned i = upper_bound(angles.begin(), angles.end(), a) - angles.begin();
+		const Vec2 &v1 = vertices[(i + vertices.size() - 1) % vertices.size()];
+		const Vec2 &v2 = vertices[i % vertices.size()];
+
+		// The point is visible if it lies on the origin's side of the edge
+		return (v2 - v1).Cross(p - v1) >= 0.f;
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::AddSegment
+
+	Orients the segment counter-clockwise around the origin, and splits
+	it where it crosses the negative x-axis, where the angles wrap.
+	Segments pointing at the origin have no width, and are dropped.
+	=====================
+	*/
+	void VisibilityPolygon::AddSegment(Vec2 a, Vec2 b) {
+		float cross = a.Cross(b);
+
+		if (fabsf(cross) <= 1e-6f * a.Length() * b.Length()) {
+			return;
+		}
+
+		if (cross < 0.f) {
+			swap(a, b);
+		}
+
+		// A counter-clockwise segment going from above to below the
+		// x-axis spans less than PI, so it must cross the negative half
+		if (a.y > 0.f && b.y < 0.f) {
+			float t = a.y / (a.y - b.y);
+			Vec2 p(a.x + (b.x - a.x) * t, 0.f);
+
+			PushSegment(a, p);
+			PushSegment(p, b);
+		} else {
+			PushSegment(a, b);
+		}
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::PushSegment
+
+	An endpoint on the negative x-axis is at -PI if the segment starts
+	there, and at PI if the segment ends there.
+	=====================
+	*/
+	void VisibilityPolygon::PushSegment(const Vec2 &a, const Vec2 &b) {
+		float a1 = (a.y == 0.f && a.x < 0.f) ? float(-M_PI) : atan2f(a.y, a.x);
+		float a2 = (b.y == 0.f && b.x < 0.f) ? float(M_PI) : atan2f(b.y, b.x);
+
+		if (a2 <= a1) {
+			return;
+		}
+
+		int seg = (int)segs.size() / 2;
+		segs.push_back(a);
+		segs.push_back(b);
+
+		Event e1 = { a1, seg, true };
+		Event e2 = { a2, seg, false };
+		events.push_back(e1);
+		events.push_back(e2);
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::AddVertex
+	=====================
+	*/
+	void VisibilityPolygon::AddVertex(const Vec2 &p, float angle) {
+		// Segments meeting at an endpoint give the same vertex twice
+		if (!angles.empty() && angles.back() == angle &&
+			(vertices.back() - p).Length() < 0.0001f) {
+			return;
+		}
+
+		vertices.push_back(p);
+		angles.push_back(angle);
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::RayDistance
+
+	The distance from the origin along 'dir' to the segment's line.
+	=====================
+	*/
+	float VisibilityPolygon::RayDistance(int seg, const Vec2 &dir) const {
+		const Vec2 &a = segs[seg*2];
+		Vec2 e = segs[seg*2+1] - a;
+
+		float denom = dir.Cross(e);
+		if (fabsf(denom) < 1e-12f) {
+			return min(a.Length(), segs[seg*2+1].Length());
+		}
+
+		return a.Cross(e) / denom;
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::Closer
+	=====================
+	*/
+	bool VisibilityPolygon::Closer(int s1, int s2) const {
+		float d1 = RayDistance(s1, sweepDir);
+		float d2 = RayDistance(s2, sweepDir);
+
+		if (d1 != d2) {
+			return d1 < d2;
+		}
+
+		return s1 < s2;
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::HeapPush
+	=====================
+	*/
+	void VisibilityPolygon::HeapPush(int seg) {
+		heap.push_back(seg);
+		heapPos[seg] = (int)heap.size() - 1;
+		SiftUp((int)heap.size() - 1);
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::HeapRemove
+	=====================
+	*/
+	void VisibilityPolygon::HeapRemove(int seg) {
+		int idx = heapPos[seg];
+		if (idx < 0) {
+			return;
+		}
+
+		heapPos[seg] = -1;
+
+		int back = heap.back();
+		heap.pop_back();
+
+		if (idx < (int)heap.size()) {
+			HeapSet(idx, back);
+			SiftUp(idx);
+			SiftDown(heapPos[back]);
+		}
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::SiftUp
+	=====================
+	*/
+	void VisibilityPolygon::SiftUp(int idx) {
+		int seg = heap[idx];
+
+		while (idx > 0) {
+			int parent = (idx - 1) / 2;
+			if (!Closer(seg, heap[parent])) {
+				break;
+			}
+
+			HeapSet(idx, heap[parent]);
+			idx = parent;
+		}
+
+		HeapSet(idx, seg);
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::SiftDown
+	=====================
+	*/
+	void VisibilityPolygon::SiftDown(int idx) {
+		int seg = heap[idx];
+		int size = (int)heap.size();
+
+		while (true) {
+			int child = idx * 2 + 1;
+			if (child >= size) {
+				break;
+			}
+
+			if (child + 1 < size && Closer(heap[child+1], heap[child])) {
+				child++;
+			}
+
+			if (!Closer(heap[child], seg)) {
+				break;
+			}
+
+			HeapSet(idx, heap[child]);
+			idx = child;
+		}
+
+		HeapSet(idx, seg);
+	}
+
+	/*
+	=====================
+	VisibilityPolygon::HeapSet
+	=====================
+	*/
+	void VisibilityPolygon::HeapSet(int idx, int seg) {
+		heap[idx] = seg;
+		heapPos[seg] = idx;
+	}
+}
@@ -0,0 +1,272 @@
+#include "PimInternal.h"
+#include "PimJobSystem.h"
+#include "PimGameControl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+	Standalone test and stress run of JobSystem, followed by a timing run
+	with 1 to N workers. Run with "make tests && test/JobSystemTest".
+	An optional argument sets N, which defaults to the number of cores.
+*/
+
+static int failures = 0;
+
+#define CHECK(_EXPR, _DESC)										\
+	if (!(_EXPR)) {												\
+		printf("FAIL: %s (%s:%d)\n", _DESC, __FILE__, __LINE__);	\
+		failures++;												\
+	}
+
+/*
+=====================
+TestParallelFor
+
+Every index must be visited exactly once, for any count and grain.
+=====================
+*/
+static void TestParallelFor(Pim::JobSystem &js)
+{
+	const unsigned int counts[] = { 0, 1, 7, 1000, 100003 };
+	const unsigned int grains[] = { 0, 1, 3, 64, 200000 };
+
+	for (int c=0; c<5; c++) {
+		unsigned int count = counts[c];
+		vector<atomic<int> > visits(count);
+
+		for (int g=0; g<5; g++) {
+			for (unsigned i=0; i<count; i++) {
+				visits[i] = 0;
+			}
+
+			js.ParallelFor(count, grains[g], [&visits](unsigned int first, unsigned int last) {
+				for (unsigned i=first; i<last; i++) {
+					visits[i]++;
+				}
+			});
+
+			bool once = true;
+			for (unsigned i=0; i<count; i++) {
+				once = once && (visits[i] == 1);
+			}
+
+			CHECK(once, "ParallelFor must visit every index exactly once");
+		}
+	}
+}
+
+/*
+=====================
+TestNestedWait
+
+Jobs waiting for their own jobs must not deadlock, even when
+there are more waiting jobs than threads.
+=====================
+*/
+static void TestNestedWait(Pim::JobSystem &js)
+{
+	const int outer = 64;
+	const int inner = 32;
+
+	atomic<int> done(0);
+	Pim::JobCounter counter;
+
+	for (int i=0; i<outer; i++) {
+		js.Run([&js, &done]() {
+			Pim::JobCounter innerCounter;
+
+			for (int j=0; j<inner; j++) {
+				js.Run([&done]() {
+					done++;
+				}, &innerCounter);
+			}
+
+			js.Wait(&innerCounter);
+		}, &counter);
+	}
+
+	js.Wait(&counter);
+	CHECK(done == outer * inner, "Nested Wait must run every inner job");
+}
+
+/*
+=====================
+TestDependency
+
+A job gated by a dependency must not start before every job
+counted by the dependency has finished.
+=====================
+*/
+static void TestDependency(Pim::JobSystem &js)
+{
+	for (int round=0; round<200; round++) {
+		const int num = 16;
+
+		atomic<int> finished(0);
+		atomic<int> seenFinished(-1);
+		Pim::JobCounter dependency;
+		Pim::JobCounter all;
+
+		for (int i=0; i<num; i++) {
+			js.Run([&finished]() {
+				volatile float x = 0.f;
+				for (int j=0; j<2000; j++) {
+					x = x + sqrtf((float)j);
+				}
+				finished++;
+			}, &dependency);
+		}
+
+		js.Run([&finished, &seenFinished]() {
+			seenFinished = finished.load();
+		}, &all, &dependency);
+
+		js.Wait(&all);
+		js.Wait(&dependency);
+
+		CHECK(seenFinished == num, "A continuation must run after it's dependency is done");
+
+		// A dependency which is already done does not delay the job
+		atomic<bool> ran(false);
+		js.Run([&ran]() {
+			ran = true;
+		}, &all, &dependency);
+
+		js.Wait(&all);
+		CHECK(ran, "A job with a finished dependency must run");
+	}
+}
+
+/*
+=====================
+TestCounterLifetime
+
+The counter lives on the stack, and is destroyed as soon as
+Wait() returns. A job still touching it would corrupt the stack.
+=====================
+*/
+static void TestCounterLifetime(Pim::JobSystem &js)
+{
+	atomic<int> done(0);
+
+	for (int i=0; i<20000; i++) {
+		Pim::JobCounter counter;
+
+		for (int j=0; j<4; j++) {
+			js.Run([&done]() {
+				done++;
+			}, &counter);
+		}
+
+		js.Wait(&counter);
+		CHECK(counter.IsDone(), "The counter must be done when Wait() returns");
+	}
+
+	CHECK(done == 20000 * 4, "Every job must run");
+}
+
+/*
+=====================
+Work
+
+A fixed amount of floating point work.
+=====================
+*/
+static float Work(unsigned int first, unsigned int last)
+{
+	float sum = 0.f;
+
+	for (unsigned i=first; i<last; i++) {
+		float x = (float)i;
+		for (int j=0; j<64; j++) {
+			x = sqrtf(x + 1.f);
+		}
+		sum += x;
+	}
+
+	return sum;
+}
+
+/*
+=====================
+TimeWorkers
+
+Runs the same ParallelFor, and the same number of small jobs, with
+1 to maxWorkers workers. The main thread takes part in both, so 1
+worker means 2 threads.
+=====================
+*/
+static void TimeWorkers(unsigned int maxWorkers)
+{
+	const unsigned int count = 1 << 20;
+	const unsigned int smallJobs = 100000;
+
+	printf("\nworkers  parallel-for  speedup  small-jobs  jobs/ms\n");
+
+	double base = 0.0;
+
+	for (unsigned int n=1; n<=maxWorkers; n++) {
+		Pim::JobSystem js(n);
+		atomic<int> sink(0);
+
+		Pim::Tick start = Pim::GameControl::GetTime();
+		js.ParallelFor(count, 0, [&sink](unsigned int first, unsigned int last) {
+			sink += (int)Work(first, last);
+		});
+		double forTime = Pim::GameControl::GetTime() - start;
+
+		if (n == 1) {
+			base = forTime;
+		}
+
+		Pim::JobCounter counter;
+		start = Pim::GameControl::GetTime();
+		for (unsigned i=0; i<smallJobs; i++) {
+			js.Run([&sink]() {
+				sink++;
+			}, &counter);
+		}
+		js.Wait(&counter);
+		double jobTime = Pim::GameControl::GetTime() - start;
+
+		printf("%7u  %9.2f ms  %6.2fx  %7.2f ms  %7.0f\n", n, forTime * 1e3, base / forTime,
+			   jobTime * 1e3, smallJobs / (jobTime * 1e3));
+	}
+}
+
+/*
+=====================
+main
+=====================
+*/
+int main(int argc, char **argv)
+{
+	unsigned int maxWorkers = (argc > 1) ? atoi(argv[1]) : thread::hardware_concurrency();
+	if (maxWorkers < 1) {
+		maxWorkers = 1;
+	}
+
+	// Few workers make waiting jobs more likely to run out of threads
+	const unsigned int workerCounts[] = { 1, 3, maxWorkers };
+
+	for (int i=0; i<3; i++) {
+		Pim::JobSystem js(workerCounts[i]);
+		printf("Testing with %u workers\n", js.GetWorkerCount());
+
+		TestParallelFor(js);
+		TestNestedWait(js);
+		TestDependency(js);
+		TestCounterLifetime(js);
+	}
+
+	TimeWorkers(maxWorkers);
+
+	if (failures) {
+		printf("\n%d checks failed\n", failures);
+		return 1;
+	}
+
+	printf("\nAll checks passed\n");
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include "PimInternal.h"
+#include "PimNodePool.h"
+#include "PimGameNode.h"
+#include "PimSprite.h"
+#include "PimLabel.h"
+#include "PimLayer.h"
+#include "PimAction.h"
+#include "PimGameControl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+	Standalone churn run of NodePool. Blocks of the sizes of the common
+	node classes are allocated and freed over many frames, and the heap
+	allocations of the pool must stop growing once it has been warmed up
+	to the peak number of live nodes. Run with "make tests && test/NodePoolChurn".
+
+	Deleting real nodes requires a GameControl, so the test allocates the
+	blocks from the pool directly, as GameNode::operator new does.
+*/
+
+#define NUM_FRAMES		10000
+#define MAX_LIVE		2000		// Peak number of live blocks of each size
+#define MAX_CHANGES		200			// Allocations and frees per frame
+
+#define R01 ((float)rand()/(float)RAND_MAX)
+
+struct Block {
+	void			*ptr;
+	size_t			size;
+};
+
+static vector<Block> live;
+static int failures = 0;
+
+#define CHECK(_EXPR, _DESC)										\
+	if (!(_EXPR)) {												\
+		printf("FAIL: %s (%s:%d)\n", _DESC, __FILE__, __LINE__);	\
+		failures++;												\
+	}
+
+/*
+=====================
+Free
+
+Frees the live block at 'idx', out of order.
+=====================
+*/
+static void Free(unsigned int idx)
+{
+	Pim::NodePool::Free(live[idx].ptr, live[idx].size);
+	live[idx] = live.back();
+	live.pop_back();
+}
+
+/*
+=====================
+main
+=====================
+*/
+int main(int argc, char **argv)
+{
+	srand(1);
+
+	const size_t sizes[] = {
+		sizeof(Pim::GameNode),
+		sizeof(Pim::Sprite),
+		sizeof(Pim::Label),
+		sizeof(Pim::Layer),
+		sizeof(Pim::MoveToAction),
+		sizeof(Pim::ActionQueue),
+	};
+	const int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+	vector<int> count(numSizes, 0);
+
+	// Warm-up: grow every size class to the peak, and free it all
+	for (int i=0; i<numSizes; i++) {
+		for (int j=0; j<MAX_LIVE; j++) {
+			Block block = { Pim::NodePool::Allocate(sizes[i]), sizes[i] };
+			live.push_back(block);
+		}
+	}
+
+	while (!live.empty()) {
+		Free(rand() % live.size());
+	}
+
+	CHECK(Pim::NodePool::GetLiveCount() == 0, "No block may be live after the warm-up");
+
+	const unsigned int warm = Pim::NodePool::GetHeapAllocationCount();
+	printf("Warm-up: %u heap allocations for %d sizes of up to %d live blocks\n",
+		   warm, numSizes, MAX_LIVE);
+
+	// Churn: allocate and free in random order, never exceeding the peak
+	unsigned int ops = 0;
+	unsigned int maxLive = 0;
+
+	Pim::Tick start = Pim::GameControl::GetTime();
+	for (int frame=0; frame<NUM_FRAMES; frame++) {
+		int changes = rand() % MAX_CHANGES;
+
+		for (int i=0; i<changes; i++, ops++) {
+			int s = rand() % numSizes;
+
+			if (R01 < 0.5f && count[s] < MAX_LIVE) {
+				Block block = { Pim::NodePool::Allocate(sizes[s]), sizes[s] };
+				live.push_back(block);
+				count[s]++;
+			} else if (!live.empty()) {
+				unsigned int idx = rand() % live.size();
+				for (int j=0; j<numSizes; j++) {
+					if (sizes[j] == live[idx].size) {
+						count[j]--;
+						break;
+					}
+				}
+				Free(idx);
+			}
+		}
+
+		maxLive = max(maxLive, (unsigned int)live.size());
+
+		CHECK(Pim::NodePool::GetLiveCount() == live.size(),
+			  "The live count must match the live blocks");
+		CHECK(Pim::NodePool::GetHeapAllocationCount() == warm,
+			  "The heap allocations must not grow after the warm-up");
+
+		if (failures > 10) {
+			break;
+		}
+	}
+	double poolTime = Pim::GameControl::GetTime() - start;
+
+	printf("Churn: %d frames, %u operations (%.1f ns/op), up to %u live blocks\n",
+		   NUM_FRAMES, ops, poolTime * 1e9 / ops, maxLive);
+
+	while (!live.empty()) {
+		Free(live.size() - 1);
+	}
+
+	CHECK(Pim::NodePool::GetLiveCount() == 0, "No block may be live after the churn");
+
+	// Blocks too large for the pool go to the heap every time
+	const size_t large = PIM_POOL_MAX_BLOCK + 1;
+	void *ptr = Pim::NodePool::Allocate(large);
+	Pim::NodePool::Free(ptr, large);
+	CHECK(Pim::NodePool::GetHeapAllocationCount() == warm + 1,
+		  "A block too large for the pool must be counted as a heap allocation");
+
+	if (failures) {
+		printf("\n%d checks failed\n", failures);
+		return 1;
+	}
+
+	printf("\nAll checks passed\n");
+	return 0;
+}
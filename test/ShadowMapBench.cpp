@@ -0,0 +1,215 @@
+#include "PimInternal.h"
+#include "PimGameControl.h"
+#include "PimScene.h"
+#include "PimLayer.h"
+#include "PimLightingSystem.h"
+#include "PimLightDef.h"
+#include "PimFrameStats.h"
+#include "PimRenderWindow.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+	Windowed benchmark of the stencil and polar shadow modes. Both modes
+	render the same scene of moving lights over a grid of shadow casters,
+	and the lighting and frame times are read from the FrameStats. Run
+	with "make tests && test/ShadowMapBench [casters] [lights]". The
+	defaults are 1000 octagons (8000 edges) and 32 lights.
+*/
+
+#define WARMUP_FRAMES	60
+#define MEASURE_FRAMES	300
+#define LIGHT_RADIUS	150.f
+
+#define R01 ((float)rand()/(float)RAND_MAX)
+
+static int numCasters = 1000;
+static int numLights = 32;
+
+/*
+	Runs every shadow mode for WARMUP_FRAMES + MEASURE_FRAMES frames,
+	and exits once all of them have been measured.
+*/
+class BenchLayer : public Pim::Layer
+{
+public:
+	void LoadResources();
+	void Update(float dt);
+
+private:
+	vector<Pim::GameNode*> lights;
+	vector<Pim::Vec2> centers;
+	int mode;
+	int frame;
+	float time;
+
+	void StartMode();
+	void Report();
+};
+
+/*
+	The scene holding the BenchLayer.
+*/
+class BenchScene : public Pim::Scene
+{
+public:
+	void LoadResources()
+	{
+		BenchLayer *layer = new BenchLayer;
+		AddLayer(layer);
+	}
+};
+
+static const Pim::LightingSystem::ShadowMode modes[] = {
+	Pim::LightingSystem::SHADOW_STENCIL,
+	Pim::LightingSystem::SHADOW_POLAR,
+};
+static const char *modeNames[] = { "stencil", "polar" };
+static const int numModes = 2;
+
+/*
+=====================
+BenchLayer::LoadResources
+=====================
+*/
+void BenchLayer::LoadResources()
+{
+	srand(1);
+
+	Pim::GameControl::GetRenderWindow()->SetSwapInterval(0);
+	Pim::GameControl::GetSingleton()->LimitFrame(0);
+
+	CreateLightingSystem(Pim::Vec2(800.f, 600.f));
+	SetLightingUnlitColor(Pim::Color(0.f, 0.f, 0.f, 1.f));
+	SetLightAlpha(0.f);
+
+	// A grid of small octagons covering the window
+	int side = (int)ceilf(sqrtf((float)numCasters));
+	Pim::Vec2 cell(800.f / side, 600.f / side);
+
+	for (int i=0; i<numCasters; i++) {
+		Pim::GameNode *caster = new Pim::GameNode;
+		caster->position = Pim::Vec2((i % side + 0.5f) * cell.x, (i / side + 0.5f) * cell.y);
+		AddChild(caster);
+
+		Pim::Vec2 verts[8];
+		float r = min(cell.x, cell.y) * 0.3f;
+		for (int j=0; j<8; j++) {
+			float a = j * (float)M_PI / 4.f;
+			verts[j] = Pim::Vec2(r * cosf(a), r * sinf(a));
+		}
+
+		caster->SetShadowShape(verts, 8);
+		AddShadowCaster(caster);
+	}
+
+	for (int i=0; i<numLights; i++) {
+		Pim::FlatLightDef *ld = new Pim::FlatLightDef;
+		ld->innerColor = Pim::Color(1.f, 1.f, 1.f, 1.f);
+		ld->outerColor = Pim::Color(1.f, 1.f, 1.f, 0.f);
+		ld->radius = LIGHT_RADIUS;
+
+		Pim::GameNode *light = new Pim::GameNode;
+		AddChild(light);
+		AddLight(light, ld);
+
+		lights.push_back(light);
+		centers.push_back(Pim::Vec2(100.f + R01 * 600.f, 100.f + R01 * 400.f));
+	}
+
+	printf("%d casters (%d edges), %d lights, %d frames per mode\n\n",
+		   numCasters, numCasters * 8, numLights, MEASURE_FRAMES);
+	printf("mode      lighting avg   p95       frame avg   p95\n");
+
+	mode = 0;
+	time = 0.f;
+	StartMode();
+
+	ListenFrame();
+}
+
+/*
+=====================
+BenchLayer::StartMode
+=====================
+*/
+void BenchLayer::StartMode()
+{
+	SetShadowMode(modes[mode]);
+	frame = 0;
+}
+
+/*
+=====================
+BenchLayer::Report
+=====================
+*/
+void BenchLayer::Report()
+{
+	Pim::FrameStats *stats = Pim::GameControl::GetFrameStats();
+	Pim::FrameStats::Summary lighting = stats->GetSummary(Pim::FrameStats::LIGHTING, MEASURE_FRAMES);
+	Pim::FrameStats::Summary total = stats->GetSummary(Pim::FrameStats::TOTAL, MEASURE_FRAMES);
+
+	printf("%-8s  %7.3f ms  %7.3f ms  %7.3f ms  %7.3f ms\n", modeNames[mode],
+		   lighting.average * 1e3f, lighting.p95 * 1e3f, total.average * 1e3f, total.p95 * 1e3f);
+}
+
+/*
+=====================
+BenchLayer::Update
+
+The lights circle their centers at a fixed rate per frame, so every
+mode renders the same sequence of frames.
+=====================
+*/
+void BenchLayer::Update(float dt)
+{
+	// The frames of the current mode have been rendered
+	if (frame == WARMUP_FRAMES + MEASURE_FRAMES) {
+		Report();
+
+		if (++mode == numModes) {
+			Pim::GameControl::GetSingleton()->Exit();
+			return;
+		}
+
+		StartMode();
+		time = 0.f;
+	}
+
+	for (unsigned i=0; i<lights.size(); i++) {
+		float a = time + i;
+		lights[i]->position = centers[i] + Pim::Vec2(cosf(a), sinf(a)) * 80.f;
+	}
+
+	time += 1.f / 60.f;
+	frame++;
+}
+
+/*
+=====================
+main
+=====================
+*/
+int main(int argc, char **argv)
+{
+	if (argc > 1) {
+		numCasters = max(atoi(argv[1]), 1);
+	}
+	if (argc > 2) {
+		numLights = max(atoi(argv[2]), 1);
+	}
+
+	{
+		Pim::GameControl gc;
+
+		Pim::WinStyle::CreationData cd("ShadowMapBench", 800, 600, Pim::WinStyle::WINDOWED);
+		cd.renderResolution		= Pim::Vec2(800, 600);
+		cd.coordinateSystem		= Pim::Vec2(800, 600);
+
+		gc.Go(new BenchScene, cd, false);
+	}
+
+	return 0;
+}
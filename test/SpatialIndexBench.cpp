@@ -0,0 +1,238 @@
+#include "PimInternal.h"
+#include "PimSpatialIndex.h"
+#include "PimGameNode.h"
+#include "PimGameControl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+/*
+	Standalone benchmark of SpatialIndex with 50k nodes. Every query is
+	checked against a linear search over all the nodes, and timed against
+	it. Run with "make tests && test/SpatialIndexBench".
+*/
+
+#define NUM_NODES		50000
+#define NUM_LARGE		50			// Nodes larger than a cell
+#define NUM_QUERIES		1000
+#define WORLD_SIZE		10000.f
+#define CELL_SIZE		64.f
+
+#define R01 ((float)rand()/(float)RAND_MAX)
+
+/*
+	The nodes have fixed bounds, so the index needs no GameControl.
+	Screen space indices take the bounds from GetHitBounds().
+*/
+class BoxNode : public Pim::GameNode
+{
+public:
+	Pim::AABB box;
+
+	bool GetHitBounds(Pim::AABB &bounds) const
+	{
+		bounds = box;
+		return true;
+	}
+};
+
+static vector<BoxNode*> nodes;
+static int failures = 0;
+
+/*
+=====================
+Check
+=====================
+*/
+static void Check(bool ok, const char *query, int idx)
+{
+	if (!ok) {
+		if (failures++ < 10) {
+			printf("FAIL: %s query %d differs from the linear search\n", query, idx);
+		}
+	}
+}
+
+/*
+=====================
+SameNodes
+=====================
+*/
+static bool SameNodes(vector<Pim::GameNode*> a, vector<Pim::GameNode*> b)
+{
+	sort(a.begin(), a.end());
+	sort(b.begin(), b.end());
+	return a == b;
+}
+
+/*
+=====================
+Distance
+=====================
+*/
+static float Distance(const Pim::AABB &box, const Pim::Vec2 &p)
+{
+	float dx = max(max(box.lower.x - p.x, p.x - box.upper.x), 0.f);
+	float dy = max(max(box.lower.y - p.y, p.y - box.upper.y), 0.f);
+	return sqrtf(dx*dx + dy*dy);
+}
+
+/*
+=====================
+main
+=====================
+*/
+int main(int argc, char **argv)
+{
+	srand(1);
+
+	Pim::SpatialIndex index(Pim::AABB(Pim::Vec2(0.f, 0.f), Pim::Vec2(WORLD_SIZE, WORLD_SIZE)),
+							CELL_SIZE, Pim::SpatialIndex::SCREEN_SPACE);
+
+	for (int i=0; i<NUM_NODES; i++) {
+		BoxNode *node = new BoxNode;
+
+		float size = (i < NUM_LARGE) ? 200.f + R01 * 2000.f : 4.f + R01 * 28.f;
+		Pim::Vec2 pos(R01 * WORLD_SIZE, R01 * WORLD_SIZE);
+		node->box = Pim::AABB(pos, pos + Pim::Vec2(size, size * (0.5f + R01)));
+
+		nodes.push_back(node);
+		index.Insert(node);
+	}
+
+	vector<Pim::AABB> rects;
+	vector<Pim::Vec2> points;
+	for (int i=0; i<NUM_QUERIES; i++) {
+		Pim::Vec2 p(R01 * WORLD_SIZE, R01 * WORLD_SIZE);
+		points.push_back(p);
+		rects.push_back(Pim::AABB(p, p + Pim::Vec2(50.f + R01 * 200.f, 50.f + R01 * 200.f)));
+	}
+
+	vector<Pim::GameNode*> found, expected;
+	vector<Pim::SpatialIndex::Hit> hits;
+	unsigned int total = 0;
+
+	// Rectangle queries
+	Pim::Tick start = Pim::GameControl::GetTime();
+	for (int i=0; i<NUM_QUERIES; i++) {
+		index.QueryRect(rects[i], found);
+		total += found.size();
+	}
+	double indexTime = Pim::GameControl::GetTime() - start;
+
+	start = Pim::GameControl::GetTime();
+	for (int i=0; i<NUM_QUERIES; i++) {
+		expected.clear();
+		for (unsigned j=0; j<nodes.size(); j++) {
+			if (nodes[j]->box.Overlaps(rects[i])) {
+				expected.push_back(nodes[j]);
+			}
+		}
+	}
+	double linearTime = Pim::GameControl::GetTime() - start;
+
+	printf("QueryRect:    %8.2f us/query (linear %8.2f us), %.1f nodes/query\n",
+		   indexTime * 1e6 / NUM_QUERIES, linearTime * 1e6 / NUM_QUERIES,
+		   float(total) / NUM_QUERIES);
+
+	for (int i=0; i<NUM_QUERIES; i++) {
+		index.QueryRect(rects[i], found);
+
+		expected.clear();
+		for (unsigned j=0; j<nodes.size(); j++) {
+			if (nodes[j]->box.Overlaps(rects[i])) {
+				expected.push_back(nodes[j]);
+			}
+		}
+
+		Check(SameNodes(found, expected), "QueryRect", i);
+	}
+
+	// Radius queries
+	total = 0;
+	start = Pim::GameControl::GetTime();
+	for (int i=0; i<NUM_QUERIES; i++) {
+		index.QueryRadius(points[i], 100.f, found);
+		total += found.size();
+	}
+	indexTime = Pim::GameControl::GetTime() - start;
+
+	printf("QueryRadius:  %8.2f us/query, %.1f nodes/query\n",
+		   indexTime * 1e6 / NUM_QUERIES, float(total) / NUM_QUERIES);
+
+	for (int i=0; i<NUM_QUERIES; i++) {
+		index.QueryRadius(points[i], 100.f, found);
+
+		expected.clear();
+		for (unsigned j=0; j<nodes.size(); j++) {
+			if (Distance(nodes[j]->box, points[i]) <= 100.f) {
+				expected.push_back(nodes[j]);
+			}
+		}
+
+		Check(SameNodes(found, expected), "QueryRadius", i);
+	}
+
+	// Nearest queries, compared by distance as ties may pick other nodes
+	const unsigned int k = 8;
+
+	start = Pim::GameControl::GetTime();
+	for (int i=0; i<NUM_QUERIES; i++) {
+		index.QueryNearest(points[i], k, hits);
+	}
+	indexTime = Pim::GameControl::GetTime() - start;
+
+	printf("QueryNearest: %8.2f us/query, k=%u\n", indexTime * 1e6 / NUM_QUERIES, k);
+
+	vector<float> dist(nodes.size());
+	for (int i=0; i<NUM_QUERIES; i++) {
+		index.QueryNearest(points[i], k, hits);
+
+		for (unsigned j=0; j<nodes.size(); j++) {
+			dist[j] = Distance(nodes[j]->box, points[i]);
+		}
+		partial_sort(dist.begin(), dist.begin() + k, dist.end());
+
+		bool ok = (hits.size() == k);
+		for (unsigned j=0; ok && j<k; j++) {
+			ok = (hits[j].distance == dist[j]);
+		}
+
+		Check(ok, "QueryNearest", i);
+	}
+
+	// Moving every node and refreshing the index
+	for (unsigned i=0; i<nodes.size(); i++) {
+		Pim::Vec2 step(R01 * 20.f - 10.f, R01 * 20.f - 10.f);
+		nodes[i]->box = Pim::AABB(nodes[i]->box.lower + step, nodes[i]->box.upper + step);
+	}
+
+	start = Pim::GameControl::GetTime();
+	index.Refresh();
+	printf("Refresh:      %8.2f ms for %d nodes\n",
+		   (Pim::GameControl::GetTime() - start) * 1e3, NUM_NODES);
+
+	for (int i=0; i<NUM_QUERIES; i++) {
+		index.QueryRect(rects[i], found);
+
+		expected.clear();
+		for (unsigned j=0; j<nodes.size(); j++) {
+			if (nodes[j]->box.Overlaps(rects[i])) {
+				expected.push_back(nodes[j]);
+			}
+		}
+
+		Check(SameNodes(found, expected), "QueryRect after Refresh", i);
+	}
+
+	// The nodes are leaked, deleting them requires a GameControl
+
+	if (failures) {
+		printf("%d queries failed\n", failures);
+		return 1;
+	}
+
+	printf("All queries match the linear search\n");
+	return 0;
+}
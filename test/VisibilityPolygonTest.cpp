@@ -0,0 +1,247 @@
+#include "PimInternal.h"
+#include "PimVisibilityPolygon.h"
+#include "PimGameControl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+	Standalone test of VisibilityPolygon. The sweep is checked against a
+	brute force ray test over every segment on 900k random points, and
+	timed with up to 16k segments. Run with "make tests && test/VisibilityPolygonTest".
+*/
+
+#define NUM_SCENES		300
+#define NUM_POINTS		3000		// Points checked per scene
+#define EXTENT			250.f
+
+// Points this close to a segment or to the direction of an endpoint are
+// skipped, as the polygon is only exact up to float precision there.
+#define MIN_DISTANCE	0.05f
+#define MIN_ANGLE		0.001f
+
+static int failures = 0;
+
+/*
+=====================
+Random
+=====================
+*/
+static float Random(float lower, float upper)
+{
+	return lower + (upper - lower) * ((float)rand() / (float)RAND_MAX);
+}
+
+/*
+=====================
+AddPolygon
+
+Adds the edges of a regular polygon with 'n' corners.
+=====================
+*/
+static void AddPolygon(vector<Pim::Vec2> &segs, const Pim::Vec2 &center, float radius,
+					   float rotation, int n)
+{
+	vector<Pim::Vec2> corners;
+	for (int i=0; i<n; i++) {
+		float a = rotation + i * 2.f * (float)M_PI / n;
+		corners.push_back(center + Pim::Vec2(radius * cosf(a), radius * sinf(a)));
+	}
+
+	for (int i=0; i<n; i++) {
+		segs.push_back(corners[i]);
+		segs.push_back(corners[(i+1) % n]);
+	}
+}
+
+/*
+=====================
+IsVisible
+
+The brute force answer: 'p' is visible if the line from the origin
+does not cross any of the segments.
+=====================
+*/
+static bool IsVisible(const vector<Pim::Vec2> &segs, const Pim::Vec2 &origin, const Pim::Vec2 &p)
+{
+	Pim::Vec2 dir = p - origin;
+
+	for (unsigned i=0; i<segs.size(); i+=2) {
+		Pim::Vec2 a = segs[i] - origin;
+		Pim::Vec2 e = segs[i+1] - segs[i];
+
+		float den = dir.Cross(e);
+		if (fabsf(den) < 1e-9f) {
+			continue;
+		}
+
+		float t = a.Cross(e) / den;
+		float s = a.Cross(dir) / den;
+
+		if (t > 0.f && t < 1.f && s >= 0.f && s <= 1.f) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+=====================
+IsAmbiguous
+
+Returns true if 'p' lies too close to a segment, or to the direction of
+a segment endpoint, for the answer to be well defined in floats.
+=====================
+*/
+static bool IsAmbiguous(const vector<Pim::Vec2> &segs, const Pim::Vec2 &origin, const Pim::Vec2 &p)
+{
+	Pim::Vec2 dir = p - origin;
+
+	for (unsigned i=0; i<segs.size(); i+=2) {
+		Pim::Vec2 e = segs[i+1] - segs[i];
+
+		float s = (p - segs[i]).Dot(e) / e.Dot(e);
+		s = max(0.f, min(1.f, s));
+
+		if ((segs[i] + e * s - p).Length() < MIN_DISTANCE) {
+			return true;
+		}
+
+		for (int j=0; j<2; j++) {
+			Pim::Vec2 v = segs[i+j] - origin;
+			if (fabsf(atan2f(v.Cross(dir), v.Dot(dir))) < MIN_ANGLE) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+=====================
+TestRandomScenes
+
+Each scene scatters convex polygons on a grid around the origin. Some
+scenes put the origin at (0,0) or a segment on the negative x axis,
+where the sweep starts and ends.
+=====================
+*/
+static void TestRandomScenes()
+{
+	srand(3);
+
+	Pim::VisibilityPolygon vis;
+	vector<Pim::Vec2> segs;
+	unsigned int checked = 0;
+
+	for (int scene=0; scene<NUM_SCENES; scene++) {
+		segs.clear();
+
+		for (int gx=0; gx<6; gx++) {
+			for (int gy=0; gy<6; gy++) {
+				if (rand() % 3) {
+					continue;
+				}
+
+				Pim::Vec2 center(-300.f + gx * 100.f + 50.f, -300.f + gy * 100.f + 50.f);
+				AddPolygon(segs, center, Random(5.f, 40.f), Random(0.f, 6.28f), 3 + rand() % 4);
+			}
+		}
+
+		Pim::Vec2 origin(Random(-280.f, 280.f), Random(-280.f, 280.f));
+		if (scene % 10 == 0) {
+			origin = Pim::Vec2(0.f, 0.f);
+		}
+
+		if (scene % 7 == 0) {
+			segs.push_back(origin + Pim::Vec2(-60.f, 0.f));
+			segs.push_back(origin + Pim::Vec2(-60.f, 30.f));
+			segs.push_back(origin + Pim::Vec2(-60.f, 0.f));
+			segs.push_back(origin + Pim::Vec2(-60.f, -30.f));
+		}
+
+		vis.Compute(origin, Pim::Vec2(EXTENT, EXTENT), segs);
+
+		for (int i=0; i<NUM_POINTS; i++) {
+			Pim::Vec2 p(origin.x + Random(-EXTENT+1.f, EXTENT-1.f),
+						origin.y + Random(-EXTENT+1.f, EXTENT-1.f));
+
+			if (IsAmbiguous(segs, origin, p)) {
+				continue;
+			}
+
+			checked++;
+
+			bool expected = IsVisible(segs, origin, p);
+			if (vis.Contains(p) != expected) {
+				if (failures++ < 10) {
+					printf("FAIL: scene %d, origin (%.2f, %.2f), point (%.2f, %.2f) should be %s\n",
+						   scene, origin.x, origin.y, p.x, p.y, expected ? "visible" : "hidden");
+				}
+			}
+		}
+	}
+
+	printf("%u of %d points checked against the brute force test\n",
+		   checked, NUM_SCENES * NUM_POINTS);
+}
+
+/*
+=====================
+TimeSweep
+
+A grid of squares with 250 to 16000 segments in total.
+=====================
+*/
+static void TimeSweep()
+{
+	printf("\nsegments  compute   vertices\n");
+
+	for (int num=250; num<=16000; num*=4) {
+		vector<Pim::Vec2> segs;
+
+		int side = (int)sqrtf(num / 4.f);
+		float cell = 1000.f / side;
+
+		for (int gx=0; gx<side; gx++) {
+			for (int gy=0; gy<side; gy++) {
+				Pim::Vec2 center(-500.f + (gx + 0.5f) * cell, -500.f + (gy + 0.5f) * cell);
+				AddPolygon(segs, center, cell * 0.42f, (float)M_PI / 4.f, 4);
+			}
+		}
+
+		Pim::VisibilityPolygon vis;
+		Pim::Vec2 origin(cell * 0.01f, cell * 0.5f + 1.f);
+		const int runs = 5;
+
+		Pim::Tick start = Pim::GameControl::GetTime();
+		for (int i=0; i<runs; i++) {
+			vis.Compute(origin, Pim::Vec2(600.f, 600.f), segs);
+		}
+		double time = (Pim::GameControl::GetTime() - start) / runs;
+
+		printf("%8u  %6.3f ms  %8u\n", (unsigned int)segs.size() / 2, time * 1e3,
+			   (unsigned int)vis.vertices.size());
+	}
+}
+
+/*
+=====================
+main
+=====================
+*/
+int main(int argc, char **argv)
+{
+	TestRandomScenes();
+	TimeSweep();
+
+	if (failures) {
+		printf("\n%d points differ from the brute force test\n", failures);
+		return 1;
+	}
+
+	printf("\nAll points match the brute force test\n");
+	return 0;
+}